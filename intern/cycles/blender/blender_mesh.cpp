@@ -586,17 +586,11 @@ static void create_subd_mesh(Scene *scene, Mesh *mesh, BL::Mesh b_mesh, PointerR
 
 /* Sync */
 
-Mesh *BlenderSync::sync_mesh(BL::Object b_ob, bool object_updated, bool hide_tris)
+void BlenderSync::find_object_shaders(BL::Object b_ob, vector<uint>& used_shaders)
 {
-	/* test if we can instance or if the object is modified */
-	BL::ID b_ob_data = b_ob.data();
-	BL::ID key = (BKE_object_is_modified(b_ob))? b_ob: b_ob_data;
 	BL::Material material_override = render_layer.material_override;
-
-	/* find shader indices */
-	vector<uint> used_shaders;
-
 	BL::Object::material_slots_iterator slot;
+
 	for(b_ob.material_slots.begin(slot); slot != b_ob.material_slots.end(); ++slot) {
 		if(material_override)
 			find_shader(material_override, used_shaders, scene->default_surface);
@@ -610,6 +604,17 @@ Mesh *BlenderSync::sync_mesh(BL::Object b_ob, bool object_updated, bool hide_tri
 		else
 			used_shaders.push_back(scene->default_surface);
 	}
+}
+
+Mesh *BlenderSync::sync_mesh(BL::Object b_ob, bool object_updated, bool hide_tris)
+{
+	/* test if we can instance or if the object is modified */
+	BL::ID b_ob_data = b_ob.data();
+	BL::ID key = (BKE_object_is_modified(b_ob))? b_ob: b_ob_data;
+
+	/* find shader indices */
+	vector<uint> used_shaders;
+	find_object_shaders(b_ob, used_shaders);
 	
 	/* test if we need to sync */
 	bool use_mesh_geometry = render_layer.use_surfaces || render_layer.use_hair;
@@ -721,6 +726,72 @@ Mesh *BlenderSync::sync_mesh(BL::Object b_ob, bool object_updated, bool hide_tri
 	return mesh;
 }
 
+Mesh *BlenderSync::sync_fracture_mesh(BL::Object b_ob, BL::FractureMeshIsland b_island, bool hide_tris)
+{
+	/* islands are keyed by their object and id, so updates of the object
+	 * (e.g. a refracture) tag all of its island meshes for recalc */
+	MeshKey key(b_ob.ptr.data, b_island.id());
+
+	/* find shader indices, islands use the material slots of their object */
+	vector<uint> used_shaders;
+	find_object_shaders(b_ob, used_shaders);
+
+	/* test if we need to sync */
+	bool use_surfaces = render_layer.use_surfaces && !hide_tris;
+	Mesh *mesh;
+
+	if(!mesh_map.sync(&mesh, b_ob, PointerRNA_NULL, key)) {
+		if(mesh->used_shaders != used_shaders);
+		else if(use_surfaces != mesh->geometry_synced);
+		else {
+			bool attribute_recalc = false;
+
+			foreach(uint shader, mesh->used_shaders)
+				if(scene->shaders[shader]->need_update_attributes)
+					attribute_recalc = true;
+
+			if(!attribute_recalc)
+				return mesh;
+		}
+	}
+
+	/* ensure we only sync instanced meshes once */
+	if(mesh_synced.find(mesh) != mesh_synced.end())
+		return mesh;
+
+	mesh_synced.insert(mesh);
+
+	vector<Mesh::Triangle> oldtriangle = mesh->triangles;
+
+	mesh->clear();
+	mesh->used_shaders = used_shaders;
+	mesh->name = ustring(b_ob.name().c_str());
+
+	if(use_surfaces) {
+		BL::Mesh b_mesh = b_island.to_mesh(b_data.ptr.data);
+
+		if(b_mesh) {
+			create_mesh(scene, mesh, b_mesh, used_shaders);
+
+			/* free island mesh */
+			b_data.meshes.remove(b_mesh);
+		}
+	}
+	mesh->geometry_synced = use_surfaces;
+
+	/* tag update */
+	bool rebuild = (oldtriangle.size() != mesh->triangles.size());
+
+	if(!rebuild && oldtriangle.size()) {
+		if(memcmp(&oldtriangle[0], &mesh->triangles[0], sizeof(Mesh::Triangle)*oldtriangle.size()) != 0)
+			rebuild = true;
+	}
+
+	mesh->tag_update(scene, rebuild);
+
+	return mesh;
+}
+
 void BlenderSync::sync_mesh_motion(BL::Object b_ob, Object *object, float motion_time)
 {
 	/* ensure we only sync instanced meshes once */
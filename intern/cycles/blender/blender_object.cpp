@@ -223,7 +223,8 @@ void BlenderSync::sync_background_light()
 /* Object */
 
 Object *BlenderSync::sync_object(BL::Object b_parent, int persistent_id[OBJECT_PERSISTENT_ID_SIZE], BL::DupliObject b_dupli_ob,
-                                 Transform& tfm, uint layer_flag, float motion_time, bool hide_tris)
+                                 Transform& tfm, uint layer_flag, float motion_time, bool hide_tris,
+                                 BL::FractureMeshIsland b_island)
 {
 	BL::Object b_ob = (b_dupli_ob ? b_dupli_ob.object() : b_parent);
 	bool motion = motion_time != 0.0f;
@@ -263,8 +264,8 @@ Object *BlenderSync::sync_object(BL::Object b_parent, int persistent_id[OBJECT_P
 				}
 			}
 
-			/* mesh deformation */
-			if(object->mesh)
+			/* mesh deformation, islands only move rigidly */
+			if(object->mesh && !b_island)
 				sync_mesh_motion(b_ob, object, motion_time);
 		}
 
@@ -280,7 +281,10 @@ Object *BlenderSync::sync_object(BL::Object b_parent, int persistent_id[OBJECT_P
 	bool use_holdout = (layer_flag & render_layer.holdout_layer) != 0;
 	
 	/* mesh sync */
-	object->mesh = sync_mesh(b_ob, object_updated, hide_tris);
+	if(b_island)
+		object->mesh = sync_fracture_mesh(b_ob, b_island, hide_tris);
+	else
+		object->mesh = sync_mesh(b_ob, object_updated, hide_tris);
 
 	/* special case not tracked by object update flags */
 
@@ -331,7 +335,7 @@ Object *BlenderSync::sync_object(BL::Object b_parent, int persistent_id[OBJECT_P
 			mesh->use_motion_blur = false;
 
 			if(object_use_motion(b_ob)) {
-				if(object_use_deform_motion(b_ob)) {
+				if(object_use_deform_motion(b_ob) && !b_island) {
 					mesh->motion_steps = object_motion_steps(b_ob);
 					mesh->use_motion_blur = true;
 				}
@@ -371,6 +375,50 @@ Object *BlenderSync::sync_object(BL::Object b_parent, int persistent_id[OBJECT_P
 	return object;
 }
 
+/* Fracture */
+
+static bool object_use_fracture_islands(BL::Object b_ob)
+{
+	BL::RigidBodyObject b_rbo = b_ob.rigidbody_object();
+
+	if(!b_rbo)
+		return false;
+
+	BL::FractureContainer b_fc = b_rbo.fracture_container();
+
+	/* autohide merges faces across islands which needs the joined mesh */
+	if(!b_fc || b_fc.autohide_dist() > 0.0f)
+		return false;
+
+	/* islands replace the evaluated mesh, so modifiers after the fracture
+	 * modifier would be lost, the ones before are part of the shards */
+	int num_modifiers = b_ob.modifiers.length();
+
+	if(num_modifiers != 0 && b_ob.modifiers[num_modifiers - 1].type() != BL::Modifier::type_FRACTURE)
+		return false;
+
+	return b_fc.mesh_islands.length() > 1;
+}
+
+void BlenderSync::sync_fracture_islands(BL::Object b_ob, uint layer_flag, float motion_time, bool hide_tris)
+{
+	/* every island becomes an own object instancing its own mesh, so the
+	 * simulation only changes object transforms and not the geometry */
+	BL::FractureContainer b_fc = b_ob.rigidbody_object().fracture_container();
+	BL::FractureContainer::mesh_islands_iterator b_mi;
+	int persistent_id[OBJECT_PERSISTENT_ID_SIZE] = {0};
+	int index = 0;
+
+	for(b_fc.mesh_islands.begin(b_mi); b_mi != b_fc.mesh_islands.end(); ++b_mi, ++index) {
+		Transform tfm = get_transform(b_mi->matrix_world());
+
+		/* island order is stable between frames, which motion blur relies on */
+		persistent_id[0] = index + 1;
+
+		sync_object(b_ob, persistent_id, PointerRNA_NULL, tfm, layer_flag, motion_time, hide_tris, *b_mi);
+	}
+}
+
 static bool object_render_hide_original(BL::Object::type_enum ob_type, BL::Object::dupli_type_enum dupli_type)
 {
 	/* metaball exception, they duplicate self */
@@ -525,8 +573,13 @@ void BlenderSync::sync_objects(BL::SpaceView3D b_v3d, float motion_time)
 
 				if(!object_render_hide(b_ob, true, true, hide_tris)) {
 					/* object itself */
-					Transform tfm = get_transform(b_ob.matrix_world());
-					sync_object(b_ob, NULL, PointerRNA_NULL, tfm, ob_layer, motion_time, hide_tris);
+					if(object_use_fracture_islands(b_ob)) {
+						sync_fracture_islands(b_ob, ob_layer, motion_time, hide_tris);
+					}
+					else {
+						Transform tfm = get_transform(b_ob.matrix_world());
+						sync_object(b_ob, NULL, PointerRNA_NULL, tfm, ob_layer, motion_time, hide_tris);
+					}
 				}
 			}
 
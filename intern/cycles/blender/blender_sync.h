@@ -84,9 +84,12 @@ private:
 
 	void sync_nodes(Shader *shader, BL::ShaderNodeTree b_ntree);
 	Mesh *sync_mesh(BL::Object b_ob, bool object_updated, bool hide_tris);
+	Mesh *sync_fracture_mesh(BL::Object b_ob, BL::FractureMeshIsland b_island, bool hide_tris);
 	void sync_curves(Mesh *mesh, BL::Mesh b_mesh, BL::Object b_ob, bool motion, int time_index = 0);
 	Object *sync_object(BL::Object b_parent, int persistent_id[OBJECT_PERSISTENT_ID_SIZE], BL::DupliObject b_dupli_ob,
-	                                 Transform& tfm, uint layer_flag, float motion_time, bool hide_tris);
+	                                 Transform& tfm, uint layer_flag, float motion_time, bool hide_tris,
+	                                 BL::FractureMeshIsland b_island = PointerRNA_NULL);
+	void sync_fracture_islands(BL::Object b_ob, uint layer_flag, float motion_time, bool hide_tris);
 	void sync_light(BL::Object b_parent, int persistent_id[OBJECT_PERSISTENT_ID_SIZE], BL::Object b_ob, Transform& tfm);
 	void sync_background_light();
 	void sync_mesh_motion(BL::Object b_ob, Object *object, float motion_time);
@@ -97,6 +100,7 @@ private:
 
 	/* util */
 	void find_shader(BL::ID id, vector<uint>& used_shaders, int default_shader);
+	void find_object_shaders(BL::Object b_ob, vector<uint>& used_shaders);
 	bool BKE_object_is_modified(BL::Object b_ob);
 	bool object_is_mesh(BL::Object b_ob);
 	bool object_is_light(BL::Object b_ob);
@@ -108,7 +112,7 @@ private:
 
 	id_map<void*, Shader> shader_map;
 	id_map<ObjectKey, Object> object_map;
-	id_map<void*, Mesh> mesh_map;
+	id_map<MeshKey, Mesh> mesh_map;
 	id_map<ObjectKey, Light> light_map;
 	id_map<ParticleSystemKey, ParticleSystem> particle_system_map;
 	set<Mesh*> mesh_synced;
@@ -595,6 +595,31 @@ struct ParticleSystemKey {
 	}
 };
 
+/* Mesh Key
+ *
+ * Meshes are keyed by the ID they are created from, fracture islands also
+ * by the island id since all islands of an object are created from it. */
+
+struct MeshKey {
+	void *id;
+	int island;
+
+	MeshKey(void *id_, int island_ = -1)
+	: id(id_), island(island_)
+	{
+	}
+
+	bool operator<(const MeshKey& k) const
+	{
+		if(id < k.id)
+			return true;
+		else if(id == k.id)
+			return island < k.island;
+
+		return false;
+	}
+};
+
 CCL_NAMESPACE_END
 
 #endif /* __BLENDER_UTIL_H__ */
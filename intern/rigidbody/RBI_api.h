@@ -201,6 +201,7 @@ void RB_body_set_kinematic_state(rbRigidBody *body, int kinematic);
 
 /* RigidBody Interface - Rigid Body Activation States */
 int RB_body_get_activation_state(rbRigidBody *body);
+void RB_body_force_activation_state(rbRigidBody *body, int state);
 void RB_body_set_activation_state(rbRigidBody *body, int use_deactivation);
 void RB_body_activate(rbRigidBody *body);
 void RB_body_deactivate(rbRigidBody *body);
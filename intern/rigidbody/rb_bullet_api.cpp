@@ -840,6 +840,12 @@ int RB_body_get_activation_state(rbRigidBody* object)
 	return body->getActivationState();
 }
 
+void RB_body_force_activation_state(rbRigidBody *object, int state)
+{
+	btRigidBody *body = object->body;
+	body->forceActivationState(state);
+}
+
 /* ............ */
 
 
@@ -51,6 +51,7 @@ FLUID_3D::FLUID_3D(int *res, float dx, float dtdef, int init_heat, int init_fire
 	_dt = dtdef;	// just in case. set in step from a RNA factor
 
 	_iterations = 100;
+	_pressureSolver = NULL;
 	_tempAmb = 0; 
 	_heatDiffusion = 1e-3;
 	_totalTime = 0.0f;
@@ -307,7 +308,8 @@ FLUID_3D::~FLUID_3D()
 
 // init direct access functions from blender
 void FLUID_3D::initBlenderRNA(float *alpha, float *beta, float *dt_factor, float *vorticity, int *borderCollision, float *burning_rate,
-							  float *flame_smoke, float *flame_smoke_color, float *flame_vorticity, float *flame_ignition_temp, float *flame_max_temp)
+							  float *flame_smoke, float *flame_smoke_color, float *flame_vorticity, float *flame_ignition_temp, float *flame_max_temp,
+							  int *pressure_solver)
 {
 	_alpha = alpha;
 	_beta = beta;
@@ -320,6 +322,7 @@ void FLUID_3D::initBlenderRNA(float *alpha, float *beta, float *dt_factor, float
 	_flame_vorticity = flame_vorticity;
 	_ignition_temp = flame_ignition_temp;
 	_max_temp = flame_max_temp;
+	_pressureSolver = pressure_solver;
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -400,20 +403,27 @@ void FLUID_3D::step(float dt, float gravity[3])
 	SWAP_POINTERS(_zVelocity, _zVelocityTemp);
 #if PARALLEL==1
 	}	// end of single
+	}
 
-	#pragma omp barrier
+	/* the multigrid solver runs its own parallel loops, nested inside the
+	 * section below they would be serialized next to the heat diffusion */
+	if (usePressureMG())
+		project();
 
+	#pragma omp parallel
+	{
 	#pragma omp for
 	for (int i=0; i<2; i++)
 	{
 		if (i==0)
 		{
-#endif
-			project();
-#if PARALLEL==1
+			if (!usePressureMG())
+				project();
 		}
 		else if (i==1)
 		{
+#else
+	project();
 #endif
 			if (_heat) {
 				diffuseHeat();
@@ -994,7 +1004,10 @@ void FLUID_3D::project()
 	copyBorderAll(_pressure, 0, _zRes);
 
 	// solve Poisson equation
-	solvePressurePre(_pressure, _divergence, _obstacles);
+	if (usePressureMG())
+		solvePressureMG(_pressure, _divergence, _obstacles);
+	else
+		solvePressurePre(_pressure, _divergence, _obstacles);
 
 	setObstaclePressure(_pressure, 0, _zRes);
 
@@ -39,6 +39,10 @@
 // #include "WTURBULENCE.h"
 #include "VEC3.h"
 
+// pressure solvers, matching SM_PRESSURE_* in DNA_smoke_types.h
+#define PRESSURE_SOLVER_PCG   0
+#define PRESSURE_SOLVER_MGPCG 1
+
 using namespace std;
 using namespace BasicVector;
 struct WTURBULENCE;
@@ -55,7 +59,8 @@ struct FLUID_3D
 		void initColors(float init_r, float init_g, float init_b);
 
 		void initBlenderRNA(float *alpha, float *beta, float *dt_factor, float *vorticity, int *border_colli, float *burning_rate,
-							float *flame_smoke, float *flame_smoke_color, float *flame_vorticity, float *ignition_temp, float *max_temp);
+							float *flame_smoke, float *flame_smoke_color, float *flame_vorticity, float *ignition_temp, float *max_temp,
+							int *pressure_solver);
 		
 		// create & allocate vector noise advection 
 		void initVectorNoise(int amplify);
@@ -143,6 +148,7 @@ struct FLUID_3D
 
 		// CG fields
 		int _iterations;
+		int *_pressureSolver; // RNA pointer, one of the PRESSURE_SOLVER_* types
 
 		// simulation constants
 		float _dt;
@@ -187,6 +193,8 @@ struct FLUID_3D
 		void diffuseColor();
 		void solvePressure(float* field, float* b, unsigned char* skip);
 		void solvePressurePre(float* field, float* b, unsigned char* skip);
+		void solvePressureMG(float* field, float* b, unsigned char* skip);
+		bool usePressureMG() const { return _pressureSolver && *_pressureSolver == PRESSURE_SOLVER_MGPCG; }
 		void solveHeat(float* field, float* b, unsigned char* skip);
 		void solveDiffusion(float* field, float* b, float* factor);
 
@@ -326,3 +326,487 @@ void FLUID_3D::solvePressurePre(float* field, float* b, unsigned char* skip)
 	if (_direction) delete[] _direction;
 	if (_q)       delete[] _q;
 }
+
+//////////////////////////////////////////////////////////////////////
+// Multigrid preconditioner for the pressure solve
+//
+// Coarse levels aggregate 2x2x2 blocks of unknowns, prolongation is
+// piecewise constant and the coarse operators are the Galerkin products
+// of the finer ones, so obstacle (skip) cells only ever remove couplings
+// and never leak pressure through walls. With damped Jacobi smoothing
+// the V-cycle is symmetric and can precondition CG directly.
+//////////////////////////////////////////////////////////////////////
+#define MG_MAX_LEVELS 16
+#define MG_MIN_RES 4
+#define MG_SMOOTH_STEPS 2
+#define MG_COARSE_STEPS 16
+#define MG_OMEGA 0.6666667f
+
+struct MG_LEVEL
+{
+	int res[3];
+	size_t slab;
+	size_t total;
+	float *diag;			// diagonal of the level operator
+	float *invDiag;			// Jacobi scaling, 0 where the cell is no unknown
+	float *coupling[3];		// coarse levels: coupling to the +x, +y, +z neighbor
+	unsigned char *links;	// finest level: unit couplings to +x, +y, +z, -x, -y, -z
+	float *x;
+	float *b;
+	float *r;
+};
+
+// sum of the neighbor values weighted by their (negated) off-diagonal entries
+static inline float mgNeighborSum(const MG_LEVEL &l, const float *v, int x, int y, int z, size_t index)
+{
+	float sum = 0.0f;
+
+	if (l.links)
+	{
+		const unsigned char m = l.links[index];
+		if (m & 1)  sum += v[index + 1];
+		if (m & 2)  sum += v[index + l.res[0]];
+		if (m & 4)  sum += v[index + l.slab];
+		if (m & 8)  sum += v[index - 1];
+		if (m & 16) sum += v[index - l.res[0]];
+		if (m & 32) sum += v[index - l.slab];
+		return sum;
+	}
+
+	if (x + 1 < l.res[0]) sum += l.coupling[0][index] * v[index + 1];
+	if (y + 1 < l.res[1]) sum += l.coupling[1][index] * v[index + l.res[0]];
+	if (z + 1 < l.res[2]) sum += l.coupling[2][index] * v[index + l.slab];
+	if (x > 0) sum += l.coupling[0][index - 1] * v[index - 1];
+	if (y > 0) sum += l.coupling[1][index - l.res[0]] * v[index - l.res[0]];
+	if (z > 0) sum += l.coupling[2][index - l.slab] * v[index - l.slab];
+	return sum;
+}
+
+// coupling between a fine cell and its neighbor along axis
+static inline float mgCoupling(const MG_LEVEL &l, size_t index, int axis)
+{
+	if (l.links)
+		return (l.links[index] & (1 << axis)) ? 1.0f : 0.0f;
+	return l.coupling[axis][index];
+}
+
+// r = b - A x
+static void mgResidual(MG_LEVEL &l)
+{
+	int z;
+#if PARALLEL==1
+	#pragma omp parallel for schedule(static)
+#endif
+	for (z = 0; z < l.res[2]; z++)
+	{
+		size_t index = z * l.slab;
+		for (int y = 0; y < l.res[1]; y++)
+			for (int x = 0; x < l.res[0]; x++, index++)
+				l.r[index] = l.b[index] - (l.diag[index] * l.x[index] - mgNeighborSum(l, l.x, x, y, z, index));
+	}
+}
+
+// damped Jacobi sweeps, x = x + w * D^-1 * (b - A x)
+static void mgSmooth(MG_LEVEL &l, int steps, bool zeroGuess)
+{
+	int z;
+
+	for (int step = 0; step < steps; step++)
+	{
+		// with a zero guess the first residual is b itself
+		const float *r = l.b;
+		if (step > 0 || !zeroGuess)
+		{
+			mgResidual(l);
+			r = l.r;
+		}
+
+#if PARALLEL==1
+		#pragma omp parallel for schedule(static)
+#endif
+		for (z = 0; z < l.res[2]; z++)
+		{
+			const size_t begin = z * l.slab, end = begin + l.slab;
+			if (step == 0 && zeroGuess)
+			{
+				for (size_t index = begin; index < end; index++)
+					l.x[index] = MG_OMEGA * l.invDiag[index] * r[index];
+			}
+			else
+			{
+				for (size_t index = begin; index < end; index++)
+					l.x[index] += MG_OMEGA * l.invDiag[index] * r[index];
+			}
+		}
+	}
+}
+
+// Galerkin operator of the next coarser level, gathered per coarse cell
+static void mgBuildCoarse(const MG_LEVEL &f, MG_LEVEL &c)
+{
+	int Z;
+#if PARALLEL==1
+	#pragma omp parallel for schedule(static)
+#endif
+	for (Z = 0; Z < c.res[2]; Z++)
+	{
+		size_t cindex = Z * c.slab;
+		for (int Y = 0; Y < c.res[1]; Y++)
+			for (int X = 0; X < c.res[0]; X++, cindex++)
+			{
+				float diag = 0.0f;
+				float coupling[3] = {0.0f, 0.0f, 0.0f};
+
+				for (int z = 2 * Z; z < 2 * Z + 2 && z < f.res[2]; z++)
+					for (int y = 2 * Y; y < 2 * Y + 2 && y < f.res[1]; y++)
+						for (int x = 2 * X; x < 2 * X + 2 && x < f.res[0]; x++)
+						{
+							const size_t index = z * f.slab + y * f.res[0] + x;
+							const int odd[3] = {x & 1, y & 1, z & 1};
+
+							if (f.invDiag[index] == 0.0f)
+								continue;
+
+							diag += f.diag[index];
+							for (int axis = 0; axis < 3; axis++)
+							{
+								const float w = mgCoupling(f, index, axis);
+								// couplings inside the block fold into the diagonal
+								if (odd[axis])
+									coupling[axis] += w;
+								else
+									diag -= 2.0f * w;
+							}
+						}
+
+				c.diag[cindex] = 0.125f * diag;
+				c.invDiag[cindex] = (diag > 0.0f) ? 1.0f / c.diag[cindex] : 0.0f;
+				c.coupling[0][cindex] = 0.125f * coupling[0];
+				c.coupling[1][cindex] = 0.125f * coupling[1];
+				c.coupling[2][cindex] = 0.125f * coupling[2];
+			}
+	}
+}
+
+// restrict the fine residual into the coarse right hand side
+static void mgRestrict(const MG_LEVEL &f, MG_LEVEL &c)
+{
+	int Z;
+#if PARALLEL==1
+	#pragma omp parallel for schedule(static)
+#endif
+	for (Z = 0; Z < c.res[2]; Z++)
+	{
+		size_t cindex = Z * c.slab;
+		for (int Y = 0; Y < c.res[1]; Y++)
+			for (int X = 0; X < c.res[0]; X++, cindex++)
+			{
+				float sum = 0.0f;
+				for (int z = 2 * Z; z < 2 * Z + 2 && z < f.res[2]; z++)
+					for (int y = 2 * Y; y < 2 * Y + 2 && y < f.res[1]; y++)
+						for (int x = 2 * X; x < 2 * X + 2 && x < f.res[0]; x++)
+						{
+							const size_t index = z * f.slab + y * f.res[0] + x;
+							if (f.invDiag[index] != 0.0f)
+								sum += f.r[index];
+						}
+				c.b[cindex] = 0.125f * sum;
+			}
+	}
+}
+
+// add the coarse correction to the fine unknowns
+static void mgProlong(const MG_LEVEL &c, MG_LEVEL &f)
+{
+	int z;
+#if PARALLEL==1
+	#pragma omp parallel for schedule(static)
+#endif
+	for (z = 0; z < f.res[2]; z++)
+	{
+		size_t index = z * f.slab;
+		for (int y = 0; y < f.res[1]; y++)
+		{
+			const size_t cindex = (z / 2) * c.slab + (y / 2) * c.res[0];
+			for (int x = 0; x < f.res[0]; x++, index++)
+				if (f.invDiag[index] != 0.0f)
+					f.x[index] += c.x[cindex + x / 2];
+		}
+	}
+}
+
+static void mgVCycle(MG_LEVEL *levels, int level, int numLevels)
+{
+	MG_LEVEL &l = levels[level];
+
+	if (level == numLevels - 1)
+	{
+		mgSmooth(l, MG_COARSE_STEPS, true);
+		return;
+	}
+
+	mgSmooth(l, MG_SMOOTH_STEPS, true);
+	mgResidual(l);
+	mgRestrict(l, levels[level + 1]);
+	mgVCycle(levels, level + 1, numLevels);
+	mgProlong(levels[level + 1], l);
+	mgSmooth(l, MG_SMOOTH_STEPS, false);
+}
+
+//////////////////////////////////////////////////////////////////////
+// solve the poisson equation with multigrid preconditioned CG
+//////////////////////////////////////////////////////////////////////
+void FLUID_3D::solvePressureMG(float* field, float* b, unsigned char* skip)
+{
+	MG_LEVEL levels[MG_MAX_LEVELS];
+	int numLevels = 0;
+	int z;
+
+	float *_residual  = new float[_totalCells];
+	float *_direction = new float[_totalCells];
+	float *_q         = new float[_totalCells];
+	float *_h         = new float[_totalCells];
+
+	// partial sums per slab, summed in order so the result does not depend on the thread count
+	double *_partDelta = new double[_zRes];
+	float *_partMax    = new float[_zRes];
+
+	memset(_residual, 0, sizeof(float)*_totalCells);
+	memset(_direction, 0, sizeof(float)*_totalCells);
+	memset(_q, 0, sizeof(float)*_totalCells);
+	memset(_h, 0, sizeof(float)*_totalCells);
+
+	// finest level, the poisson stencil of solvePressurePre on the interior cells
+	MG_LEVEL &fine = levels[numLevels++];
+	fine.res[0] = _xRes;
+	fine.res[1] = _yRes;
+	fine.res[2] = _zRes;
+	fine.slab = _slabSize;
+	fine.total = _totalCells;
+	fine.diag = new float[_totalCells];
+	fine.invDiag = new float[_totalCells];
+	fine.coupling[0] = fine.coupling[1] = fine.coupling[2] = NULL;
+	fine.links = new unsigned char[_totalCells];
+	fine.x = _h;
+	fine.b = _residual;
+	fine.r = new float[_totalCells];
+
+#if PARALLEL==1
+	#pragma omp parallel for schedule(static)
+#endif
+	for (z = 0; z < _zRes; z++)
+	{
+		size_t index = z * _slabSize;
+		for (int y = 0; y < _yRes; y++)
+			for (int x = 0; x < _xRes; x++, index++)
+			{
+				float Acenter = 0.0f;
+				unsigned char links = 0;
+
+				if (x > 0 && x < _xRes - 1 && y > 0 && y < _yRes - 1 && z > 0 && z < _zRes - 1 && !skip[index])
+				{
+					if (!skip[index + 1]) Acenter += 1.0f;
+					if (!skip[index - 1]) Acenter += 1.0f;
+					if (!skip[index + _xRes]) Acenter += 1.0f;
+					if (!skip[index - _xRes]) Acenter += 1.0f;
+					if (!skip[index + _slabSize]) Acenter += 1.0f;
+					if (!skip[index - _slabSize]) Acenter += 1.0f;
+
+					// border cells keep their values, they only add to the diagonal
+					if (x + 1 < _xRes - 1 && !skip[index + 1]) links |= 1;
+					if (y + 1 < _yRes - 1 && !skip[index + _xRes]) links |= 2;
+					if (z + 1 < _zRes - 1 && !skip[index + _slabSize]) links |= 4;
+					if (x - 1 > 0 && !skip[index - 1]) links |= 8;
+					if (y - 1 > 0 && !skip[index - _xRes]) links |= 16;
+					if (z - 1 > 0 && !skip[index - _slabSize]) links |= 32;
+				}
+
+				fine.diag[index] = Acenter;
+				fine.invDiag[index] = (Acenter < 1.0f) ? 0.0f : 1.0f / Acenter;
+				fine.links[index] = links;
+			}
+	}
+
+	// coarse levels
+	while (numLevels < MG_MAX_LEVELS)
+	{
+		const MG_LEVEL &f = levels[numLevels - 1];
+		if (f.res[0] <= MG_MIN_RES || f.res[1] <= MG_MIN_RES || f.res[2] <= MG_MIN_RES)
+			break;
+
+		MG_LEVEL &c = levels[numLevels++];
+		c.res[0] = (f.res[0] + 1) / 2;
+		c.res[1] = (f.res[1] + 1) / 2;
+		c.res[2] = (f.res[2] + 1) / 2;
+		c.slab = (size_t)c.res[0] * c.res[1];
+		c.total = c.slab * c.res[2];
+		c.diag = new float[c.total];
+		c.invDiag = new float[c.total];
+		c.coupling[0] = new float[c.total];
+		c.coupling[1] = new float[c.total];
+		c.coupling[2] = new float[c.total];
+		c.links = NULL;
+		c.x = new float[c.total];
+		c.b = new float[c.total];
+		c.r = new float[c.total];
+
+		mgBuildCoarse(f, c);
+	}
+
+	// r = b - Ax, border values act as fixed boundary conditions
+#if PARALLEL==1
+	#pragma omp parallel for schedule(static)
+#endif
+	for (z = 1; z < _zRes - 1; z++)
+	{
+		size_t index = z * _slabSize + _xRes + 1;
+		for (int y = 1; y < _yRes - 1; y++, index += 2)
+			for (int x = 1; x < _xRes - 1; x++, index++)
+			{
+				// cells without a preconditioner entry stay out of the solve, like P^-1 = 0 in solvePressurePre
+				if (skip[index] || fine.invDiag[index] == 0.0f)
+					continue;
+
+				_residual[index] = b[index] - (fine.diag[index] * field[index] +
+					field[index - 1] * (skip[index - 1] ? 0.0f : -1.0f) +
+					field[index + 1] * (skip[index + 1] ? 0.0f : -1.0f) +
+					field[index - _xRes] * (skip[index - _xRes] ? 0.0f : -1.0f) +
+					field[index + _xRes] * (skip[index + _xRes] ? 0.0f : -1.0f) +
+					field[index - _slabSize] * (skip[index - _slabSize] ? 0.0f : -1.0f) +
+					field[index + _slabSize] * (skip[index + _slabSize] ? 0.0f : -1.0f));
+			}
+	}
+
+	// p = M^-1 * r
+	mgVCycle(levels, 0, numLevels);
+	memcpy(_direction, _h, sizeof(float)*_totalCells);
+
+	double deltaNew = 0.0;
+#if PARALLEL==1
+	#pragma omp parallel for schedule(static)
+#endif
+	for (z = 0; z < _zRes; z++)
+	{
+		const size_t begin = z * _slabSize, end = begin + _slabSize;
+		double sum = 0.0;
+		for (size_t index = begin; index < end; index++)
+			sum += _residual[index] * _h[index];
+		_partDelta[z] = sum;
+	}
+	for (z = 0; z < _zRes; z++)
+		deltaNew += _partDelta[z];
+
+	const float eps = SOLVER_ACCURACY;
+	float maxR = 2.0f * eps;
+	int i = 0;
+
+	while ((i < _iterations) && (maxR > 0.001f * eps))
+	{
+		// q = A d
+#if PARALLEL==1
+		#pragma omp parallel for schedule(static)
+#endif
+		for (z = 0; z < _zRes; z++)
+		{
+			size_t index = z * _slabSize;
+			double sum = 0.0;
+			for (int y = 0; y < _yRes; y++)
+				for (int x = 0; x < _xRes; x++, index++)
+				{
+					_q[index] = fine.diag[index] * _direction[index] - mgNeighborSum(fine, _direction, x, y, z, index);
+					sum += _direction[index] * _q[index];
+				}
+			_partDelta[z] = sum;
+		}
+
+		double alpha = 0.0;
+		for (z = 0; z < _zRes; z++)
+			alpha += _partDelta[z];
+		if (fabs(alpha) > 0.0)
+			alpha = deltaNew / alpha;
+
+		// x = x + alpha * d, r = r - alpha * q
+#if PARALLEL==1
+		#pragma omp parallel for schedule(static)
+#endif
+		for (z = 0; z < _zRes; z++)
+		{
+			const size_t begin = z * _slabSize, end = begin + _slabSize;
+			float partMax = 0.0f;
+			for (size_t index = begin; index < end; index++)
+			{
+				field[index] += (float)alpha * _direction[index];
+				_residual[index] -= (float)alpha * _q[index];
+
+				// same measure as the jacobi preconditioned solver
+				const float tmp = _residual[index] * _residual[index] * fine.invDiag[index];
+				partMax = (tmp > partMax) ? tmp : partMax;
+			}
+			_partMax[z] = partMax;
+		}
+
+		maxR = 0.0f;
+		for (z = 0; z < _zRes; z++)
+			maxR = (_partMax[z] > maxR) ? _partMax[z] : maxR;
+
+		i++;
+		if (maxR <= 0.001f * eps)
+			break;
+
+		// h = M^-1 * r
+		mgVCycle(levels, 0, numLevels);
+
+		const double deltaOld = deltaNew;
+#if PARALLEL==1
+		#pragma omp parallel for schedule(static)
+#endif
+		for (z = 0; z < _zRes; z++)
+		{
+			const size_t begin = z * _slabSize, end = begin + _slabSize;
+			double sum = 0.0;
+			for (size_t index = begin; index < end; index++)
+				sum += _residual[index] * _h[index];
+			_partDelta[z] = sum;
+		}
+		deltaNew = 0.0;
+		for (z = 0; z < _zRes; z++)
+			deltaNew += _partDelta[z];
+
+		// d = h + beta * d
+		const float beta = (deltaOld != 0.0) ? (float)(deltaNew / deltaOld) : 0.0f;
+#if PARALLEL==1
+		#pragma omp parallel for schedule(static)
+#endif
+		for (z = 0; z < _zRes; z++)
+		{
+			const size_t begin = z * _slabSize, end = begin + _slabSize;
+			for (size_t index = begin; index < end; index++)
+				_direction[index] = _h[index] + beta * _direction[index];
+		}
+	}
+	// cout << i << " multigrid iterations converged to " << sqrt(maxR) << endl;
+
+	for (int l = 0; l < numLevels; l++)
+	{
+		delete[] levels[l].diag;
+		delete[] levels[l].invDiag;
+		delete[] levels[l].r;
+		if (l == 0)
+		{
+			delete[] levels[l].links;
+			continue;
+		}
+		delete[] levels[l].coupling[0];
+		delete[] levels[l].coupling[1];
+		delete[] levels[l].coupling[2];
+		delete[] levels[l].x;
+		delete[] levels[l].b;
+	}
+
+	delete[] _partDelta;
+	delete[] _partMax;
+	delete[] _h;
+	delete[] _residual;
+	delete[] _direction;
+	delete[] _q;
+}
@@ -624,6 +624,7 @@ class AddPresetFracture(AddPresetBase, Operator):
         "fracture.ground_vertex_group",
         "fracture.inner_vertex_group",
         "fracture.nor_range",
+        "fracture.hull_vertex_limit",
         "fracture.grease_offset",
         "fracture.grease_decimate",
         "fracture.use_greasepencil_edges",
@@ -354,6 +354,10 @@ class DATA_PT_modifiers(ModifierButtonsPanel, Panel):
     def FRACTURE(self, layout, ob, md):
         layout.label(text="Settings are inside the Physics tab")
 
+    def FRACTURE_STREAM(self, layout, ob, md):
+        layout.prop(md, "filepath")
+        layout.prop(md, "frame_offset")
+
     def HOOK(self, layout, ob, md):
         use_falloff = (md.falloff_type != 'NONE')
         split = layout.split()
@@ -85,6 +85,7 @@ class PHYSICS_PT_fracture(PhysicButtonsPanel, Panel):
         col = layout.column(align=True)
         col.prop(md, "shard_count")
         col.prop(md, "cluster_count")
+        col.prop(md, "cluster_iterations")
         col.prop(md, "point_seed")
         layout.prop(md, "cluster_group")
 
@@ -204,7 +205,17 @@ class PHYSICS_PT_fracture_utilities(PhysicButtonsPanel, Panel):
         row = layout.row()
         row.prop(md, "fix_normals")
         row.prop(md, "nor_range")
-        layout.prop(md, "execute_threaded")
+        layout.prop(md, "hull_vertex_limit")
+        row = layout.row()
+        row.prop(md, "execute_threaded")
+        sub = row.row()
+        sub.active = md.execute_threaded
+        sub.prop(md, "execute_buffered")
+        layout.prop(md, "use_disk_cache")
+        row = layout.row()
+        row.active = md.use_disk_cache
+        row.prop(md, "disk_cache_dir", text="")
+        layout.operator("object.fracture_stream_export", text="Export Fracture Stream")
 
         #layout.operator("object.rigidbody_convert_to_objects", text = "Convert To Objects")
         #layout.operator("object.rigidbody_convert_to_keyframes", text = "Convert To Keyframed Objects")
@@ -75,6 +75,9 @@ typedef struct ClothSolverResult {
 	int max_iterations, min_iterations;
 	float avg_iterations;
 	float max_error, min_error, avg_error;
+	
+	/* seconds spent over all substeps */
+	float force_time, solve_time;
 } ClothSolverResult;
 
 /**
@@ -44,6 +44,10 @@ struct Group;
 struct MeshIsland;
 struct Main;
 struct FractureState;
+struct FractureStreamCache;
+struct Scene;
+
+typedef struct FractureBuffer FractureBuffer;
 
 struct BoundBox;
 struct MVert;
@@ -94,6 +98,17 @@ void BKE_shard_free(struct Shard *s, bool doCustomData);
 struct DerivedMesh *BKE_fracture_create_dm(struct Object *ob, struct FracMesh *fm, bool doCustomData);
 struct DerivedMesh *BKE_shard_create_dm(struct Shard *s, bool doCustomData);
 
+/* per island render export */
+struct DerivedMesh *BKE_fracture_island_create_dm(struct Object *ob, struct MeshIsland *mi);
+void BKE_fracture_island_matrix_world(struct Object *ob, struct MeshIsland *mi, float r_mat[4][4]);
+
+/* streamed simulation results, see fracture_stream.c */
+bool BKE_fracture_stream_export(struct Main *bmain, struct Scene *scene, struct Object *ob, const char *filepath,
+                                int start, int end);
+struct DerivedMesh *BKE_fracture_stream_read(const char *filepath, int frame, struct FractureStreamCache **r_cache,
+                                             const char **r_err);
+void BKE_fracture_stream_cache_free(struct FractureStreamCache *cache);
+
 /* create shards from base mesh and a list of points */
 void BKE_fracture_shard_by_points(struct Object *obj, ShardID id, struct FracPointCloud *points, short inner_material_index, float mat[4][4]);
 
@@ -107,7 +122,16 @@ void BKE_select_linked(struct BMesh **bm_in);
 
 void BKE_fracture_prefracture_mesh(struct Scene *scene, struct Object *ob, ShardID id);
 void BKE_dynamic_fracture_mesh(struct Scene* scene, struct Object *ob, ShardID id);
+
+/* double buffered (threaded) prefracture, the live state stays usable until the swap */
+FractureBuffer *BKE_fracture_buffer_create(struct Scene *scene, struct Object *ob);
+void BKE_fracture_buffer_execute(struct Scene *scene, FractureBuffer *fb);
+struct FracMesh *BKE_fracture_buffer_fracmesh(FractureBuffer *fb);
+bool BKE_fracture_buffer_swap(struct Scene *scene, struct Object *ob, FractureBuffer *fb);
+void BKE_fracture_buffer_free(FractureBuffer *fb);
 int BKE_initialize_meshisland(struct MeshIsland** mii, struct MVert* mverts, int vertstart);
+void BKE_fracture_physics_mesh_ensure(struct MeshIsland *mi);
+void BKE_fracture_physics_meshes_ensure(struct FractureState *fs);
 struct DerivedMesh *BKE_fracture_autohide(struct Object* ob);
 void BKE_fracture_constraint_container_free(struct Object *ob);
 struct ConstraintContainer *BKE_fracture_constraint_container_create(struct Object* ob);
@@ -40,5 +40,6 @@ Shard *BKE_fracture_shard_boolean(struct Object *obj, DerivedMesh *dm_parent, Sh
 Shard *BKE_fracture_shard_bisect(struct BMesh *bm_orig, Shard* child, float obmat[4][4], bool use_fill,
                                  bool clear_inner, bool clear_outer, int cutlimit, float centroid[],
                                  short inner_mat_index);
+void BKE_fracture_shard_unwrap(Shard *s);
 
 #endif /* BKE_FRACTURE_UTIL_H*/
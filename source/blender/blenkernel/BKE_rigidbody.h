@@ -38,6 +38,7 @@ struct RigidBodyWorld;
 struct RigidBodyOb;
 struct RigidBodyShardCon;
 struct RigidBodyShardOb;
+struct ConstraintContainer;
 
 struct Scene;
 struct Object;
@@ -66,7 +67,7 @@ struct RigidBodyWorld *BKE_rigidbody_create_world(struct Scene *scene);
 struct RigidBodyOb *BKE_rigidbody_create_object(struct Object *ob, short type);
 struct RigidBodyCon *BKE_rigidbody_create_constraint(struct Object *ob, short type);
 struct RigidBodyShardOb *BKE_rigidbody_create_shard(struct Object *ob, struct MeshIsland *mi);
-struct RigidBodyShardCon *BKE_rigidbody_create_shard_constraint(short type);
+struct RigidBodyShardCon *BKE_rigidbody_create_shard_constraint(struct ConstraintContainer *cc, short type);
 
 void BKE_rigidbody_world_groups_relink(struct RigidBodyWorld *rbw);
 void BKE_rigidbody_set_initial_transform(struct Object *ob, struct MeshIsland *mi, struct RigidBodyShardOb *rbo);
@@ -114,7 +115,9 @@ void BKE_rigidbody_aftertrans_update(struct Object *ob, float loc[3], float rot[
 void BKE_rigidbody_sync_transforms(struct RigidBodyWorld *rbw, struct Object *ob, float ctime);
 bool BKE_rigidbody_check_sim_running(struct RigidBodyWorld *rbw, struct Object *ob, float ctime);
 void BKE_rigidbody_cache_reset(struct RigidBodyWorld *rbw);
+void BKE_rigidbody_cache_reset_transforms(struct RigidBodyWorld *rbw);
 void BKE_rigidbody_rebuild_world(struct Scene *scene, float ctime);
 void BKE_rigidbody_do_simulation(struct Scene *scene, float ctime);
+void BKE_rigidbody_free_checkpoints(struct RigidBodyWorld *rbw);
 
 #endif /* __BKE_RIGIDBODY_H__ */
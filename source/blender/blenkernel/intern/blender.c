@@ -755,6 +755,12 @@ void BKE_write_undo(bContext *C, const char *name)
 		memused = MEM_get_memory_in_use();
 		/* success = */ /* UNUSED */ BLO_write_file_mem(CTX_data_main(C), prevfile, &curundo->memfile, G.fileflags);
 		curundo->undosize = MEM_get_memory_in_use() - memused;
+
+		if (G.debug & G_DEBUG_WM) {
+			printf("undo push %s: %u bytes written, %u shared with the previous step, %u new\n",
+			       curundo->name, curundo->memfile.size_total,
+			       curundo->memfile.size_total - curundo->memfile.size, curundo->memfile.size);
+		}
 	}
 
 	if (U.undomemory != 0) {
@@ -35,6 +35,9 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "atomic_ops.h"
+
+#include "BKE_appdir.h"
 #include "BKE_cdderivedmesh.h"
 #include "BKE_curve.h"
 #include "BKE_customdata.h"
@@ -59,7 +62,9 @@
 #include "BKE_scene.h"
 
 #include "BLI_edgehash.h"
+#include "BLI_fileops.h"
 #include "BLI_ghash.h"
+#include "BLI_hash_md5.h"
 #include "BLI_kdtree.h"
 #include "BLI_listbase.h"
 #include "BLI_math.h"
@@ -70,6 +75,7 @@
 #include "BLI_rand.h"
 #include "BLI_sort.h"
 #include "BLI_string.h"
+#include "BLI_task.h"
 #include "BLI_threads.h"
 #include "BLI_utildefines.h"
 
@@ -110,9 +116,10 @@ static void parse_cell_verts(cell c, MVert *mvert, int totvert);
 static void parse_cell_polys(cell c, MPoly *mpoly, int totpoly, int *r_totloop);
 static void parse_cell_loops(cell c, MLoop *mloop, int totloop, MPoly *mpoly, int totpoly);
 static void parse_cell_neighbors(cell c, int *neighbors, int totpoly);
-static void do_island_from_shard(Object *ob, Shard* s, int i, int thresh_defgrp_index, int ground_defgrp_index, int vertstart);
+static void do_island_from_shard(Object *ob, Shard* s, int thresh_defgrp_index, int ground_defgrp_index, int vertstart);
 static void do_island_vertex_index_map(Object *ob, GHash **vertex_index_map, int partner_index);
 static void initialize_shard(Object *ob);
+static void prefracture_state(Scene *scene, Object *ob, ShardID id);
 static void update_islands(Object *ob);
 
 static bool thread_sentinel(Object *ob)
@@ -161,6 +168,21 @@ static void copy_shard(Shard *t, Shard *s)
 	                     CustomData_get_layer(&s->loopData, CD_MLOOPUV), s->totloop);
 	CustomData_add_layer(&t->polyData, CD_MTEXPOLY, CD_DUPLICATE,
 	                     CustomData_get_layer(&s->polyData, CD_MTEXPOLY), s->totpoly);
+
+	t->cluster_colors = s->cluster_colors ? MEM_dupallocN(s->cluster_colors) : NULL;
+	t->neighbor_ids = s->neighbor_ids ? MEM_dupallocN(s->neighbor_ids) : NULL;
+	t->neighbor_count = s->neighbor_ids ? s->neighbor_count : 0;
+
+	copy_v3_v3(t->min, s->min);
+	copy_v3_v3(t->max, s->max);
+	copy_v3_v3(t->centroid, s->centroid);
+	copy_v3_v3(t->raw_centroid, s->raw_centroid);
+	copy_v3_v3(t->impact_loc, s->impact_loc);
+	copy_v3_v3(t->impact_size, s->impact_size);
+	t->shard_id = s->shard_id;
+	t->parent_id = s->parent_id;
+	t->flag = s->flag;
+	t->raw_volume = s->raw_volume;
 }
 
 FracMesh* BKE_copy_fracmesh(FracMesh* fm)
@@ -185,10 +207,60 @@ FracMesh* BKE_copy_fracmesh(FracMesh* fm)
 	fmesh->progress_counter = 0;
 	fmesh->last_shard_tree = NULL;
 	fmesh->last_shards = NULL;
+	fmesh->last_expected_shards = 0;
+	fmesh->users = 1;
 
 	return fmesh;
 }
 
+/* FracMesh.users is changed with atomic ops only, states of different objects may be copied or freed
+ * while a fracture job of another object runs */
+static void fracmesh_user_add(FracMesh *fm)
+{
+	atomic_add_uint32((uint32_t *)&fm->users, 1);
+}
+
+/* returns true if this was the last user, the caller frees fm then */
+static bool fracmesh_user_remove(FracMesh *fm)
+{
+	return atomic_sub_uint32((uint32_t *)&fm->users, 1) == 0;
+}
+
+/* copied containers share the shard map of the original, give fs its own copy before changing shards */
+static void fracmesh_ensure_unique(FractureState *fs)
+{
+	FracMesh *fm = fs->frac_mesh;
+	GHash *shard_map;
+	Shard *s, *t;
+	MeshIsland *mi;
+
+	if (fm == NULL || fm->users < 2) {
+		return;
+	}
+
+	fs->frac_mesh = BKE_copy_fracmesh(fm);
+
+	/* islands which did not build their physics mesh yet still point into the shared map */
+	shard_map = BLI_ghash_ptr_new("fracmesh_ensure_unique");
+	for (s = fm->shard_map.first, t = fs->frac_mesh->shard_map.first; s && t; s = s->next, t = t->next) {
+		BLI_ghash_insert(shard_map, s, t);
+	}
+
+	for (mi = fs->island_map.first; mi; mi = mi->next) {
+		if (mi->shard) {
+			mi->shard = BLI_ghash_lookup(shard_map, mi->shard);
+		}
+	}
+
+	BLI_ghash_free(shard_map, NULL, NULL);
+
+	/* the other users may have gone away since the check above */
+	if (fracmesh_user_remove(fm)) {
+		BKE_fracmesh_free(fm, true);
+		MEM_freeN(fm);
+	}
+}
+
 static void freeMeshIsland(Scene *scene, MeshIsland *mi)
 {
 	if (mi->physics_mesh) {
@@ -273,6 +345,15 @@ static void free_meshislands(Scene *scene, ListBase* meshIslands)
 
 static void free_shards(FracMesh *fm)
 {
+	if (fm == NULL) {
+		return;
+	}
+
+	/* still in use by a copied container */
+	if (!fracmesh_user_remove(fm)) {
+		return;
+	}
+
 	BKE_fracmesh_free(fm, true);
 	MEM_freeN(fm);
 	fm = NULL;
@@ -283,6 +364,7 @@ static void free_fracture_state(Scene *scene, FractureState *fs, bool delete_all
 {
 	//BLI_mutex_lock(&free_fracture_state_lock);
 
+	/* islands go first, lazy ones still borrow their shard from fs->frac_mesh */
 	free_meshislands(scene, &fs->island_map);
 
 	if (fs->islands) {
@@ -308,6 +390,8 @@ static void free_fracture_state(Scene *scene, FractureState *fs, bool delete_all
 	//BLI_mutex_unlock(&free_fracture_state_lock);
 }
 
+static void free_fracture_runtime(FractureContainer *fc);
+
 static void free_fracture_container(Scene *scene, FractureContainer *fc)
 {
 	FractureState *fs;
@@ -332,6 +416,11 @@ static void free_fracture_container(Scene *scene, FractureContainer *fc)
 		fc->effector_weights = NULL;
 	}
 
+	free_fracture_runtime(fc);
+}
+
+static void free_fracture_runtime(FractureContainer *fc)
+{
 	//maybe make those temporary.... and dont store ?
 	if (fc->vertex_island_map) {
 		BLI_ghash_free(fc->vertex_island_map, NULL, NULL);
@@ -349,15 +438,59 @@ static void free_fracture_container(Scene *scene, FractureContainer *fc)
 	}
 }
 
+typedef struct ClusterAssignData {
+	MeshIsland **islands;
+	KDTree *tree;
+	int *assign;
+} ClusterAssignData;
+
+static void cluster_assign_task(void *userdata, int iter)
+{
+	ClusterAssignData *data = userdata;
+	KDTreeNearest n;
+
+	data->assign[iter] = BLI_kdtree_find_nearest(data->tree, data->islands[iter]->centroid, &n);
+}
+
+/* assign each shard to its closest center, returns how many shards changed their cluster */
+static int cluster_assign(MeshIsland **islands, int mi_count, float (*centers)[3], int seed_count, int *assign, int *next)
+{
+	ClusterAssignData data;
+	int i, changed = 0;
+
+	data.islands = islands;
+	data.assign = next;
+	data.tree = BLI_kdtree_new(seed_count);
+
+	for (i = 0; i < seed_count; i++) {
+		BLI_kdtree_insert(data.tree, i, centers[i]);
+	}
+
+	BLI_kdtree_balance(data.tree);
+	BLI_task_parallel_range(0, mi_count, &data, cluster_assign_task);
+	BLI_kdtree_free(data.tree);
+
+	for (i = 0; i < mi_count; i++) {
+		if (assign[i] != next[i]) {
+			assign[i] = next[i];
+			changed++;
+		}
+	}
+
+	return changed;
+}
+
+/* k-means over the island centroids, starting from evenly picked islands as seeds; with no
+ * iterations the shards are just assigned to their closest seed */
 static void do_cluster_count(FractureContainer *fc)
 {
 	FractureState *fs = fc->current;
-	int k = 0;
-	KDTree *tree;
-	MeshIsland *mi, **seeds;
-	int seed_count;
+	MeshIsland *mi, **islands;
+	float (*centers)[3];
+	int *assign, *next, *counts;
+	int i, k, iter, seed_count, mi_count, changed;
+	double start;
 
-	int mi_count;
 	/* zero clusters or one mean no clusters, all shards keep free */
 	if (fc->cluster_count < 2) {
 		return;
@@ -369,33 +502,69 @@ static void do_cluster_count(FractureContainer *fc)
 	}
 
 	mi_count = BLI_listbase_count(&fs->island_map);
+	if (mi_count == 0) {
+		return;
+	}
+
+	start = PIL_check_seconds_timer();
 	seed_count = (fc->cluster_count > mi_count ? mi_count : fc->cluster_count);
-	seeds = MEM_mallocN(sizeof(MeshIsland *) * seed_count, "seeds");
-	tree = BLI_kdtree_new(seed_count);
+	islands = MEM_mallocN(sizeof(MeshIsland *) * mi_count, "cluster islands");
+	centers = MEM_mallocN(sizeof(float) * 3 * seed_count, "cluster centers");
+	counts = MEM_mallocN(sizeof(int) * seed_count, "cluster counts");
+	assign = MEM_mallocN(sizeof(int) * mi_count, "cluster assign");
+	next = MEM_mallocN(sizeof(int) * mi_count, "cluster assign next");
+
+	for (i = 0, mi = fs->island_map.first; mi; i++, mi = mi->next) {
+		islands[i] = mi;
+		assign[i] = -1;
+	}
 
 	/* pick n seed locations, randomly scattered over the object */
 	for (k = 0; k < seed_count; k++) {
-		int which_index = k * (int)(mi_count / seed_count);
-		MeshIsland *which = (MeshIsland *)BLI_findlink(&fs->island_map, which_index);
-		which->particle_index = k;
-		BLI_kdtree_insert(tree, k, which->centroid);
-		seeds[k] = which;
+		copy_v3_v3(centers[k], islands[k * (mi_count / seed_count)]->centroid);
 	}
 
-	BLI_kdtree_balance(tree);
+	cluster_assign(islands, mi_count, centers, seed_count, assign, next);
 
+	/* Lloyd iterations, move each center to the mean of its shards and reassign until stable */
+	for (iter = 0; iter < fc->cluster_iterations; iter++) {
+		memset(centers, 0, sizeof(float) * 3 * seed_count);
+		memset(counts, 0, sizeof(int) * seed_count);
 
-	/* assign each shard to its closest center */
-	for (mi = fs->island_map.first; mi; mi = mi->next ) {
-		KDTreeNearest n;
-		int index;
+		for (i = 0; i < mi_count; i++) {
+			add_v3_v3(centers[assign[i]], islands[i]->centroid);
+			counts[assign[i]]++;
+		}
+
+		for (k = 0; k < seed_count; k++) {
+			if (counts[k] > 0) {
+				mul_v3_fl(centers[k], 1.0f / (float)counts[k]);
+			}
+			else {
+				/* empty cluster, restart it at its seed */
+				copy_v3_v3(centers[k], islands[k * (mi_count / seed_count)]->centroid);
+			}
+		}
+
+		changed = cluster_assign(islands, mi_count, centers, seed_count, assign, next);
+		if (changed == 0) {
+			iter++;
+			break;
+		}
+	}
 
-		index = BLI_kdtree_find_nearest(tree, mi->centroid, &n);
-		mi->particle_index = seeds[index]->particle_index;
+	for (i = 0; i < mi_count; i++) {
+		islands[i]->particle_index = assign[i];
 	}
 
-	BLI_kdtree_free(tree);
-	MEM_freeN(seeds);
+	printf("Clustering %d shards into %d clusters done, %d iterations, %g\n", mi_count, seed_count, iter,
+	       PIL_check_seconds_timer() - start);
+
+	MEM_freeN(islands);
+	MEM_freeN(centers);
+	MEM_freeN(counts);
+	MEM_freeN(assign);
+	MEM_freeN(next);
 }
 
 static void do_cluster_group(Object* obj)
@@ -470,44 +639,84 @@ static KDTree *build_nor_tree(DerivedMesh *dm)
 	return tree;
 }
 
-static void find_normal(DerivedMesh *dm, KDTree *tree, float co[3], short no[3], short rno[3], float range)
+/* number of original vertices checked per normal lookup, results live on the stack */
+#define NOR_NEAREST_MAX 8
+
+static void find_normal(MVert *orig_mvert, KDTree *tree, const float co[3], const short no[3], short rno[3], float range)
 {
-	KDTreeNearest *n = NULL, n2;
-	int index = 0, i = 0, count = 0;
-	MVert mvert;
+	KDTreeNearest n[NOR_NEAREST_MAX];
+	int i = 0, count = 0;
 	float fno[3], vno[3];
 
 	normal_short_to_float_v3(fno, no);
 
-	count = BLI_kdtree_range_search(tree, co, &n, range);
-	for (i = 0; i < count; i++)
+	/* sorted by distance, take the closest original normal pointing in the same direction */
+	count = BLI_kdtree_find_nearest_n(tree, co, n, NOR_NEAREST_MAX);
+	for (i = 0; i < count && n[i].dist <= range; i++)
 	{
-		index = n[i].index;
-		dm->getVert(dm, index, &mvert);
-		normal_short_to_float_v3(vno, mvert.no);
-		if ((dot_v3v3(fno, vno) > 0.0f)){
-			copy_v3_v3_short(rno, mvert.no);
-			if (n != NULL) {
-				MEM_freeN(n);
-				n = NULL;
-			}
+		const short *ono = orig_mvert[n[i].index].no;
+		normal_short_to_float_v3(vno, ono);
+		if ((dot_v3v3(fno, vno) > 0.0f)) {
+			copy_v3_v3_short(rno, ono);
 			return;
 		}
 	}
 
-	if (n != NULL) {
-		MEM_freeN(n);
-		n = NULL;
+	/*fallback if no valid normal in searchrange....*/
+	if (count > 0) {
+		copy_v3_v3_short(rno, orig_mvert[n[0].index].no);
 	}
+	else {
+		copy_v3_v3_short(rno, no);
+	}
+}
 
-	/*fallback if no valid normal in searchrange....*/
-	BLI_kdtree_find_nearest(tree, co, &n2);
-	index = n2.index;
-	dm->getVert(dm, index, &mvert);
-	copy_v3_v3_short(rno, mvert.no);
+typedef struct FixNormalsData {
+	KDTree *tree;
+	MVert *orig_mvert;
+	MVert *mvert;
+	float range;
+} FixNormalsData;
+
+static void fix_normals_task(void *userdata, int index)
+{
+	FixNormalsData *data = userdata;
+	MVert *mv = data->mvert + index;
+	short no[3];
+
+	find_normal(data->orig_mvert, data->tree, mv->co, mv->no, no, data->range);
+	copy_v3_v3_short(mv->no, no);
 }
 
+/* transfer the original normals to all shard vertices in one parallel pass over the visual mesh,
+ * and hand them to the islands afterwards, their vertices point into the visual mesh */
+static void do_fix_normals_islands(Object *ob)
+{
+	FractureContainer *fc = ob->rigidbody_object->fracture_objects;
+	DerivedMesh *dm = fc->current->visual_mesh;
+	FixNormalsData data;
+	MeshIsland *mi;
+	int totvert = dm->getNumVerts(dm);
+
+	data.tree = fc->nor_tree;
+	data.orig_mvert = fc->raw_mesh->getVertArray(fc->raw_mesh);
+	data.mvert = CDDM_get_verts(dm);
+	data.range = fc->nor_range;
 
+	if (totvert > 0) {
+		BLI_task_parallel_range(0, totvert, &data, fix_normals_task);
+	}
+
+	for (mi = fc->current->island_map.first; mi; mi = mi->next) {
+		MVert *verts = mi->physics_mesh->getVertArray(mi->physics_mesh);
+		int j;
+
+		for (j = 0; j < mi->vertex_count; j++) {
+			copy_v3_v3_short(mi->vertnos[j], mi->vertices_cached[j]->no);
+			copy_v3_v3_short(verts[j].no, mi->vertnos[j]);
+		}
+	}
+}
 
 static int getGroupObjects(Group *gr, Object ***obs, int g_exist)
 {
@@ -663,6 +872,174 @@ static void points_from_greasepencil(Object **ob, int totobj, Object* obj, float
 	points->totpoints = pt;
 }
 
+typedef struct PoissonGrid {
+	float min[3];
+	float cell;
+	int res[3];
+	int *cells; /* sample index per cell, -1 if empty */
+} PoissonGrid;
+
+static int poisson_cell_index(PoissonGrid *grid, const float co[3], int r_cell[3])
+{
+	int d;
+	for (d = 0; d < 3; d++) {
+		r_cell[d] = (int)((co[d] - grid->min[d]) / grid->cell);
+		CLAMP(r_cell[d], 0, grid->res[d] - 1);
+	}
+
+	return (r_cell[2] * grid->res[1] + r_cell[1]) * grid->res[0] + r_cell[0];
+}
+
+static bool poisson_is_free(PoissonGrid *grid, float (*samples)[3], const float co[3], float radius)
+{
+	int cell[3], x, y, z;
+	const float radius_sq = radius * radius;
+
+	poisson_cell_index(grid, co, cell);
+
+	/* cell size is radius / sqrt(3), so conflicting samples can be up to 2 cells away */
+	for (z = max_ii(cell[2] - 2, 0); z <= min_ii(cell[2] + 2, grid->res[2] - 1); z++) {
+		for (y = max_ii(cell[1] - 2, 0); y <= min_ii(cell[1] + 2, grid->res[1] - 1); y++) {
+			for (x = max_ii(cell[0] - 2, 0); x <= min_ii(cell[0] + 2, grid->res[0] - 1); x++) {
+				int index = grid->cells[(z * grid->res[1] + y) * grid->res[0] + x];
+				if (index != -1 && len_squared_v3v3(samples[index], co) < radius_sq) {
+					return false;
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+/* Bridson's poisson disk sampling inside the box min / max, returns the number of samples
+ * written to r_samples (allocated here), the grid acts as spatial hash holding one sample per cell */
+static int poisson_disk_samples(RNG *rng, const float min[3], const float size[3], float radius, float (**r_samples)[3])
+{
+	const int attempts = 30;
+	PoissonGrid grid;
+	float (*samples)[3];
+	int *active;
+	int totcell, active_count = 0, sample_count = 0, d, cell[3];
+
+	copy_v3_v3(grid.min, min);
+	grid.cell = radius / (float)M_SQRT3;
+	for (d = 0; d < 3; d++) {
+		grid.res[d] = max_ii((int)ceilf(size[d] / grid.cell), 1);
+	}
+
+	totcell = grid.res[0] * grid.res[1] * grid.res[2];
+	grid.cells = MEM_mallocN(sizeof(int) * totcell, "poisson grid");
+	fill_vn_i(grid.cells, totcell, -1);
+
+	/* each cell holds at most one sample, so this is an upper bound */
+	samples = MEM_mallocN(sizeof(float) * 3 * totcell, "poisson samples");
+	active = MEM_mallocN(sizeof(int) * totcell, "poisson active");
+
+	for (d = 0; d < 3; d++) {
+		samples[0][d] = min[d] + size[d] * BLI_rng_get_float(rng);
+	}
+	grid.cells[poisson_cell_index(&grid, samples[0], cell)] = 0;
+	active[active_count++] = 0;
+	sample_count++;
+
+	while (active_count > 0) {
+		int a = BLI_rng_get_int(rng) % active_count;
+		float *origin = samples[active[a]];
+		bool found = false;
+		int k;
+
+		for (k = 0; k < attempts; k++) {
+			float co[3], dir[3];
+			bool inside = true;
+
+			/* candidate in the spherical shell between radius and 2 * radius */
+			BLI_rng_get_float_unit_v3(rng, dir);
+			madd_v3_v3v3fl(co, origin, dir, radius * (1.0f + BLI_rng_get_float(rng)));
+
+			for (d = 0; d < 3; d++) {
+				if (co[d] < min[d] || co[d] > min[d] + size[d]) {
+					inside = false;
+				}
+			}
+
+			if (inside && poisson_is_free(&grid, samples, co, radius)) {
+				copy_v3_v3(samples[sample_count], co);
+				grid.cells[poisson_cell_index(&grid, co, cell)] = sample_count;
+				active[active_count++] = sample_count;
+				sample_count++;
+				found = true;
+				break;
+			}
+		}
+
+		if (!found) {
+			active[a] = active[--active_count];
+		}
+	}
+
+	MEM_freeN(active);
+	MEM_freeN(grid.cells);
+
+	*r_samples = samples;
+	return sample_count;
+}
+
+/* evenly spaced (blue noise) point cloud with count points over the bounding box, gives much more uniform
+ * shard sizes than the random uniform source */
+static void points_from_poisson(const float min[3], const float max[3], int count, int seed, FracPointCloud *points)
+{
+	float size[3], origin[3], extent, volume, radius;
+	float (*samples)[3] = NULL;
+	int sample_count = 0, i, d, iter;
+	RNG *rng;
+
+	if (count <= 0) {
+		return;
+	}
+
+	sub_v3_v3v3(size, max, min);
+	extent = max_fff(size[0], size[1], size[2]);
+	if (extent <= 0.0f) {
+		return;
+	}
+
+	/* give flat objects some thickness, else the sample radius collapses */
+	for (d = 0; d < 3; d++) {
+		float pad = max_ff(size[d], extent * 0.01f) - size[d];
+		size[d] += pad;
+		origin[d] = min[d] - pad * 0.5f;
+	}
+
+	/* bridson sampling reaches roughly 0.6 * volume / radius^3 points, aim a bit denser and
+	 * pick a random subset of the result, shrink the radius if it still wasn't enough */
+	volume = size[0] * size[1] * size[2];
+	radius = cbrtf(0.5f * volume / (float)count);
+	rng = BLI_rng_new(seed);
+
+	for (iter = 0; iter < 4; iter++) {
+		sample_count = poisson_disk_samples(rng, origin, size, radius, &samples);
+		if (sample_count >= count || iter == 3) {
+			break;
+		}
+
+		MEM_freeN(samples);
+		radius *= 0.8f;
+	}
+
+	BLI_rng_shuffle_array(rng, samples, sizeof(float) * 3, sample_count);
+	sample_count = min_ii(sample_count, count);
+
+	points->points = MEM_reallocN(points->points, sizeof(FracPoint) * (points->totpoints + sample_count));
+	for (i = 0; i < sample_count; i++) {
+		copy_v3_v3(points->points[points->totpoints].co, samples[i]);
+		points->totpoints++;
+	}
+
+	MEM_freeN(samples);
+	BLI_rng_free(rng);
+}
+
 static FracPointCloud get_points_global(Scene* scene, Object *ob, ShardID id)
 {
 	FracPointCloud points;
@@ -711,7 +1088,7 @@ static FracPointCloud get_points_global(Scene* scene, Object *ob, ShardID id)
 
 
 	/* local settings, apply per shard!!! Or globally too first. */
-	if (fc->point_source & MOD_FRACTURE_UNIFORM)
+	if (fc->point_source & (MOD_FRACTURE_UNIFORM | MOD_FRACTURE_POISSON))
 	{
 		int count = fc->shard_count;
 		INIT_MINMAX(min, max);
@@ -728,8 +1105,12 @@ static FracPointCloud get_points_global(Scene* scene, Object *ob, ShardID id)
 			}
 		}
 
+		if (fc->point_source & MOD_FRACTURE_POISSON) {
+			points_from_poisson(min, max, (int)(count * thresh), fc->point_seed, &points);
+		}
+
 		BLI_srandom(fc->point_seed);
-		for (i = 0; i < count; ++i) {
+		for (i = 0; (fc->point_source & MOD_FRACTURE_UNIFORM) && i < count; ++i) {
 			if (BLI_frand() < thresh) {
 				float *co;
 				points.points = MEM_reallocN(points.points, sizeof(FracPoint) * (points.totpoints + 1));
@@ -898,6 +1279,486 @@ static void cleanup_splinters(Object* ob, float mat[4][4])
 	}
 }
 
+/* On disk fracture cache
+ *
+ * Prefracture results are stored in a compact binary file named after a hash of everything the
+ * fracture depends on: the raw mesh, the final point cloud (so point source, seed, count etc are
+ * covered implicitly) and the algorithm settings. Refracturing with identical inputs, also after
+ * reloading the file or on another machine sharing the cache dir, loads the shards instead. */
+
+#define FRACTURE_CACHE_MAGIC "FMSC"
+#define FRACTURE_CACHE_VERSION 2
+
+enum {
+	FRACTURE_CACHE_DVERT   = (1 << 0),
+	FRACTURE_CACHE_LOOPUV  = (1 << 1),
+	FRACTURE_CACHE_TEXPOLY = (1 << 2),
+};
+
+/* written after the magic, files from machines with another layout are ignored (and rewritten) */
+typedef struct FractureCacheHeader {
+	int version;
+	char endian, sizeof_short, sizeof_int, sizeof_float;
+	int count;
+} FractureCacheHeader;
+
+/* fixed size part of each stored shard, 4 byte fields only so there is no padding */
+typedef struct FractureCacheShard {
+	int totvert, totpoly, totloop;
+	int shard_id, parent_id, flag;
+	int neighbor_count, layers;
+	float min[3], max[3];
+	float centroid[3], raw_centroid[3];
+	float impact_loc[3], impact_size[3];
+	float raw_volume;
+} FractureCacheShard;
+
+/* returns false if the result depends on data which can't be hashed here (other objects geometry) */
+static bool fracture_cache_path(Object *ob, FracPointCloud *points, short mat_index, char r_path[FILE_MAX])
+{
+	FractureContainer *fc = ob->rigidbody_object->fracture_objects;
+	DerivedMesh *dm = fc->raw_mesh;
+	BLI_HashMD5 key;
+	MVert *mvert;
+	MPoly *mpoly;
+	MLoop *mloop;
+	MDeformVert *dvert;
+	MLoopUV *mluv;
+	const int version = FRACTURE_CACHE_VERSION;
+	const int flag = fc->flag & (FM_FLAG_USE_SMOOTH | FM_FLAG_SHARDS_TO_ISLANDS);
+	char dir[FILE_MAX], hex[33];
+	unsigned char digest[16];
+	int i, totvert, totpoly, totloop;
+
+	if ((fc->flag & FM_FLAG_USE_GREASEPENCIL_EDGES) || fc->cutter_group != NULL || dm == NULL)
+		return false;
+
+	BLI_hash_md5_init(&key);
+	BLI_hash_md5_add(&key, &version, sizeof(int));
+	BLI_hash_md5_add(&key, &fc->frac_algorithm, sizeof(int));
+	BLI_hash_md5_add(&key, &fc->fractal_cuts, sizeof(int));
+	BLI_hash_md5_add(&key, &fc->fractal_iterations, sizeof(int));
+	BLI_hash_md5_add(&key, &fc->fractal_amount, sizeof(float));
+	BLI_hash_md5_add(&key, &fc->splinter_axis, sizeof(int));
+	BLI_hash_md5_add(&key, &fc->splinter_length, sizeof(float));
+	BLI_hash_md5_add(&key, &flag, sizeof(int));
+	BLI_hash_md5_add(&key, &mat_index, sizeof(short));
+
+	for (i = 0; i < points->totpoints; i++) {
+		BLI_hash_md5_add(&key, points->points[i].co, sizeof(float) * 3);
+	}
+
+	totvert = dm->getNumVerts(dm);
+	mvert = dm->getVertArray(dm);
+	for (i = 0; i < totvert; i++) {
+		BLI_hash_md5_add(&key, mvert[i].co, sizeof(float) * 3);
+	}
+
+	/* topology only, poly flags carry selection and hide state which must not invalidate the cache */
+	totpoly = dm->getNumPolys(dm);
+	mpoly = dm->getPolyArray(dm);
+	for (i = 0; i < totpoly; i++) {
+		BLI_hash_md5_add(&key, &mpoly[i].loopstart, sizeof(int));
+		BLI_hash_md5_add(&key, &mpoly[i].totloop, sizeof(int));
+		BLI_hash_md5_add(&key, &mpoly[i].mat_nr, sizeof(short));
+	}
+
+	totloop = dm->getNumLoops(dm);
+	mloop = dm->getLoopArray(dm);
+	for (i = 0; i < totloop; i++) {
+		BLI_hash_md5_add(&key, &mloop[i].v, sizeof(unsigned int));
+	}
+
+	mluv = CustomData_get_layer(&dm->loopData, CD_MLOOPUV);
+	if (mluv) {
+		for (i = 0; i < totloop; i++) {
+			BLI_hash_md5_add(&key, mluv[i].uv, sizeof(float) * 2);
+		}
+	}
+
+	dvert = CustomData_get_layer(&dm->vertData, CD_MDEFORMVERT);
+	if (dvert) {
+		for (i = 0; i < totvert; i++) {
+			int j;
+			for (j = 0; j < dvert[i].totweight; j++) {
+				BLI_hash_md5_add(&key, &dvert[i].dw[j].def_nr, sizeof(int));
+				BLI_hash_md5_add(&key, &dvert[i].dw[j].weight, sizeof(float));
+			}
+		}
+	}
+
+	BLI_hash_md5_finish(&key, digest);
+	BLI_hash_md5_to_hexdigest(digest, hex);
+
+	if (fc->disk_cache_dir[0]) {
+		BLI_strncpy(dir, fc->disk_cache_dir, sizeof(dir));
+		BLI_path_abs(dir, G.main->name);
+	}
+	else {
+		BLI_make_file_string("/", dir, BKE_tempdir_base(), "fracture_cache");
+	}
+
+	BLI_join_dirfile(r_path, FILE_MAX, dir, hex);
+	BLI_ensure_extension(r_path, FILE_MAX, ".fmcache");
+
+	return true;
+}
+
+static void fracture_cache_header_init(FractureCacheHeader *header, int count)
+{
+	memset(header, 0, sizeof(*header));
+	header->version = FRACTURE_CACHE_VERSION;
+	header->endian = ENDIAN_ORDER;
+	header->sizeof_short = sizeof(short);
+	header->sizeof_int = sizeof(int);
+	header->sizeof_float = sizeof(float);
+	header->count = count;
+}
+
+/* Mesh data is written field by field into flat arrays of fixed size types, never as host structs
+ * (MTexPoly holds a pointer, and struct padding may differ between compilers) */
+
+static bool fracture_cache_write_geometry(FILE *fp, Shard *s)
+{
+	float (*co)[3] = MEM_mallocN(sizeof(*co) * s->totvert, "fracture cache co");
+	short (*no)[3] = MEM_mallocN(sizeof(*no) * s->totvert, "fracture cache no");
+	char (*vflag)[2] = MEM_mallocN(sizeof(*vflag) * s->totvert, "fracture cache vflag");
+	int (*poly)[2] = MEM_mallocN(sizeof(*poly) * s->totpoly, "fracture cache poly");
+	short *mat_nr = MEM_mallocN(sizeof(*mat_nr) * s->totpoly, "fracture cache mat_nr");
+	char *pflag = MEM_mallocN(sizeof(*pflag) * s->totpoly, "fracture cache pflag");
+	unsigned int (*loop)[2] = MEM_mallocN(sizeof(*loop) * s->totloop, "fracture cache loop");
+	bool ok = true;
+	int i;
+
+	for (i = 0; i < s->totvert; i++) {
+		copy_v3_v3(co[i], s->mvert[i].co);
+		copy_v3_v3_short(no[i], s->mvert[i].no);
+		vflag[i][0] = s->mvert[i].flag;
+		vflag[i][1] = s->mvert[i].bweight;
+	}
+
+	for (i = 0; i < s->totpoly; i++) {
+		poly[i][0] = s->mpoly[i].loopstart;
+		poly[i][1] = s->mpoly[i].totloop;
+		mat_nr[i] = s->mpoly[i].mat_nr;
+		pflag[i] = s->mpoly[i].flag;
+	}
+
+	for (i = 0; i < s->totloop; i++) {
+		loop[i][0] = s->mloop[i].v;
+		loop[i][1] = s->mloop[i].e;
+	}
+
+	ok &= fwrite(co, sizeof(*co), s->totvert, fp) == s->totvert;
+	ok &= fwrite(no, sizeof(*no), s->totvert, fp) == s->totvert;
+	ok &= fwrite(vflag, sizeof(*vflag), s->totvert, fp) == s->totvert;
+	ok &= fwrite(poly, sizeof(*poly), s->totpoly, fp) == s->totpoly;
+	ok &= fwrite(mat_nr, sizeof(*mat_nr), s->totpoly, fp) == s->totpoly;
+	ok &= fwrite(pflag, sizeof(*pflag), s->totpoly, fp) == s->totpoly;
+	ok &= fwrite(loop, sizeof(*loop), s->totloop, fp) == s->totloop;
+
+	MEM_freeN(co);
+	MEM_freeN(no);
+	MEM_freeN(vflag);
+	MEM_freeN(poly);
+	MEM_freeN(mat_nr);
+	MEM_freeN(pflag);
+	MEM_freeN(loop);
+
+	return ok;
+}
+
+static bool fracture_cache_read_geometry(FILE *fp, Shard *s)
+{
+	float (*co)[3] = MEM_mallocN(sizeof(*co) * s->totvert, "fracture cache co");
+	short (*no)[3] = MEM_mallocN(sizeof(*no) * s->totvert, "fracture cache no");
+	char (*vflag)[2] = MEM_mallocN(sizeof(*vflag) * s->totvert, "fracture cache vflag");
+	int (*poly)[2] = MEM_mallocN(sizeof(*poly) * s->totpoly, "fracture cache poly");
+	short *mat_nr = MEM_mallocN(sizeof(*mat_nr) * s->totpoly, "fracture cache mat_nr");
+	char *pflag = MEM_mallocN(sizeof(*pflag) * s->totpoly, "fracture cache pflag");
+	unsigned int (*loop)[2] = MEM_mallocN(sizeof(*loop) * s->totloop, "fracture cache loop");
+	bool ok = true;
+	int i;
+
+	ok &= fread(co, sizeof(*co), s->totvert, fp) == s->totvert;
+	ok &= fread(no, sizeof(*no), s->totvert, fp) == s->totvert;
+	ok &= fread(vflag, sizeof(*vflag), s->totvert, fp) == s->totvert;
+	ok &= fread(poly, sizeof(*poly), s->totpoly, fp) == s->totpoly;
+	ok &= fread(mat_nr, sizeof(*mat_nr), s->totpoly, fp) == s->totpoly;
+	ok &= fread(pflag, sizeof(*pflag), s->totpoly, fp) == s->totpoly;
+	ok &= fread(loop, sizeof(*loop), s->totloop, fp) == s->totloop;
+
+	if (ok) {
+		memset(s->mpoly, 0, sizeof(MPoly) * s->totpoly);
+		memset(s->mloop, 0, sizeof(MLoop) * s->totloop);
+
+		for (i = 0; i < s->totvert; i++) {
+			copy_v3_v3(s->mvert[i].co, co[i]);
+			copy_v3_v3_short(s->mvert[i].no, no[i]);
+			s->mvert[i].flag = vflag[i][0];
+			s->mvert[i].bweight = vflag[i][1];
+		}
+
+		for (i = 0; i < s->totpoly; i++) {
+			s->mpoly[i].loopstart = poly[i][0];
+			s->mpoly[i].totloop = poly[i][1];
+			s->mpoly[i].mat_nr = mat_nr[i];
+			s->mpoly[i].flag = pflag[i];
+			ok &= poly[i][0] >= 0 && poly[i][1] >= 0 && poly[i][0] + poly[i][1] <= s->totloop;
+		}
+
+		for (i = 0; i < s->totloop; i++) {
+			s->mloop[i].v = loop[i][0];
+			s->mloop[i].e = loop[i][1];
+			ok &= loop[i][0] < (unsigned int)s->totvert;
+		}
+	}
+
+	MEM_freeN(co);
+	MEM_freeN(no);
+	MEM_freeN(vflag);
+	MEM_freeN(poly);
+	MEM_freeN(mat_nr);
+	MEM_freeN(pflag);
+	MEM_freeN(loop);
+
+	return ok;
+}
+
+static void fracture_cache_write(FracMesh *fm, const char *path)
+{
+	char tmp_path[FILE_MAX];
+	FractureCacheHeader header;
+	Shard *s;
+	FILE *fp;
+	bool ok = true;
+
+	BLI_make_existing_file(path);
+
+	BLI_snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+	fp = BLI_fopen(tmp_path, "wb");
+	if (fp == NULL)
+		return;
+
+	fracture_cache_header_init(&header, BLI_listbase_count(&fm->shard_map));
+	ok &= fwrite(FRACTURE_CACHE_MAGIC, 4, 1, fp) == 1;
+	ok &= fwrite(&header, sizeof(header), 1, fp) == 1;
+
+	for (s = fm->shard_map.first; s && ok; s = s->next) {
+		FractureCacheShard cs;
+		MDeformVert *dvert = CustomData_get_layer(&s->vertData, CD_MDEFORMVERT);
+		MLoopUV *mluv = CustomData_get_layer(&s->loopData, CD_MLOOPUV);
+		MTexPoly *mtp = CustomData_get_layer(&s->polyData, CD_MTEXPOLY);
+		int i, j;
+
+		cs.totvert = s->totvert;
+		cs.totpoly = s->totpoly;
+		cs.totloop = s->totloop;
+		cs.shard_id = s->shard_id;
+		cs.parent_id = s->parent_id;
+		cs.flag = s->flag;
+		cs.neighbor_count = s->neighbor_ids ? s->neighbor_count : 0;
+		cs.layers = (dvert ? FRACTURE_CACHE_DVERT : 0) | (mluv ? FRACTURE_CACHE_LOOPUV : 0) |
+		            (mtp ? FRACTURE_CACHE_TEXPOLY : 0);
+		copy_v3_v3(cs.min, s->min);
+		copy_v3_v3(cs.max, s->max);
+		copy_v3_v3(cs.centroid, s->centroid);
+		copy_v3_v3(cs.raw_centroid, s->raw_centroid);
+		copy_v3_v3(cs.impact_loc, s->impact_loc);
+		copy_v3_v3(cs.impact_size, s->impact_size);
+		cs.raw_volume = s->raw_volume;
+
+		ok &= fwrite(&cs, sizeof(cs), 1, fp) == 1;
+		ok &= fracture_cache_write_geometry(fp, s);
+		ok &= fwrite(s->neighbor_ids, sizeof(int), cs.neighbor_count, fp) == cs.neighbor_count;
+
+		if (dvert) {
+			for (i = 0; i < s->totvert && ok; i++) {
+				ok &= fwrite(&dvert[i].totweight, sizeof(int), 1, fp) == 1;
+				for (j = 0; j < dvert[i].totweight && ok; j++) {
+					ok &= fwrite(&dvert[i].dw[j].def_nr, sizeof(int), 1, fp) == 1;
+					ok &= fwrite(&dvert[i].dw[j].weight, sizeof(float), 1, fp) == 1;
+				}
+			}
+		}
+
+		if (mluv) {
+			for (i = 0; i < s->totloop && ok; i++) {
+				ok &= fwrite(mluv[i].uv, sizeof(float), 2, fp) == 2;
+				ok &= fwrite(&mluv[i].flag, sizeof(int), 1, fp) == 1;
+			}
+		}
+
+		if (mtp) {
+			/* image pointers can't be stored, they are only restored as empty texpolys */
+			for (i = 0; i < s->totpoly && ok; i++) {
+				ok &= fwrite(&mtp[i].flag, sizeof(char), 1, fp) == 1;
+				ok &= fwrite(&mtp[i].transp, sizeof(char), 1, fp) == 1;
+				ok &= fwrite(&mtp[i].mode, sizeof(short), 1, fp) == 1;
+				ok &= fwrite(&mtp[i].tile, sizeof(short), 1, fp) == 1;
+			}
+		}
+	}
+
+	fclose(fp);
+
+	if (ok) {
+		/* write under a temp name first, so other instances never read a partial file */
+		BLI_delete(path, false, false);
+		ok = (BLI_rename(tmp_path, path) == 0);
+	}
+
+	if (!ok) {
+		BLI_delete(tmp_path, false, false);
+	}
+}
+
+static Shard *fracture_cache_read_shard(FILE *fp)
+{
+	FractureCacheShard cs;
+	Shard *s;
+	bool ok = true;
+	int i, j;
+
+	if (fread(&cs, sizeof(cs), 1, fp) != 1 || cs.totvert < 0 || cs.totpoly < 0 || cs.totloop < 0 ||
+	    cs.neighbor_count < 0)
+	{
+		return NULL;
+	}
+
+	s = BKE_create_fracture_shard(MEM_mallocN(sizeof(MVert) * cs.totvert, "shard vertices"),
+	                              MEM_mallocN(sizeof(MPoly) * cs.totpoly, "shard polys"),
+	                              MEM_mallocN(sizeof(MLoop) * cs.totloop, "shard loops"),
+	                              cs.totvert, cs.totpoly, cs.totloop, false);
+	CustomData_reset(&s->vertData);
+	CustomData_reset(&s->loopData);
+	CustomData_reset(&s->polyData);
+
+	ok &= fracture_cache_read_geometry(fp, s);
+
+	if (ok && cs.neighbor_count > 0) {
+		s->neighbor_ids = MEM_mallocN(sizeof(int) * cs.neighbor_count, "shard neighbor ids");
+		s->neighbor_count = cs.neighbor_count;
+		ok &= fread(s->neighbor_ids, sizeof(int), cs.neighbor_count, fp) == cs.neighbor_count;
+	}
+
+	if (ok && (cs.layers & FRACTURE_CACHE_DVERT)) {
+		MDeformVert *dvert = CustomData_add_layer(&s->vertData, CD_MDEFORMVERT, CD_CALLOC, NULL, cs.totvert);
+		for (i = 0; i < cs.totvert && ok; i++) {
+			int totweight;
+			ok &= fread(&totweight, sizeof(int), 1, fp) == 1 && totweight >= 0;
+			if (ok && totweight > 0) {
+				dvert[i].dw = MEM_callocN(sizeof(MDeformWeight) * totweight, "deformWeight");
+				dvert[i].totweight = totweight;
+				for (j = 0; j < totweight && ok; j++) {
+					ok &= fread(&dvert[i].dw[j].def_nr, sizeof(int), 1, fp) == 1;
+					ok &= fread(&dvert[i].dw[j].weight, sizeof(float), 1, fp) == 1;
+				}
+			}
+		}
+	}
+
+	if (ok && (cs.layers & FRACTURE_CACHE_LOOPUV)) {
+		MLoopUV *mluv = CustomData_add_layer(&s->loopData, CD_MLOOPUV, CD_CALLOC, NULL, cs.totloop);
+		for (i = 0; i < cs.totloop && ok; i++) {
+			ok &= fread(mluv[i].uv, sizeof(float), 2, fp) == 2;
+			ok &= fread(&mluv[i].flag, sizeof(int), 1, fp) == 1;
+		}
+	}
+
+	if (ok && (cs.layers & FRACTURE_CACHE_TEXPOLY)) {
+		MTexPoly *mtp = CustomData_add_layer(&s->polyData, CD_MTEXPOLY, CD_CALLOC, NULL, cs.totpoly);
+		for (i = 0; i < cs.totpoly && ok; i++) {
+			ok &= fread(&mtp[i].flag, sizeof(char), 1, fp) == 1;
+			ok &= fread(&mtp[i].transp, sizeof(char), 1, fp) == 1;
+			ok &= fread(&mtp[i].mode, sizeof(short), 1, fp) == 1;
+			ok &= fread(&mtp[i].tile, sizeof(short), 1, fp) == 1;
+		}
+	}
+
+	s->shard_id = cs.shard_id;
+	s->parent_id = cs.parent_id;
+	s->flag = cs.flag;
+	copy_v3_v3(s->min, cs.min);
+	copy_v3_v3(s->max, cs.max);
+	copy_v3_v3(s->centroid, cs.centroid);
+	copy_v3_v3(s->raw_centroid, cs.raw_centroid);
+	copy_v3_v3(s->impact_loc, cs.impact_loc);
+	copy_v3_v3(s->impact_size, cs.impact_size);
+	s->raw_volume = cs.raw_volume;
+
+	if (!ok) {
+		BKE_shard_free(s, true);
+		return NULL;
+	}
+
+	return s;
+}
+
+/* replaces the shard map of fm with the cached one, leaves fm untouched on failure */
+static bool fracture_cache_read(FracMesh *fm, const char *path)
+{
+	ListBase shards = {NULL, NULL};
+	FractureCacheHeader header, expected;
+	char magic[4];
+	int count = 0, i;
+	FILE *fp;
+	Shard *s;
+	bool ok;
+
+	fp = BLI_fopen(path, "rb");
+	if (fp == NULL)
+		return false;
+
+	/* version, endianness and type sizes must all match, count is the only free field */
+	ok = fread(magic, 4, 1, fp) == 1 && memcmp(magic, FRACTURE_CACHE_MAGIC, 4) == 0 &&
+	     fread(&header, sizeof(header), 1, fp) == 1;
+	if (ok) {
+		count = header.count;
+		fracture_cache_header_init(&expected, count);
+		ok = memcmp(&header, &expected, sizeof(header)) == 0 && count >= 0;
+	}
+
+	for (i = 0; ok && i < count; i++) {
+		s = fracture_cache_read_shard(fp);
+		if (s) {
+			BLI_addtail(&shards, s);
+		}
+		else {
+			ok = false;
+		}
+	}
+
+	fclose(fp);
+
+	if (!ok) {
+		while ((s = BLI_pophead(&shards))) {
+			BKE_shard_free(s, true);
+		}
+		return false;
+	}
+
+	while ((s = BLI_pophead(&fm->shard_map))) {
+		BKE_shard_free(s, true);
+	}
+
+	/* the in-memory reuse data refers to the old shards */
+	if (fm->last_shard_tree) {
+		BLI_kdtree_free(fm->last_shard_tree);
+		fm->last_shard_tree = NULL;
+	}
+
+	if (fm->last_shards) {
+		MEM_freeN(fm->last_shards);
+		fm->last_shards = NULL;
+	}
+
+	fm->shard_map = shards;
+	fm->shard_count = count;
+
+	return true;
+}
+
 static void do_fracture(Scene *scene, Object *obj, ShardID id)
 {
 	/* dummy point cloud, random */
@@ -905,19 +1766,37 @@ static void do_fracture(Scene *scene, Object *obj, ShardID id)
 	FractureContainer *fc = obj->rigidbody_object->fracture_objects;
 	FractureState *fs = fc->current;
 
+	/* lazy islands borrow their shard, build them before the shard map gets replaced */
+	BKE_fracture_physics_meshes_ensure(fs);
+	fracmesh_ensure_unique(fs);
 	points = get_points_global(scene, obj, id);
 
 	if (points.totpoints > 0 || (fc->flag & FM_FLAG_USE_GREASEPENCIL_EDGES)) {
 		short mat_index = 0;
 		float mat[4][4];
+		char cache_path[FILE_MAX];
+		bool use_cache = false, cache_hit = false;
+
+		mat_index = do_materials(obj);
+		mat_index = mat_index > 0 ? mat_index - 1 : mat_index;
+
+		/* hash before the splinter matrix is applied to points and mesh */
+		if ((fc->flag & FM_FLAG_USE_DISK_CACHE) && id == 0) {
+			use_cache = fracture_cache_path(obj, &points, mat_index, cache_path);
+		}
 
 		/*splinters... just global axises and a length, for rotation rotate the object */
 		do_splinters(obj, points, &mat);
 
-		mat_index = do_materials(obj);
-		mat_index = mat_index > 0 ? mat_index - 1 : mat_index;
+		if (use_cache) {
+			double start = PIL_check_seconds_timer();
+			cache_hit = fracture_cache_read(fs->frac_mesh, cache_path);
+			if (cache_hit) {
+				printf("Fracture loaded from disk cache %s, %g\n", cache_path, PIL_check_seconds_timer() - start);
+			}
+		}
 
-		if (points.totpoints > 0) {
+		if (points.totpoints > 0 && !cache_hit) {
 			BKE_fracture_shard_by_points(obj, id, &points, mat_index, mat);
 		}
 
@@ -938,6 +1817,10 @@ static void do_fracture(Scene *scene, Object *obj, ShardID id)
 			return;
 		}
 
+		if (use_cache && !cache_hit) {
+			fracture_cache_write(fs->frac_mesh, cache_path);
+		}
+
 		//watch it when overwriting this... free it better before
 		if (fs->visual_mesh)
 		{
@@ -1242,7 +2125,7 @@ static void mesh_separate_tagged(Object *ob, BMesh *bm_work)
 	//calculate volume here optionally too
 	//need to distinguish between prehalving and posthalving, omit meshislands in prehalving, or better...
 	//create only after post halving....
-	do_island_from_shard(ob, s, 0, thresh_defgrp_index, ground_defgrp_index, 0);
+	do_island_from_shard(ob, s, thresh_defgrp_index, ground_defgrp_index, 0);
 
 	/* deselect loose data - this used to get deleted,
 	 * we could de-select edges and verts only, but this turns out to be less complicated
@@ -1321,7 +2204,7 @@ static void handle_vert(Object* ob, BMVert* vert, BMVert** orig_work,
 
 	normal_float_to_short_v3(vno, vert->no);
 	if (fc->flag & FM_FLAG_FIX_NORMALS)
-		find_normal(dm, fc->nor_tree, vert->co, vno, no, fc->nor_range);
+		find_normal(dm->getVertArray(dm), fc->nor_tree, vert->co, vno, no, fc->nor_range);
 	(*startno)[3 * (*tag_counter)] = no[0];
 	(*startno)[3 * (*tag_counter) + 1] = no[1];
 	(*startno)[3 * (*tag_counter) + 2] = no[2];
@@ -1527,6 +2410,24 @@ static void mesh_separate_loose(Object *ob)
 
 }
 
+static void add_participating_constraint(MeshIsland *mi, RigidBodyShardCon *rbsc)
+{
+	if (mi->participating_constraints == NULL) {
+		mi->participating_constraints = MEM_mallocN(sizeof(RigidBodyShardCon *) * 4, "part_constraints");
+		mi->participating_constraint_count = 0;
+	}
+	else if (MEM_allocN_len(mi->participating_constraints) <
+	         sizeof(RigidBodyShardCon *) * (mi->participating_constraint_count + 1))
+	{
+		/* grow geometrically, the allocated length doubles as capacity */
+		mi->participating_constraints = MEM_reallocN(mi->participating_constraints,
+		                                             sizeof(RigidBodyShardCon *) * mi->participating_constraint_count * 2);
+	}
+
+	mi->participating_constraints[mi->participating_constraint_count] = rbsc;
+	mi->participating_constraint_count++;
+}
+
 static void do_constraint(Object* ob, MeshIsland *mi1, MeshIsland *mi2, int con_type, float thresh)
 {
 	RigidBodyShardCon *rbsc;
@@ -1534,7 +2435,7 @@ static void do_constraint(Object* ob, MeshIsland *mi1, MeshIsland *mi2, int con_
 	FractureContainer *fc1 = ob->rigidbody_constraint->ob1->rigidbody_object->fracture_objects;
 	FractureContainer *fc2 = ob->rigidbody_constraint->ob2->rigidbody_object->fracture_objects;
 
-	rbsc = BKE_rigidbody_create_shard_constraint(con_type);
+	rbsc = BKE_rigidbody_create_shard_constraint(cc, con_type);
 	rbsc->mi1 = mi1;
 	rbsc->mi2 = mi2;
 	if (thresh == 0 || !(cc->flag & FMC_FLAG_USE_BREAKING)){
@@ -1575,21 +2476,8 @@ static void do_constraint(Object* ob, MeshIsland *mi1, MeshIsland *mi2, int con_
 	BLI_addtail(&cc->constraint_map, rbsc);
 
 	/* store constraints per meshisland too, to allow breaking percentage */
-	if (mi1->participating_constraints == NULL) {
-		mi1->participating_constraints = MEM_callocN(sizeof(RigidBodyShardCon *), "part_constraints_mi1");
-		mi1->participating_constraint_count = 0;
-	}
-	mi1->participating_constraints = MEM_reallocN(mi1->participating_constraints, sizeof(RigidBodyShardCon *) * (mi1->participating_constraint_count + 1));
-	mi1->participating_constraints[mi1->participating_constraint_count] = rbsc;
-	mi1->participating_constraint_count++;
-
-	if (mi2->participating_constraints == NULL) {
-		mi2->participating_constraints = MEM_callocN(sizeof(RigidBodyShardCon *), "part_constraints_mi2");
-		mi2->participating_constraint_count = 0;
-	}
-	mi2->participating_constraints = MEM_reallocN(mi2->participating_constraints, sizeof(RigidBodyShardCon *) * (mi2->participating_constraint_count + 1));
-	mi2->participating_constraints[mi2->participating_constraint_count] = rbsc;
-	mi2->participating_constraint_count++;
+	add_participating_constraint(mi1, rbsc);
+	add_participating_constraint(mi2, rbsc);
 }
 
 static void connect_meshislands(Object* ob, MeshIsland *mi1, MeshIsland *mi2, int con_type, float thresh)
@@ -2223,13 +3111,11 @@ DerivedMesh *BKE_fracture_autohide(Object* ob)
 	return result;
 }
 
-static void do_fix_normals_physics_mesh(Object* ob, Shard* s, MeshIsland* mi, int i)
+static void do_physics_mesh(Shard* s, MeshIsland* mi)
 {
-	FractureContainer *fc = ob->rigidbody_object->fracture_objects;
 	MVert *mv, *verts;
 	int totvert;
 	int j;
-	DerivedMesh *orig_dm = fc->raw_mesh;
 
 	mi->physics_mesh = BKE_shard_create_dm(s, true);
 	totvert = mi->physics_mesh->getNumVerts(mi->physics_mesh);
@@ -2239,30 +3125,14 @@ static void do_fix_normals_physics_mesh(Object* ob, Shard* s, MeshIsland* mi, in
 	mi->vertnos = MEM_mallocN(sizeof(short) * 3 * totvert, "vertno");
 
 	for (mv = verts, j = 0; j < totvert; mv++, j++) {
-		short no[3];
-
 		copy_v3_v3(mi->vertcos[j], mv->co);
 
-		/* either take orignormals or take ones from fractured mesh */
-		if (fc->flag & FM_FLAG_FIX_NORMALS) {
-			find_normal(orig_dm, fc->nor_tree, mv->co, mv->no, no, fc->nor_range);
-		}
-
-		copy_v3_v3_short(mi->vertnos[j], no);
-
-		if (fc->flag & FM_FLAG_FIX_NORMALS) {
-			copy_v3_v3_short(mi->vertices_cached[j]->no, no);
-			copy_v3_v3_short(mv->no, no);
-		}
+		/* take the normals of the fractured mesh, fixed normals are transferred later for all islands at once */
+		copy_v3_v3_short(mi->vertnos[j], mv->no);
 
 		/* then eliminate centroid in vertex coords*/
 		sub_v3_v3(mv->co, s->centroid);
 	}
-
-	if (fc->flag & FM_FLAG_FIX_NORMALS)
-	{
-		printf("Fixing Normals: %d\n", i);
-	}
 }
 
 static void do_verts_weights(Object* ob, Shard *s, MeshIsland *mi, int vertstart,
@@ -2377,7 +3247,7 @@ static void set_rigidbody_type(Object *ob, Shard *s, MeshIsland *mi)
 	}
 }
 
-static void do_island_from_shard(Object *ob, Shard* s, int i, int thresh_defgrp_index, int ground_defgrp_index, int vertstart)
+static void do_island_from_shard(Object *ob, Shard* s, int thresh_defgrp_index, int ground_defgrp_index, int vertstart)
 {
 	RigidBodyOb *rb = ob->rigidbody_object;
 	FractureContainer *fc = rb->fracture_objects;
@@ -2407,9 +3277,7 @@ static void do_island_from_shard(Object *ob, Shard* s, int i, int thresh_defgrp_
 	//call this later, when the DM has been built... hmmmmmm or rebuild... but vertrefs will be useless then
 	do_verts_weights(ob, s, mi, vertstart, thresh_defgrp_index, ground_defgrp_index);
 
-	/*copy fixed normals to physics mesh too (needed for convert to objects)*/
-
-	do_fix_normals_physics_mesh(ob, s, mi, i);
+	do_physics_mesh(s, mi);
 
 	BKE_shard_calc_minmax(s);
 	copy_v3_v3(mi->centroid, s->centroid);
@@ -2482,7 +3350,7 @@ static MDeformVert* do_islands_from_shards(Object* ob)
 {
 	/* can be created without shards even, when using fracturemethod = NONE (re-using islands)*/
 	Shard *s;
-	int i = 0, vertstart = 0;
+	int vertstart = 0;
 	FractureContainer *fc = ob->rigidbody_object->fracture_objects;
 
 	MDeformVert *ivert = NULL;
@@ -2527,9 +3395,8 @@ static MDeformVert* do_islands_from_shards(Object* ob)
 	shardlist = fc->current->frac_mesh->shard_map;
 
 	for (s = shardlist.first; s; s = s->next) {
-		do_island_from_shard(ob, s, i, thresh_defgrp_index, ground_defgrp_index, vertstart);
+		do_island_from_shard(ob, s, thresh_defgrp_index, ground_defgrp_index, vertstart);
 		vertstart += s->totvert;
-		i++;
 	}
 
 	return ivert;
@@ -2654,8 +3521,11 @@ static void do_refresh(Object *ob, bool do_rebuild)
 	FractureState* fs = fc->current;
 
 	//pre-halving... making shards (NOT islands, watch it !)
-	if (fc->flag & FM_FLAG_SHARDS_TO_ISLANDS)
+	if (fc->flag & FM_FLAG_SHARDS_TO_ISLANDS) {
+		BKE_fracture_physics_meshes_ensure(fs);
+		fracmesh_ensure_unique(fs);
 		do_halving(ob);
+	}
 
 	if (do_rebuild)
 	{
@@ -2686,6 +3556,7 @@ static void do_refresh(Object *ob, bool do_rebuild)
 	//post halving ? TODO
 
 	if (fc->flag & FM_FLAG_FIX_NORMALS) {
+		do_fix_normals_islands(ob);
 		printf("Fixing normals done, %g\n", PIL_check_seconds_timer() - start);
 	}
 
@@ -3362,6 +4233,10 @@ Shard *BKE_create_fracture_shard(MVert *mvert, MPoly *mpoly, MLoop *mloop, int t
 	shard->cluster_colors = NULL;
 	shard->neighbor_ids = NULL;
 	shard->neighbor_count = 0;
+
+	CustomData_reset(&shard->vertData);
+	CustomData_reset(&shard->loopData);
+	CustomData_reset(&shard->polyData);
 	
 	if (copy) {
 		shard->mvert = MEM_mallocN(sizeof(MVert) * totvert, "shard vertices");
@@ -3405,6 +4280,7 @@ FracMesh *BKE_create_fracmesh(void)
 	fmesh->last_shards = NULL;
 	fmesh->last_shard_tree = NULL;
 	fmesh->last_expected_shards = 0;
+	fmesh->users = 1;
 	
 	return fmesh;
 }
@@ -3767,6 +4643,32 @@ static void do_prepare_cells(FracMesh *fm, cell *cells, int expected_shards, int
 }
 
 
+static void unwrap_cells_task(void *userdata, int iter)
+{
+	Shard **cells = userdata;
+
+	if (cells[iter] != NULL) {
+		BKE_fracture_shard_unwrap(cells[iter]);
+	}
+}
+
+/* bisection always cuts with the uv unwrapped cells, the unwrap of each cell is independent so
+ * do it for all cells in parallel up front (boolean only needs it for cells which cannot be clipped) */
+static void unwrap_cells(Shard **tempshards, int expected_shards, int algorithm)
+{
+	double start;
+
+	if (!ELEM(algorithm, MOD_FRACTURE_BISECT, MOD_FRACTURE_BISECT_FILL,
+	          MOD_FRACTURE_BISECT_FAST, MOD_FRACTURE_BISECT_FAST_FILL) || expected_shards < 2)
+	{
+		return;
+	}
+
+	start = PIL_check_seconds_timer();
+	BLI_task_parallel_range(0, expected_shards, tempshards, unwrap_cells_task);
+	printf("Inner uv unwrap of %d cells done, %g\n", expected_shards, PIL_check_seconds_timer() - start);
+}
+
 /* parse the voro++ cell data */
 static void parse_cells(cell *cells, int expected_shards, ShardID parent_id, Object *obj, short inner_material_index, float mat[4][4])
 {
@@ -3891,6 +4793,7 @@ static void parse_cells(cell *cells, int expected_shards, ShardID parent_id, Obj
 	unit_m4(obmat);
 
 	do_prepare_cells(fm, cells, expected_shards, algorithm, p, &centroid, &dm_parent, &bm_parent, &tempshards, &tempresults);
+	unwrap_cells(tempshards, expected_shards, algorithm);
 
 	if (fm->last_shard_tree)
 	{
@@ -3997,7 +4900,7 @@ static void parse_cells(cell *cells, int expected_shards, ShardID parent_id, Obj
 		}
 
 		if (t != NULL) {
-			BKE_shard_free(t, false);
+			BKE_shard_free(t, true);
 		}
 	}
 
@@ -4415,6 +5318,7 @@ void BKE_fracture_shard_by_planes(Object *obj, short inner_material_index, float
 					MeshIsland* mi = NULL;
 					int j = 0;
 					//another inner loop over fracture settings necessary, TODO
+					BKE_fracture_physics_meshes_ensure(fs2);
 					for (mi = fs2->island_map.first; mi; mi = mi->next)
 					{
 						DerivedMesh *dm = CDDM_copy(mi->physics_mesh);
@@ -4616,29 +5520,81 @@ static void do_marking(Object* ob, DerivedMesh *result)
 	}
 }
 
+typedef struct CreateShardData {
+	Shard **shards;
+	int *vertstart;
+	int *polystart;
+	int *loopstart;
+	MVert *mverts;
+	MPoly *mpolys;
+	MLoop *mloops;
+	DerivedMesh *result;
+	bool doCustomData;
+} CreateShardData;
+
+/* copy one shard into the result mesh, offsets are precomputed so shards can be processed in any order */
+static void do_create_shard_task(void *userdata, int index)
+{
+	CreateShardData *data = userdata;
+	Shard *shard = data->shards[index];
+	int vertstart = data->vertstart[index];
+	int polystart = data->polystart[index];
+	int loopstart = data->loopstart[index];
+	MPoly *mp;
+	MLoop *ml;
+	int i;
+
+	memcpy(data->mverts + vertstart, shard->mvert, shard->totvert * sizeof(MVert));
+	memcpy(data->mpolys + polystart, shard->mpoly, shard->totpoly * sizeof(MPoly));
+
+	for (i = 0, mp = data->mpolys + polystart; i < shard->totpoly; ++i, ++mp) {
+		/* adjust loopstart index */
+		mp->loopstart += loopstart;
+	}
+
+	memcpy(data->mloops + loopstart, shard->mloop, shard->totloop * sizeof(MLoop));
+
+	for (i = 0, ml = data->mloops + loopstart; i < shard->totloop; ++i, ++ml) {
+		/* adjust vertex index */
+		ml->v += vertstart;
+	}
+
+	if (data->doCustomData) {
+		DerivedMesh *result = data->result;
+
+		if (shard->totvert > 1) {
+			CustomData_copy_data(&shard->vertData, &result->vertData, 0, vertstart, shard->totvert);
+		}
+
+		if (shard->totloop > 0) {
+			CustomData_copy_data(&shard->loopData, &result->loopData, 0, loopstart, shard->totloop);
+		}
+
+		if (shard->totpoly > 0) {
+			CustomData_copy_data(&shard->polyData, &result->polyData, 0, polystart, shard->totpoly);
+		}
+	}
+}
+
 static DerivedMesh* do_create(FracMesh *frac_mesh, int num_verts, int num_loops, int num_polys,
                               bool doCustomData)
 {
 	int shard_count = 0;
-	ListBase *shardlist;
 	Shard *shard;
-
-	int vertstart, polystart, loopstart;
-
-	MVert *mverts;
-	MPoly *mpolys;
-	MLoop *mloops;
+	CreateShardData data;
+	int i, vertstart, polystart, loopstart;
 
 	DerivedMesh *result = NULL;
 
 	shard_count = BLI_listbase_count(&frac_mesh->shard_map);
 
 	result = CDDM_new(num_verts, 0, 0, num_loops, num_polys);
-	mverts = CDDM_get_verts(result);
-	mloops = CDDM_get_loops(result);
-	mpolys = CDDM_get_polys(result);
 
-	if (doCustomData && shard_count > 0) {
+	if (shard_count == 0) {
+		return result;
+	}
+
+	if (doCustomData) {
 		Shard *s = frac_mesh->shard_map.first;
 
 		CustomData_merge(&s->vertData, &result->vertData, CD_MASK_MDEFORMVERT, CD_CALLOC, num_verts);
@@ -4646,50 +5602,35 @@ static DerivedMesh* do_create(FracMesh *frac_mesh, int num_verts, int num_loops,
 		CustomData_merge(&s->loopData, &result->loopData, CD_MASK_MLOOPUV, CD_CALLOC, num_loops);
 	}
 
-	vertstart = polystart = loopstart = 0;
-	shardlist = &frac_mesh->shard_map;
+	data.shards = MEM_mallocN(sizeof(Shard *) * shard_count, "do_create shards");
+	data.vertstart = MEM_mallocN(sizeof(int) * shard_count * 3, "do_create offsets");
+	data.polystart = data.vertstart + shard_count;
+	data.loopstart = data.polystart + shard_count;
+	data.mverts = CDDM_get_verts(result);
+	data.mloops = CDDM_get_loops(result);
+	data.mpolys = CDDM_get_polys(result);
+	data.result = result;
+	data.doCustomData = doCustomData;
 
-	for (shard = shardlist->first; shard; shard = shard->next)
+	/* exclusive prefix sum over the shard sizes gives each shard its own range in the result */
+	vertstart = polystart = loopstart = 0;
+	for (shard = frac_mesh->shard_map.first, i = 0; shard; shard = shard->next, i++)
 	{
-		MPoly *mp;
-		MLoop *ml;
-		int i;
-
-		memcpy(mverts + vertstart, shard->mvert, shard->totvert * sizeof(MVert));
-		memcpy(mpolys + polystart, shard->mpoly, shard->totpoly * sizeof(MPoly));
-
-
-		for (i = 0, mp = mpolys + polystart; i < shard->totpoly; ++i, ++mp) {
-			/* adjust loopstart index */
-			mp->loopstart += loopstart;
-		}
-
-		memcpy(mloops + loopstart, shard->mloop, shard->totloop * sizeof(MLoop));
-
-		for (i = 0, ml = mloops + loopstart; i < shard->totloop; ++i, ++ml) {
-			/* adjust vertex index */
-			ml->v += vertstart;
-		}
-
-		if (doCustomData) {
-			if (shard->totvert > 1) {
-				CustomData_copy_data(&shard->vertData, &result->vertData, 0, vertstart, shard->totvert);
-			}
-
-			if (shard->totloop > 0) {
-				CustomData_copy_data(&shard->loopData, &result->loopData, 0, loopstart, shard->totloop);
-			}
-
-			if (shard->totpoly > 0) {
-				CustomData_copy_data(&shard->polyData, &result->polyData, 0, polystart, shard->totpoly);
-			}
-		}
+		data.shards[i] = shard;
+		data.vertstart[i] = vertstart;
+		data.polystart[i] = polystart;
+		data.loopstart[i] = loopstart;
 
 		vertstart += shard->totvert;
 		polystart += shard->totpoly;
 		loopstart += shard->totloop;
 	}
 
+	BLI_task_parallel_range_ex(0, shard_count, &data, do_create_shard_task, 16, true);
+
+	MEM_freeN(data.vertstart);
+	MEM_freeN(data.shards);
+
 	return result;
 }
 
@@ -4758,6 +5699,58 @@ DerivedMesh *BKE_shard_create_dm(Shard *s, bool doCustomData)
 	return dm;
 }
 
+/* island geometry relative to its centroid, for exporting each island as an own (instanced) object */
+DerivedMesh *BKE_fracture_island_create_dm(Object *ob, MeshIsland *mi)
+{
+	FractureContainer *fc = ob->rigidbody_object->fracture_objects;
+	DerivedMesh *dm;
+	MVert *mv;
+	int i, totvert;
+
+	/* the physics mesh is the unscaled shard geometry, already centered and with fixed normals */
+	if (mi->physics_mesh)
+		return CDDM_copy(mi->physics_mesh);
+
+	/* islands read from file which were not converted yet */
+	if (mi->shard == NULL)
+		return NULL;
+
+	dm = BKE_shard_create_dm(mi->shard, true);
+	totvert = dm->getNumVerts(dm);
+	mv = dm->getVertArray(dm);
+
+	for (i = 0; i < totvert; i++, mv++) {
+		sub_v3_v3(mv->co, mi->centroid);
+
+		/* same normals as in the visual mesh */
+		if ((fc->flag & FM_FLAG_FIX_NORMALS) && mi->vertnos && i < mi->vertex_count) {
+			copy_v3_v3_short(mv->no, mi->vertnos[i]);
+		}
+	}
+
+	return dm;
+}
+
+/* world matrix of an island, matches the vertex transform in BKE_rigidbody_update_cell() */
+void BKE_fracture_island_matrix_world(Object *ob, MeshIsland *mi, float r_mat[4][4])
+{
+	RigidBodyShardOb *rbo = mi->rigidbody;
+	float size[3];
+
+	if (rbo == NULL || rbo->pos[0] == FLT_MIN || rbo->orn[0] == FLT_MIN) {
+		/* no valid sim transform, island rests at its place in the object */
+		float cent[4][4];
+
+		unit_m4(cent);
+		copy_v3_v3(cent[3], mi->centroid);
+		mul_m4_m4m4(r_mat, ob->obmat, cent);
+		return;
+	}
+
+	mat4_to_size(size, ob->obmat);
+	loc_quat_size_to_mat4(r_mat, rbo->pos, rbo->orn, size);
+}
+
 void BKE_lookup_mesh_state(Object* ob, int frame)
 {
 	FractureContainer *fc = ob->rigidbody_object->fracture_objects;
@@ -4895,23 +5888,20 @@ static void free_constraint_container(Scene *scene, Object* ob)
 		}
 	}
 
-	rbsc = cc->constraint_map.first;
-	while (rbsc) {
-		if (scene)
-		{
+	if (scene)
+	{
+		for (rbsc = cc->constraint_map.first; rbsc; rbsc = rbsc->next) {
 			BKE_rigidbody_remove_shard_con(scene->rigidbody_world, rbsc);
-			rbsc = rbsc->next;
-		}
-		else
-		{
-			BLI_remlink(&cc->constraint_map, rbsc);
-			MEM_freeN(rbsc);
-			rbsc = cc->constraint_map.first;
 		}
 	}
-
-	if (!scene)
+	else
 	{
+		/* all constraints live in the pool, no need to free them one by one */
+		if (cc->constraint_pool) {
+			BLI_mempool_destroy(cc->constraint_pool);
+			cc->constraint_pool = NULL;
+		}
+
 		cc->constraint_map.first = NULL;
 		cc->constraint_map.last = NULL;
 	}
@@ -5126,12 +6116,19 @@ void BKE_fracture_constraint_container_update(Object* ob)
 void BKE_fracture_prefracture_mesh(Scene* scene, Object *ob, ShardID id)
 {
 	FractureContainer *fc = ob->rigidbody_object->fracture_objects;
-	FractureState *fs = fc->current;
 
 	if (thread_sentinel(ob))
 		return;
 
 	fc->raw_mesh = BKE_fracture_ensure_mesh(scene, ob);
+	prefracture_state(scene, ob, id);
+}
+
+/* fracture fc->raw_mesh into the current state */
+static void prefracture_state(Scene *scene, Object *ob, ShardID id)
+{
+	FractureContainer *fc = ob->rigidbody_object->fracture_objects;
+	FractureState *fs = fc->current;
 
 #if 0
 	//very first, purge constraints... we are member in
@@ -5201,6 +6198,131 @@ void BKE_dynamic_fracture_mesh(Scene* scene, Object *ob, ShardID id)
 	BKE_fracture_prefracture_mesh(scene, ob, id);
 }
 
+/* Double buffered fracture
+ *
+ * A fracture job can run on a private copy of the container (plus object and rigidbody settings
+ * pointing to it), so the live container keeps its current state for display and simulation
+ * while the job runs. The new state is swapped in on the main thread once the job is done. */
+
+struct FractureBuffer {
+	Object ob;
+	RigidBodyOb rbo;
+	FractureContainer fc;
+};
+
+FractureBuffer *BKE_fracture_buffer_create(Scene *scene, Object *ob)
+{
+	FractureContainer *fc = ob->rigidbody_object->fracture_objects;
+	FractureBuffer *fb = MEM_callocN(sizeof(FractureBuffer), "fracture buffer");
+	FractureState *fs = MEM_callocN(sizeof(FractureState), "fracture buffer state");
+
+	/* material slots may be added here, do this on the real object before copying it */
+	do_materials(ob);
+
+	fb->ob = *ob;
+	fb->rbo = *ob->rigidbody_object;
+	fb->fc = *fc;
+	fb->rbo.fracture_objects = &fb->fc;
+	fb->ob.rigidbody_object = &fb->rbo;
+
+	/* evaluate the input mesh here, the job must not touch the object's derived meshes */
+	fb->fc.raw_mesh = BKE_fracture_ensure_mesh(scene, ob);
+
+	/* runtime data is rebuilt by the fracture, the live container still uses its own */
+	fb->fc.nor_tree = NULL;
+	fb->fc.face_pairs = NULL;
+	fb->fc.vertex_island_map = NULL;
+
+	fs->frac_mesh = BKE_create_fracmesh();
+	fs->frame = fc->current ? fc->current->frame : 0;
+	BLI_listbase_clear(&fb->fc.states);
+	BLI_addtail(&fb->fc.states, fs);
+	fb->fc.current = fs;
+
+	return fb;
+}
+
+/* called from the job thread */
+void BKE_fracture_buffer_execute(Scene *scene, FractureBuffer *fb)
+{
+	if (thread_sentinel(&fb->ob))
+		return;
+
+	prefracture_state(scene, &fb->ob, 0);
+}
+
+FracMesh *BKE_fracture_buffer_fracmesh(FractureBuffer *fb)
+{
+	return fb->fc.current ? fb->fc.current->frac_mesh : NULL;
+}
+
+/* replace the live state by the buffered one, called from the main thread after the job ended */
+bool BKE_fracture_buffer_swap(Scene *scene, Object *ob, FractureBuffer *fb)
+{
+	FractureContainer *fc = ob->rigidbody_object->fracture_objects;
+	FractureState *fs_new = fb->fc.current, *fs_old = fc->current;
+
+	if (fs_new == NULL || fs_new->frac_mesh == NULL || fs_new->frac_mesh->cancel == 1) {
+		/* cancelled, keep showing the old result */
+		return false;
+	}
+
+	BLI_remlink(&fb->fc.states, fs_new);
+	fb->fc.current = NULL;
+
+	if (fs_old) {
+		fs_new->frame = fs_old->frame;
+		BLI_insertlinkafter(&fc->states, fs_old, fs_new);
+		BLI_remlink(&fc->states, fs_old);
+		free_fracture_state(scene, fs_old, true);
+		MEM_freeN(fs_old);
+	}
+	else {
+		BLI_addtail(&fc->states, fs_new);
+	}
+
+	fc->current = fs_new;
+	fs_new->frac_mesh->running = 0;
+
+	free_fracture_runtime(fc);
+	fc->nor_tree = fb->fc.nor_tree;
+	fc->face_pairs = fb->fc.face_pairs;
+	fc->vertex_island_map = fb->fc.vertex_island_map;
+	fb->fc.nor_tree = NULL;
+	fb->fc.face_pairs = NULL;
+	fb->fc.vertex_island_map = NULL;
+
+	/* the previous raw mesh may be borrowed, so it is only replaced like in a direct prefracture */
+	fc->raw_mesh = fb->fc.raw_mesh;
+	fb->fc.raw_mesh = NULL;
+
+	fc->max_vol = fb->fc.max_vol;
+	fc->flag &= ~FM_FLAG_RESET_SHARDS;
+
+	return true;
+}
+
+void BKE_fracture_buffer_free(FractureBuffer *fb)
+{
+	FractureState *fs;
+
+	while ((fs = BLI_pophead(&fb->fc.states))) {
+		if (fs->frac_mesh) {
+			free_fracture_state(NULL, fs, true);
+		}
+		MEM_freeN(fs);
+	}
+
+	free_fracture_runtime(&fb->fc);
+
+	if (fb->fc.raw_mesh) {
+		fb->fc.raw_mesh->needsFree = 1;
+		fb->fc.raw_mesh->release(fb->fc.raw_mesh);
+	}
+
+	MEM_freeN(fb);
+}
+
 ConstraintContainer* BKE_fracture_constraint_container_create(Object* ob)
 {
 	ConstraintContainer *cc = MEM_callocN(sizeof(ConstraintContainer) ,"fracture_constraints");
@@ -5234,6 +6356,9 @@ static void initialize_shard(Object *ob)
 	float mat[4][4]; //wood splinter scaling matrix, here it is unit_m4
 	Shard *s;
 
+	/* the state gets a new fracmesh below, islands must not keep pointing into the old one */
+	BKE_fracture_physics_meshes_ensure(fs);
+
 	s = BKE_create_fracture_shard(dm->getVertArray(dm), dm->getPolyArray(dm), dm->getLoopArray(dm),
 	                              dm->getNumVerts(dm), dm->getNumPolys(dm), dm->getNumLoops(dm), true);
 
@@ -5294,6 +6419,7 @@ FractureContainer* BKE_fracture_container_create(Object *ob)
 	fc->fractal_cuts = 1;
 	fc->fractal_amount = 1.0f;
 	fc->fractal_iterations = 5;
+	fc->cluster_iterations = 5;
 
 	fc->grease_decimate = 100.0f;
 	fc->grease_offset = 100.0f;
@@ -5349,6 +6475,9 @@ int BKE_initialize_meshisland(MeshIsland** mii, MVert* mverts, int vertstart)
 	mi->vertices_cached = MEM_mallocN(sizeof(MVert*) * mi->vertex_count, "mi->vertices_cached readfile");
 	mi->vertex_indices = MEM_mallocN(sizeof(int) * mi->vertex_count, "mi->vertex_indices");
 
+	/* vertices point into a new visual mesh, force the next sync to write them */
+	zero_v4(mi->applied_orn);
+
 	for (k = 0; k < mi->vertex_count; k++) {
 		MVert* v = mverts + vertstart + k ;
 		mi->vertices_cached[k] = v;
@@ -5367,6 +6496,76 @@ int BKE_initialize_meshisland(MeshIsland** mii, MVert* mverts, int vertstart)
 	return mi->vertex_count;
 }
 
+/* islands read from file only keep a reference to their shard, the physics mesh
+ * is built on first use (shape validation, mass calculation, conversion) */
+void BKE_fracture_physics_mesh_ensure(MeshIsland *mi)
+{
+	MVert *mvert;
+	int j, totvert;
+
+	if (mi->physics_mesh || mi->shard == NULL) {
+		return;
+	}
+
+	mi->physics_mesh = BKE_shard_create_dm(mi->shard, true);
+	totvert = mi->physics_mesh->getNumVerts(mi->physics_mesh);
+	mvert = mi->physics_mesh->getVertArray(mi->physics_mesh);
+
+	for (j = 0; j < totvert; j++) {
+		sub_v3_v3(mvert[j].co, mi->centroid);
+	}
+
+	/* keep fixed normals, the shard only has the original ones */
+	if (mi->vertnos && totvert == mi->vertex_count) {
+		for (j = 0; j < totvert; j++) {
+			copy_v3_v3_short(mvert[j].no, mi->vertnos[j]);
+		}
+	}
+
+	/* shard is owned by the fracmesh, don't keep a reference once converted */
+	mi->shard = NULL;
+}
+
+static void physics_mesh_ensure_task(void *userdata, int iter)
+{
+	MeshIsland **islands = userdata;
+	BKE_fracture_physics_mesh_ensure(islands[iter]);
+}
+
+void BKE_fracture_physics_meshes_ensure(FractureState *fs)
+{
+	MeshIsland *mi, **islands;
+	int count = 0;
+	double start;
+
+	for (mi = fs->island_map.first; mi; mi = mi->next) {
+		if (mi->physics_mesh == NULL && mi->shard != NULL) {
+			count++;
+		}
+	}
+
+	if (count == 0) {
+		return;
+	}
+
+	start = PIL_check_seconds_timer();
+	islands = MEM_mallocN(sizeof(MeshIsland *) * count, "physics_meshes_ensure islands");
+	count = 0;
+	for (mi = fs->island_map.first; mi; mi = mi->next) {
+		if (mi->physics_mesh == NULL && mi->shard != NULL) {
+			islands[count] = mi;
+			count++;
+		}
+	}
+
+	BLI_task_parallel_range(0, count, islands, physics_mesh_ensure_task);
+	MEM_freeN(islands);
+
+	if (G.debug & G_DEBUG) {
+		printf("Building %d physics meshes done, %g\n", count, PIL_check_seconds_timer() - start);
+	}
+}
+
 #if 0
 static void copyData(ModifierData *md, ModifierData *target)
 {
@@ -5461,16 +6660,27 @@ static ConstraintContainer *copy_constraint_container(ConstraintContainer *cc)
 	return ccN;
 }
 
-static void copy_mesh_island(Object *ob, MeshIsland *miN, MeshIsland *mi)
+static void copy_mesh_island(Object *ob, MeshIsland *miN, MeshIsland *mi, Shard *s)
 {
-	miN->vertcos = MEM_dupallocN(miN->vertcos);
-	miN->vertnos = MEM_dupallocN(miN->vertnos);
+	miN->vertcos = MEM_dupallocN(mi->vertcos);
+	miN->vertnos = MEM_dupallocN(mi->vertnos);
 	miN->vertex_indices = NULL;
 	miN->vertices_cached = NULL;
 	miN->vertex_count = mi->vertex_count;
 
 	miN->bb = MEM_dupallocN(mi->bb);
-	miN->physics_mesh = CDDM_copy(mi->physics_mesh);
+
+	/* the shard map is shared, build the physics mesh from it only when the copy needs it */
+	if (s) {
+		miN->physics_mesh = NULL;
+		miN->shard = s;
+	}
+	else {
+		BKE_fracture_physics_mesh_ensure(mi);
+		miN->physics_mesh = mi->physics_mesh ? CDDM_copy(mi->physics_mesh) : NULL;
+		miN->shard = NULL;
+	}
+
 	miN->participating_constraints = MEM_dupallocN(mi->participating_constraints);
 	miN->participating_constraint_count = mi->participating_constraint_count;
 	miN->linear_index = mi->linear_index;
@@ -5495,28 +6705,49 @@ static void copy_fracture_state(FractureState *fsN, FractureState *fs, Object *o
 {
 	MeshIsland *mi, *miN;
 	MVert *mvert;
+	Shard *s = NULL;
 	int vertstart = 0, i = 0;
 
-	//copy shards, meshislands.... and stuff TODO or just nullify! no, need a copy !!!
-	fsN->frac_mesh = BKE_copy_fracmesh(fs->frac_mesh);
+	/* shards don't change after fracturing, share them until one of the states fractures again */
+	fsN->frac_mesh = fs->frac_mesh;
+	fracmesh_user_add(fsN->frac_mesh);
 	fsN->visual_mesh = NULL;
 	mvert = BKE_copy_visual_mesh(obN, fsN);
 
-	//s = fsN->frac_mesh->shard_map.first;
+	/* islands are made from the shards in order, like in readfile */
+	if (BLI_listbase_count(&fs->frac_mesh->shard_map) == fs->island_count) {
+		s = fs->frac_mesh->shard_map.first;
+	}
+
 	fsN->islands = MEM_callocN(sizeof(MeshIsland*) * fs->island_count, "fsN->islands");
 	fsN->island_count = fs->island_count;
 
 	for (mi = fs->island_map.first; mi; mi = mi->next)
 	{
 		miN = MEM_callocN(sizeof(MeshIsland), "copy_fracture_state, mi");
-		copy_mesh_island(obN, miN, mi /*s->centroid*/);
+		copy_mesh_island(obN, miN, mi, (s && s->totvert == mi->vertex_count) ? s : NULL);
 		vertstart += BKE_initialize_meshisland(&miN, mvert, vertstart);
 		BLI_addtail(&fsN->island_map, miN);
 		fsN->islands[i] = miN;
 		i++;
+
+		if (s) {
+			s = s->next;
+		}
 	}
 }
 
+static GHash *copy_face_pairs(GHash *face_pairs)
+{
+	GHash *face_pairsN = BLI_ghash_int_new_ex("face_pairs", BLI_ghash_size(face_pairs));
+	GHashIterator gh_iter;
+
+	GHASH_ITER (gh_iter, face_pairs) {
+		BLI_ghash_insert(face_pairsN, BLI_ghashIterator_getKey(&gh_iter), BLI_ghashIterator_getValue(&gh_iter));
+	}
+
+	return face_pairsN;
+}
 
 static FractureContainer* copy_fracture_container(Object* ob, Object *obN)
 {
@@ -5529,6 +6760,10 @@ static FractureContainer* copy_fracture_container(Object* ob, Object *obN)
 	fcN->states.first = NULL;
 	fcN->states.last = NULL;
 
+	/* runtime data, rebuilt when fracturing the copy */
+	fcN->nor_tree = NULL;
+	fcN->vertex_island_map = NULL;
+
 	//fs = fc->states.first;
 	for (fs = fc->states.first; fs; fs = fs->next)
 	{
@@ -5541,7 +6776,9 @@ static FractureContainer* copy_fracture_container(Object* ob, Object *obN)
 
 	fcN->pointcache = BKE_ptcache_copy_list(&fcN->ptcaches, &fc->ptcaches, false);
 	fcN->effector_weights = MEM_dupallocN(fc->effector_weights);
-	make_face_pairs(obN);
+
+	/* the visual mesh topology is the same, no need to search the face pairs again */
+	fcN->face_pairs = fc->face_pairs ? copy_face_pairs(fc->face_pairs) : NULL;
 
 	rb->flag |= RBO_FLAG_NEEDS_VALIDATE;
 
@@ -5650,6 +6887,10 @@ void BKE_fracture_synchronize_caches(Scene* scene)
 	if (rbw && rbw->group && cache)
 	{
 		GroupObject *go;
+
+		/* the cache range may have moved, checkpoints taken for the old range are meaningless */
+		BKE_rigidbody_free_checkpoints(rbw);
+
 		for (go = rbw->group->gobject.first; go; go = go->next)
 		{
 			if (go->ob && go->ob->rigidbody_object)
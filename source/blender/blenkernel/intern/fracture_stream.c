@@ -0,0 +1,794 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) Blender Foundation
+ * All rights reserved.
+ *
+ * The Original Code is: all of this file.
+ *
+ * Contributor(s): Martin Felke
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ */
+
+/** \file blender/blenkernel/intern/fracture_stream.c
+ *  \ingroup blenkernel
+ *  \brief Streamed fracture simulation results
+ *
+ * A fracture simulation is exported as a seekable binary file, so renders only need the visual
+ * mesh of the requested frame and neither the shards, islands, constraints nor Bullet.
+ *
+ * Layout:
+ * - header, with the file offsets of the state and frame tables
+ * - one geometry block per fracture state (a dynamic fracture switches states during the sim),
+ *   holding the rest positions of the visual mesh, its topology and the island of each vertex
+ * - one record per frame, holding the state index and an object space matrix per island
+ * - the state table and the frame table, with the file offset of each block / record
+ *
+ * All values are stored little endian with fixed sizes (32 bit int and float, 16 bit short,
+ * 64 bit file offsets), never as host structs, so a stream can be rendered on any machine.
+ */
+
+#include <stdio.h>
+
+#include "MEM_guardedalloc.h"
+
+#include "BKE_cdderivedmesh.h"
+#include "BKE_customdata.h"
+#include "BKE_DerivedMesh.h"
+#include "BKE_fracture.h"
+#include "BKE_global.h"
+#include "BKE_main.h"
+#include "BKE_scene.h"
+
+#include "BLI_endian_switch.h"
+#include "BLI_fileops.h"
+#include "BLI_listbase.h"
+#include "BLI_math.h"
+#include "BLI_path_util.h"
+#include "BLI_string.h"
+#include "BLI_utildefines.h"
+
+#include "DNA_fracture_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_object_types.h"
+#include "DNA_rigidbody_types.h"
+#include "DNA_scene_types.h"
+
+#include "PIL_time.h"
+
+#define FRACTURE_STREAM_MAGIC "FMST"
+#define FRACTURE_STREAM_VERSION 2
+
+/* magic, 4 ints and 2 offsets */
+#define FRACTURE_STREAM_HEADER_SIZE (4 + 4 * 4 + 2 * 8)
+
+/* bytes per element of the geometry arrays and the frame matrices, as stored in the file */
+#define FRACTURE_STREAM_VERT_SIZE (3 * 4 + 3 * 2 + 4)  /* co, no, island */
+#define FRACTURE_STREAM_POLY_SIZE (2 * 4 + 2 + 1)      /* loopstart, totloop, mat_nr, flag */
+#define FRACTURE_STREAM_LOOP_SIZE (4)                  /* v, edges are rebuilt on read */
+#define FRACTURE_STREAM_LOOPUV_SIZE (2 * 4)
+#define FRACTURE_STREAM_MATRIX_SIZE (16 * 4)
+
+enum {
+	FRACTURE_STREAM_LOOPUV  = (1 << 0),
+};
+
+typedef struct FractureStreamHeader {
+	int version;
+	int frame_start, frame_count;
+	int state_count;
+	int64_t state_table, frame_table;  /* file offsets */
+} FractureStreamHeader;
+
+/* fixed size part of each geometry block */
+typedef struct FractureStreamGeometry {
+	int totvert, totpoly, totloop;
+	int island_count, layers;
+} FractureStreamGeometry;
+
+/* fixed size part of each frame record, followed by island_count matrices */
+typedef struct FractureStreamFrame {
+	int state;  /* -1 if there was no visual mesh in this frame */
+	int island_count;
+} FractureStreamFrame;
+
+/* ************************************** */
+/* File Access */
+
+BLI_STATIC_ASSERT(sizeof(short) == 2 && sizeof(int) == 4 && sizeof(float) == 4, "unexpected type sizes")
+
+/* ftell and fseek use a long, which is 32 bit on Windows */
+static int64_t stream_tell(FILE *fp)
+{
+#ifdef WIN32
+	return (int64_t)_ftelli64(fp);
+#else
+	return (int64_t)ftello(fp);
+#endif
+}
+
+static bool stream_seek(FILE *fp, int64_t offset)
+{
+#ifdef WIN32
+	return _fseeki64(fp, offset, SEEK_SET) == 0;
+#else
+	return fseeko(fp, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+static void stream_endian_switch(void *data, size_t size, int count)
+{
+	switch (size) {
+		case 2:
+			BLI_endian_switch_int16_array(data, count);
+			break;
+		case 4:
+			BLI_endian_switch_int32_array(data, count);
+			break;
+		case 8:
+			BLI_endian_switch_int64_array(data, count);
+			break;
+	}
+}
+
+/* writes count values of the given size in little endian order */
+static bool stream_write(FILE *fp, const void *data, size_t size, int count)
+{
+	bool ok;
+
+	if (count == 0)
+		return true;
+
+	if (ENDIAN_ORDER == B_ENDIAN && size > 1) {
+		void *swapped = MEM_mallocN(size * count, "stream endian switch");
+		memcpy(swapped, data, size * count);
+		stream_endian_switch(swapped, size, count);
+		ok = fwrite(swapped, size, count, fp) == count;
+		MEM_freeN(swapped);
+	}
+	else {
+		ok = fwrite(data, size, count, fp) == count;
+	}
+
+	return ok;
+}
+
+/* reads count little endian values of the given size */
+static bool stream_read(FILE *fp, void *data, size_t size, int count)
+{
+	if (count == 0)
+		return true;
+
+	if (fread(data, size, count, fp) != count)
+		return false;
+
+	if (ENDIAN_ORDER == B_ENDIAN && size > 1)
+		stream_endian_switch(data, size, count);
+
+	return true;
+}
+
+static bool stream_write_header(FILE *fp, const FractureStreamHeader *header)
+{
+	const int values[4] = {header->version, header->frame_start, header->frame_count, header->state_count};
+	const int64_t offsets[2] = {header->state_table, header->frame_table};
+
+	return (fwrite(FRACTURE_STREAM_MAGIC, 1, 4, fp) == 4) &&
+	       stream_write(fp, values, sizeof(int), 4) &&
+	       stream_write(fp, offsets, sizeof(int64_t), 2);
+}
+
+static bool stream_read_header(FILE *fp, FractureStreamHeader *header)
+{
+	char magic[4];
+	int values[4];
+	int64_t offsets[2];
+
+	if (fread(magic, 1, 4, fp) != 4 || memcmp(magic, FRACTURE_STREAM_MAGIC, 4) != 0 ||
+	    !stream_read(fp, values, sizeof(int), 4) || !stream_read(fp, offsets, sizeof(int64_t), 2))
+	{
+		return false;
+	}
+
+	header->version = values[0];
+	header->frame_start = values[1];
+	header->frame_count = values[2];
+	header->state_count = values[3];
+	header->state_table = offsets[0];
+	header->frame_table = offsets[1];
+	return true;
+}
+
+/* ************************************** */
+/* Export */
+
+static bool stream_write_geometry(FILE *fp, FractureState *fs)
+{
+	FractureStreamGeometry geom;
+	DerivedMesh *dm = fs->visual_mesh;
+	MVert *mvert = dm->getVertArray(dm);
+	MPoly *mpoly = dm->getPolyArray(dm);
+	MLoop *mloop = dm->getLoopArray(dm);
+	MLoopUV *mluv = CustomData_get_layer(&dm->loopData, CD_MLOOPUV);
+	float (*co)[3];
+	short (*no)[3];
+	int *vert_island;
+	int (*poly)[2], *loop;
+	short *mat_nr;
+	char *pflag;
+	MeshIsland *mi;
+	int i, j;
+	bool ok = true;
+
+	geom.totvert = dm->getNumVerts(dm);
+	geom.totpoly = dm->getNumPolys(dm);
+	geom.totloop = dm->getNumLoops(dm);
+	geom.island_count = BLI_listbase_count(&fs->island_map);
+	geom.layers = mluv ? FRACTURE_STREAM_LOOPUV : 0;
+
+	/* the visual mesh holds the simulated positions, take the rest positions from the islands */
+	co = MEM_mallocN(sizeof(*co) * geom.totvert, "stream rest co");
+	no = MEM_mallocN(sizeof(*no) * geom.totvert, "stream rest no");
+	vert_island = MEM_mallocN(sizeof(int) * geom.totvert, "stream vert island");
+
+	for (i = 0; i < geom.totvert; i++) {
+		copy_v3_v3(co[i], mvert[i].co);
+		copy_v3_v3_short(no[i], mvert[i].no);
+		vert_island[i] = -1;
+	}
+
+	for (mi = fs->island_map.first, i = 0; mi; mi = mi->next, i++) {
+		if (mi->vertex_indices == NULL || mi->vertcos == NULL)
+			continue;
+
+		for (j = 0; j < mi->vertex_count; j++) {
+			int index = mi->vertex_indices[j];
+			if (index < 0 || index >= geom.totvert)
+				continue;
+
+			copy_v3_v3(co[index], mi->vertcos[j]);
+			if (mi->vertnos) {
+				copy_v3_v3_short(no[index], mi->vertnos[j]);
+			}
+			vert_island[index] = i;
+		}
+	}
+
+	poly = MEM_mallocN(sizeof(*poly) * geom.totpoly, "stream poly");
+	mat_nr = MEM_mallocN(sizeof(*mat_nr) * geom.totpoly, "stream mat_nr");
+	pflag = MEM_mallocN(sizeof(*pflag) * geom.totpoly, "stream pflag");
+	loop = MEM_mallocN(sizeof(*loop) * geom.totloop, "stream loop");
+
+	for (i = 0; i < geom.totpoly; i++) {
+		poly[i][0] = mpoly[i].loopstart;
+		poly[i][1] = mpoly[i].totloop;
+		mat_nr[i] = mpoly[i].mat_nr;
+		pflag[i] = mpoly[i].flag;
+	}
+
+	for (i = 0; i < geom.totloop; i++) {
+		loop[i] = (int)mloop[i].v;
+	}
+
+	{
+		const int counts[5] = {geom.totvert, geom.totpoly, geom.totloop, geom.island_count, geom.layers};
+		ok &= stream_write(fp, counts, sizeof(int), 5);
+	}
+
+	ok &= stream_write(fp, co, sizeof(float), 3 * geom.totvert);
+	ok &= stream_write(fp, no, sizeof(short), 3 * geom.totvert);
+	ok &= stream_write(fp, vert_island, sizeof(int), geom.totvert);
+	ok &= stream_write(fp, poly, sizeof(int), 2 * geom.totpoly);
+	ok &= stream_write(fp, mat_nr, sizeof(short), geom.totpoly);
+	ok &= stream_write(fp, pflag, sizeof(char), geom.totpoly);
+	ok &= stream_write(fp, loop, sizeof(int), geom.totloop);
+
+	if (mluv) {
+		float (*uv)[2] = MEM_mallocN(sizeof(*uv) * geom.totloop, "stream uv");
+
+		for (i = 0; i < geom.totloop; i++) {
+			copy_v2_v2(uv[i], mluv[i].uv);
+		}
+
+		ok &= stream_write(fp, uv, sizeof(float), 2 * geom.totloop);
+		MEM_freeN(uv);
+	}
+
+	MEM_freeN(co);
+	MEM_freeN(no);
+	MEM_freeN(vert_island);
+	MEM_freeN(poly);
+	MEM_freeN(mat_nr);
+	MEM_freeN(pflag);
+	MEM_freeN(loop);
+
+	return ok;
+}
+
+static bool stream_write_frame(FILE *fp, Object *ob, FractureState *fs, int state)
+{
+	const int frame[2] = {state, fs ? BLI_listbase_count(&fs->island_map) : 0};
+	MeshIsland *mi;
+	bool ok = true;
+
+	ok &= stream_write(fp, frame, sizeof(int), 2);
+
+	if (fs == NULL)
+		return ok;
+
+	invert_m4_m4(ob->imat, ob->obmat);
+
+	for (mi = fs->island_map.first; mi && ok; mi = mi->next) {
+		float mat[4][4], world[4][4], cent[4][4];
+
+		/* maps rest positions in object space to the current ones */
+		unit_m4(cent);
+		negate_v3_v3(cent[3], mi->centroid);
+		BKE_fracture_island_matrix_world(ob, mi, world);
+		mul_m4_series(mat, ob->imat, world, cent);
+
+		ok &= stream_write(fp, mat, sizeof(float), 16);
+	}
+
+	return ok;
+}
+
+/* steps the scene through the frame range and writes the simulated visual mesh of ob,
+ * shard geometry is written once per fracture state, per frame only the island transforms */
+bool BKE_fracture_stream_export(Main *bmain, Scene *scene, Object *ob, const char *filepath, int start, int end)
+{
+	FractureContainer *fc;
+	FractureStreamHeader header = {0};
+	FractureState **states = NULL;
+	int64_t *state_offsets = NULL, *frame_offsets;
+	int state_count = 0, state_alloc = 0;
+	int frame, cfra = scene->r.cfra;
+	double time_start = PIL_check_seconds_timer();
+	FILE *fp;
+	bool ok = true;
+
+	if (ob->rigidbody_object == NULL || ob->rigidbody_object->fracture_objects == NULL || end < start)
+		return false;
+
+	fc = ob->rigidbody_object->fracture_objects;
+
+	BLI_make_existing_file(filepath);
+	fp = BLI_fopen(filepath, "wb");
+	if (fp == NULL)
+		return false;
+
+	header.version = FRACTURE_STREAM_VERSION;
+	header.frame_start = start;
+	header.frame_count = end - start + 1;
+
+	/* written again with the table offsets at the end */
+	ok &= stream_write_header(fp, &header);
+
+	frame_offsets = MEM_mallocN(sizeof(int64_t) * header.frame_count, "stream frame offsets");
+
+	for (frame = start; frame <= end && ok; frame++) {
+		FractureState *fs;
+		int state = -1, i;
+
+		scene->r.cfra = frame;
+		BKE_scene_update_for_newframe(bmain->eval_ctx, bmain, scene, scene->lay);
+
+		fs = fc->current;
+
+		if (fs && fs->visual_mesh) {
+			for (i = 0; i < state_count; i++) {
+				if (states[i] == fs) {
+					state = i;
+					break;
+				}
+			}
+
+			if (state == -1) {
+				/* dynamic fracture switched to a new state, store its geometry once */
+				if (state_count == state_alloc) {
+					state_alloc = state_alloc ? state_alloc * 2 : 4;
+					states = MEM_reallocN_id(states, sizeof(FractureState *) * state_alloc, "stream states");
+					state_offsets = MEM_reallocN_id(state_offsets, sizeof(int64_t) * state_alloc, "stream state offsets");
+				}
+
+				state = state_count++;
+				states[state] = fs;
+				state_offsets[state] = stream_tell(fp);
+				ok &= stream_write_geometry(fp, fs);
+			}
+		}
+		else {
+			fs = NULL;
+		}
+
+		frame_offsets[frame - start] = stream_tell(fp);
+		ok &= stream_write_frame(fp, ob, fs, state);
+	}
+
+	header.state_count = state_count;
+	header.state_table = stream_tell(fp);
+	ok &= stream_write(fp, state_offsets, sizeof(int64_t), state_count);
+	header.frame_table = stream_tell(fp);
+	ok &= stream_write(fp, frame_offsets, sizeof(int64_t), header.frame_count);
+
+	ok &= stream_seek(fp, 0);
+	ok &= stream_write_header(fp, &header);
+
+	fclose(fp);
+
+	if (!ok) {
+		BLI_delete(filepath, false, false);
+	}
+
+	MEM_freeN(frame_offsets);
+	if (states) {
+		MEM_freeN(states);
+		MEM_freeN(state_offsets);
+	}
+
+	/* back to where we were */
+	scene->r.cfra = cfra;
+	BKE_scene_update_for_newframe(bmain->eval_ctx, bmain, scene, scene->lay);
+
+	printf("Fracture stream export: %d frames, %d states, %g\n", header.frame_count, state_count,
+	       PIL_check_seconds_timer() - time_start);
+
+	return ok;
+}
+
+/* ************************************** */
+/* Import */
+
+/* Decoded geometry of the last read state, so playback only reads the island matrices of each
+ * frame. Owned by the modifier, dropped when the file path, size or modification time changes */
+typedef struct FractureStreamCache {
+	FILE *fp;
+	char filepath[FILE_MAX];
+	int64_t file_size;
+	int64_t file_mtime;
+	FractureStreamHeader header;
+
+	int state;  /* state of the geometry below, -1 if none is decoded yet */
+	int island_count;
+	float (*co)[3];
+	short (*no)[3];
+	int *vert_island;
+	DerivedMesh *dm;  /* topology, edges and uvs of the state at rest positions */
+} FractureStreamCache;
+
+static void stream_cache_free_geometry(FractureStreamCache *cache)
+{
+	if (cache->dm) {
+		cache->dm->needsFree = 1;
+		cache->dm->release(cache->dm);
+		cache->dm = NULL;
+	}
+
+	MEM_SAFE_FREE(cache->co);
+	MEM_SAFE_FREE(cache->no);
+	MEM_SAFE_FREE(cache->vert_island);
+	cache->state = -1;
+	cache->island_count = 0;
+}
+
+void BKE_fracture_stream_cache_free(FractureStreamCache *cache)
+{
+	if (cache == NULL)
+		return;
+
+	stream_cache_free_geometry(cache);
+
+	if (cache->fp)
+		fclose(cache->fp);
+
+	MEM_freeN(cache);
+}
+
+/* bytes left behind the current file position, used to reject counts a damaged file can't hold */
+static int64_t stream_remaining(FractureStreamCache *cache)
+{
+	const int64_t pos = stream_tell(cache->fp);
+	return (pos < 0) ? 0 : cache->file_size - pos;
+}
+
+static bool stream_read_offset(FractureStreamCache *cache, int64_t table, int index, int64_t *r_offset)
+{
+	FILE *fp = cache->fp;
+
+	return stream_seek(fp, table + (int64_t)sizeof(int64_t) * index) &&
+	       stream_read(fp, r_offset, sizeof(int64_t), 1) &&
+	       (*r_offset >= FRACTURE_STREAM_HEADER_SIZE) && (*r_offset < cache->file_size) &&
+	       stream_seek(fp, *r_offset);
+}
+
+static FractureStreamCache *stream_cache_open(const char *filepath, const BLI_stat_t *st, const char **r_err)
+{
+	FractureStreamCache *cache;
+	FractureStreamHeader *header;
+	FILE *fp;
+
+	fp = BLI_fopen(filepath, "rb");
+	if (fp == NULL) {
+		*r_err = "Fracture stream file can't be opened";
+		return NULL;
+	}
+
+	cache = MEM_callocN(sizeof(FractureStreamCache), "FractureStreamCache");
+	cache->fp = fp;
+	cache->state = -1;
+	cache->file_size = (int64_t)st->st_size;
+	cache->file_mtime = (int64_t)st->st_mtime;
+	BLI_strncpy(cache->filepath, filepath, sizeof(cache->filepath));
+
+	header = &cache->header;
+	if (!stream_read_header(fp, header) ||
+	    header->version != FRACTURE_STREAM_VERSION || header->frame_count <= 0 || header->state_count < 0)
+	{
+		*r_err = "Not a fracture stream file";
+		BKE_fracture_stream_cache_free(cache);
+		return NULL;
+	}
+
+	/* both offset tables must lie within the file */
+	if (header->state_table < FRACTURE_STREAM_HEADER_SIZE || header->frame_table < FRACTURE_STREAM_HEADER_SIZE ||
+	    header->state_count > (cache->file_size - header->state_table) / (int64_t)sizeof(int64_t) ||
+	    header->frame_count > (cache->file_size - header->frame_table) / (int64_t)sizeof(int64_t))
+	{
+		*r_err = "Fracture stream file is corrupt";
+		BKE_fracture_stream_cache_free(cache);
+		return NULL;
+	}
+
+	return cache;
+}
+
+/* don't let a damaged file index out of the vertex or loop arrays */
+static bool stream_check_topology(DerivedMesh *dm)
+{
+	const int totvert = dm->getNumVerts(dm), totloop = dm->getNumLoops(dm), totpoly = dm->getNumPolys(dm);
+	MPoly *mp = CDDM_get_polys(dm);
+	MLoop *ml = CDDM_get_loops(dm);
+	int i;
+
+	for (i = 0; i < totpoly; i++, mp++) {
+		if (mp->loopstart < 0 || mp->totloop < 0 || mp->loopstart + mp->totloop > totloop)
+			return false;
+	}
+
+	for (i = 0; i < totloop; i++, ml++) {
+		if (ml->v >= (unsigned int)totvert)
+			return false;
+	}
+
+	return true;
+}
+
+/* decodes the geometry block of a state into the cache */
+static bool stream_cache_read_state(FractureStreamCache *cache, int state)
+{
+	FractureStreamGeometry geom;
+	FILE *fp = cache->fp;
+	DerivedMesh *dm;
+	MVert *mvert;
+	MPoly *mpoly;
+	MLoop *mloop;
+	int (*poly)[2], *loop;
+	short *mat_nr;
+	char *pflag;
+	int counts[5];
+	int64_t offset, needed;
+	bool ok = true;
+	int i;
+
+	stream_cache_free_geometry(cache);
+
+	if (!stream_read_offset(cache, cache->header.state_table, state, &offset) ||
+	    !stream_read(fp, counts, sizeof(int), 5))
+	{
+		return false;
+	}
+
+	geom.totvert = counts[0];
+	geom.totpoly = counts[1];
+	geom.totloop = counts[2];
+	geom.island_count = counts[3];
+	geom.layers = counts[4];
+
+	if (geom.totvert < 0 || geom.totpoly < 0 || geom.totloop < 0 || geom.island_count < 0)
+		return false;
+
+	needed = (int64_t)geom.totvert * FRACTURE_STREAM_VERT_SIZE + (int64_t)geom.totpoly * FRACTURE_STREAM_POLY_SIZE +
+	         (int64_t)geom.totloop * FRACTURE_STREAM_LOOP_SIZE;
+	if (geom.layers & FRACTURE_STREAM_LOOPUV)
+		needed += (int64_t)geom.totloop * FRACTURE_STREAM_LOOPUV_SIZE;
+
+	if (needed > stream_remaining(cache))
+		return false;
+
+	cache->co = MEM_mallocN(sizeof(*cache->co) * geom.totvert, "stream co");
+	cache->no = MEM_mallocN(sizeof(*cache->no) * geom.totvert, "stream no");
+	cache->vert_island = MEM_mallocN(sizeof(int) * geom.totvert, "stream vert island");
+
+	ok &= stream_read(fp, cache->co, sizeof(float), 3 * geom.totvert);
+	ok &= stream_read(fp, cache->no, sizeof(short), 3 * geom.totvert);
+	ok &= stream_read(fp, cache->vert_island, sizeof(int), geom.totvert);
+
+	poly = MEM_mallocN(sizeof(*poly) * geom.totpoly, "stream poly");
+	mat_nr = MEM_mallocN(sizeof(*mat_nr) * geom.totpoly, "stream mat_nr");
+	pflag = MEM_mallocN(sizeof(*pflag) * geom.totpoly, "stream pflag");
+	loop = MEM_mallocN(sizeof(*loop) * geom.totloop, "stream loop");
+
+	ok &= stream_read(fp, poly, sizeof(int), 2 * geom.totpoly);
+	ok &= stream_read(fp, mat_nr, sizeof(short), geom.totpoly);
+	ok &= stream_read(fp, pflag, sizeof(char), geom.totpoly);
+	ok &= stream_read(fp, loop, sizeof(int), geom.totloop);
+
+	dm = CDDM_new(geom.totvert, 0, 0, geom.totloop, geom.totpoly);
+	cache->dm = dm;
+
+	if (ok) {
+		mpoly = CDDM_get_polys(dm);
+		for (i = 0; i < geom.totpoly; i++) {
+			mpoly[i].loopstart = poly[i][0];
+			mpoly[i].totloop = poly[i][1];
+			mpoly[i].mat_nr = mat_nr[i];
+			mpoly[i].flag = pflag[i];
+		}
+
+		mloop = CDDM_get_loops(dm);
+		for (i = 0; i < geom.totloop; i++) {
+			mloop[i].v = (unsigned int)loop[i];
+		}
+	}
+
+	MEM_freeN(poly);
+	MEM_freeN(mat_nr);
+	MEM_freeN(pflag);
+	MEM_freeN(loop);
+
+	if (ok && (geom.layers & FRACTURE_STREAM_LOOPUV)) {
+		MLoopUV *mluv = CustomData_add_layer(&dm->loopData, CD_MLOOPUV, CD_CALLOC, NULL, geom.totloop);
+		float (*uv)[2] = MEM_mallocN(sizeof(*uv) * geom.totloop, "stream uv");
+
+		CustomData_add_layer(&dm->polyData, CD_MTEXPOLY, CD_CALLOC, NULL, geom.totpoly);
+		ok &= stream_read(fp, uv, sizeof(float), 2 * geom.totloop);
+
+		for (i = 0; ok && i < geom.totloop; i++) {
+			copy_v2_v2(mluv[i].uv, uv[i]);
+		}
+
+		MEM_freeN(uv);
+	}
+
+	ok = ok && stream_check_topology(dm);
+
+	if (!ok) {
+		stream_cache_free_geometry(cache);
+		return false;
+	}
+
+	mvert = CDDM_get_verts(dm);
+	for (i = 0; i < geom.totvert; i++) {
+		copy_v3_v3(mvert[i].co, cache->co[i]);
+		copy_v3_v3_short(mvert[i].no, cache->no[i]);
+	}
+
+	CDDM_calc_edges(dm);
+
+	cache->state = state;
+	cache->island_count = geom.island_count;
+	return true;
+}
+
+/* builds the visual mesh of the given frame, frames outside of the stream are clamped,
+ * returns NULL without error if there was no fracture result in that frame.
+ * *r_cache keeps the file and the last decoded state between calls, pass a pointer to NULL first */
+DerivedMesh *BKE_fracture_stream_read(const char *filepath, int frame, FractureStreamCache **r_cache,
+                                      const char **r_err)
+{
+	FractureStreamCache *cache = *r_cache;
+	FractureStreamFrame rec;
+	int values[2] = {-1, 0};
+	BLI_stat_t st;
+	DerivedMesh *dm = NULL;
+	float (*mats)[4][4] = NULL;
+	int64_t offset;
+	bool ok = true;
+	int i;
+
+	*r_err = NULL;
+
+	if (BLI_stat(filepath, &st) != 0) {
+		BKE_fracture_stream_cache_free(cache);
+		*r_cache = NULL;
+		*r_err = "Fracture stream file can't be opened";
+		return NULL;
+	}
+
+	/* a re-export replaces the file, start over then */
+	if (cache && (!STREQ(cache->filepath, filepath) || cache->file_size != (int64_t)st.st_size ||
+	              cache->file_mtime != (int64_t)st.st_mtime))
+	{
+		BKE_fracture_stream_cache_free(cache);
+		cache = *r_cache = NULL;
+	}
+
+	if (cache == NULL) {
+		cache = *r_cache = stream_cache_open(filepath, &st, r_err);
+		if (cache == NULL)
+			return NULL;
+	}
+
+	CLAMP(frame, cache->header.frame_start, cache->header.frame_start + cache->header.frame_count - 1);
+
+	/* frame record, the matrices must fit into the rest of the file */
+	ok = stream_read_offset(cache, cache->header.frame_table, frame - cache->header.frame_start, &offset) &&
+	     stream_read(cache->fp, values, sizeof(int), 2);
+
+	rec.state = values[0];
+	rec.island_count = values[1];
+
+	ok = ok && rec.state < cache->header.state_count && rec.island_count >= 0 &&
+	     rec.island_count <= stream_remaining(cache) / FRACTURE_STREAM_MATRIX_SIZE;
+
+	if (ok && rec.state >= 0) {
+		mats = MEM_mallocN(sizeof(*mats) * max_ii(rec.island_count, 1), "stream island matrices");
+		ok &= stream_read(cache->fp, mats, sizeof(float), 16 * rec.island_count);
+
+		/* geometry is only decoded again when the frame shows another state */
+		if (ok && rec.state != cache->state) {
+			ok = stream_cache_read_state(cache, rec.state);
+		}
+
+		ok = ok && (cache->island_count == rec.island_count);
+	}
+
+	if (ok && rec.state >= 0) {
+		const int totvert = cache->dm->getNumVerts(cache->dm);
+		MVert *mvert;
+
+		dm = CDDM_copy(cache->dm);
+		mvert = CDDM_get_verts(dm);
+
+		for (i = 0; i < totvert; i++) {
+			const int island = cache->vert_island[i];
+			float fno[3];
+
+			if (island >= 0 && island < rec.island_count) {
+				mul_m4_v3(mats[island], mvert[i].co);
+
+				normal_short_to_float_v3(fno, cache->no[i]);
+				mul_mat3_m4_v3(mats[island], fno);
+				normalize_v3(fno);
+				normal_float_to_short_v3(mvert[i].no, fno);
+			}
+		}
+	}
+
+	if (mats)
+		MEM_freeN(mats);
+
+	if (!ok) {
+		*r_err = "Fracture stream file is corrupt";
+		BKE_fracture_stream_cache_free(cache);
+		*r_cache = NULL;
+		return NULL;
+	}
+
+	return dm;
+}
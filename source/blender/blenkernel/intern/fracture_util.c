@@ -40,11 +40,15 @@
 #include "BLI_alloca.h"
 #include "BLI_boxpack2d.h"
 #include "BLI_convexhull2d.h"
+#include "BLI_edgehash.h"
 #include "BLI_ghash.h"
+#include "BLI_kdopbvh.h"
 #include "BLI_math.h"
 #include "BLI_rand.h"
 #include "BLI_sys_types.h"
 
+#include "BKE_bvhutils.h"
+
 #include "DNA_fracture_types.h"
 #include "DNA_meshdata_types.h"
 #include "DNA_material_types.h"
@@ -159,21 +163,15 @@ static void do_unwrap(MPoly *mp, MVert *mvert, MLoop* mloop, int i, MLoopUV **ml
 	MEM_freeN(verts);
 }
 
-void unwrap_shard_dm(DerivedMesh *dm)
+/* project each poly on its dominant axis and box pack them, returns the loop uvs */
+static MLoopUV *unwrap_polys(MVert *mvert, MPoly *mpoly, int totpoly, MLoop *mloop, int totloop)
 {
-	MVert *mvert;
-	MLoop *mloop;
-	MPoly *mpoly, *mp;
-	int totpoly, i = 0;
-	MLoopUV *mluv = MEM_callocN(sizeof(MLoopUV) * dm->numLoopData, "mluv");
-	BoxPack *boxpack = MEM_mallocN(sizeof(BoxPack) * dm->numPolyData, "boxpack");
+	MPoly *mp;
+	int i = 0;
+	MLoopUV *mluv = MEM_callocN(sizeof(MLoopUV) * totloop, "mluv");
+	BoxPack *boxpack = MEM_mallocN(sizeof(BoxPack) * totpoly, "boxpack");
 	float scale, tot_width, tot_height;
 
-	/* set inner material on child shard */
-	mvert = dm->getVertArray(dm);
-	mpoly = dm->getPolyArray(dm);
-	mloop = dm->getLoopArray(dm);
-	totpoly = dm->getNumPolys(dm);
 	for (i = 0, mp = mpoly; i < totpoly; i++, mp++) {
 		do_unwrap(mp, mvert, mloop, i, &mluv, &boxpack);
 	}
@@ -204,10 +202,50 @@ void unwrap_shard_dm(DerivedMesh *dm)
 
 	MEM_freeN(boxpack);
 
+	return mluv;
+}
+
+void unwrap_shard_dm(DerivedMesh *dm)
+{
+	MLoopUV *mluv;
+	int totpoly = dm->getNumPolys(dm);
+
+	mluv = unwrap_polys(dm->getVertArray(dm), dm->getPolyArray(dm), totpoly, dm->getLoopArray(dm), dm->numLoopData);
+
 	CustomData_add_layer_named(&dm->loopData, CD_MLOOPUV, CD_ASSIGN, mluv, dm->numLoopData, "InnerUV");
 	CustomData_add_layer_named(&dm->polyData, CD_MTEXPOLY, CD_CALLOC, NULL, totpoly, "InnerUV");
 }
 
+/* unwrap a voronoi cell into its own loop data, only touches the shard so cells can be unwrapped in parallel */
+void BKE_fracture_shard_unwrap(Shard *s)
+{
+	MLoopUV *mluv;
+
+	if (s->totpoly == 0 || CustomData_has_layer(&s->loopData, CD_MLOOPUV)) {
+		return;
+	}
+
+	mluv = unwrap_polys(s->mvert, s->mpoly, s->totpoly, s->mloop, s->totloop);
+	CustomData_add_layer_named(&s->loopData, CD_MLOOPUV, CD_ASSIGN, mluv, s->totloop, "InnerUV");
+}
+
+/* cell mesh for cutting, reuses the uvs of BKE_fracture_shard_unwrap if the cell has them already */
+static DerivedMesh *cell_create_dm(Shard *child)
+{
+	DerivedMesh *dm = BKE_shard_create_dm(child, false);
+	MLoopUV *mluv = CustomData_get_layer(&child->loopData, CD_MLOOPUV);
+
+	if (mluv) {
+		CustomData_add_layer_named(&dm->loopData, CD_MLOOPUV, CD_DUPLICATE, mluv, dm->numLoopData, "InnerUV");
+		CustomData_add_layer_named(&dm->polyData, CD_MTEXPOLY, CD_CALLOC, NULL, dm->numPolyData, "InnerUV");
+	}
+	else {
+		unwrap_shard_dm(dm);
+	}
+
+	return dm;
+}
+
 static bool check_non_manifold(DerivedMesh* dm)
 {
 	BMesh *bm;
@@ -525,11 +563,795 @@ static void do_set_inner_material(Shard **other, float mat[4][4], DerivedMesh* l
 	}
 }
 
+/* Convex cell clipping
+ *
+ * Voronoi cells are always convex, so intersecting the parent mesh with a cell can be done by
+ * clipping the (closed) parent successively against each cell plane and capping the cut loops,
+ * on flat vertex / loop / poly arrays. This avoids converting the parent into a carve mesh
+ * for every single cell; carve remains the fallback whenever the clip result isn't watertight
+ * (e.g. cross sections with holes, non-manifold parents) */
+
+typedef struct ClipVert {
+	float co[3];
+	int orig; /* parent vertex to take custom data from */
+} ClipVert;
+
+typedef struct ClipLoop {
+	int v;
+	float uv[2];
+} ClipLoop;
+
+typedef struct ClipPoly {
+	int loopstart, totloop;
+	int orig; /* parent poly, -1 for cap polys */
+	short mat_nr;
+	char flag;
+	char pad;
+} ClipPoly;
+
+typedef struct ClipMesh {
+	ClipVert *verts;
+	ClipLoop *loops;
+	ClipPoly *polys;
+	int totvert, totloop, totpoly;
+	int alloc_vert, alloc_loop, alloc_poly;
+} ClipMesh;
+
+typedef enum ClipResult {
+	CLIP_OK = 0,
+	CLIP_SKIP,  /* plane doesn't cut the mesh, input stays valid */
+	CLIP_EMPTY, /* mesh is entirely outside of the plane */
+	CLIP_FAIL,  /* cut loops couldn't be capped, use carve */
+} ClipResult;
+
+static void clip_mesh_alloc(ClipMesh *cm, int totvert, int totloop, int totpoly)
+{
+	cm->alloc_vert = max_ii(totvert, 16);
+	cm->alloc_loop = max_ii(totloop, 16);
+	cm->alloc_poly = max_ii(totpoly, 16);
+	cm->verts = MEM_mallocN(sizeof(ClipVert) * cm->alloc_vert, "clip verts");
+	cm->loops = MEM_mallocN(sizeof(ClipLoop) * cm->alloc_loop, "clip loops");
+	cm->polys = MEM_mallocN(sizeof(ClipPoly) * cm->alloc_poly, "clip polys");
+	cm->totvert = cm->totloop = cm->totpoly = 0;
+}
+
+static void clip_mesh_free(ClipMesh *cm)
+{
+	MEM_freeN(cm->verts);
+	MEM_freeN(cm->loops);
+	MEM_freeN(cm->polys);
+}
+
+static int clip_add_vert(ClipMesh *cm, const float co[3], int orig)
+{
+	if (cm->totvert == cm->alloc_vert) {
+		cm->alloc_vert *= 2;
+		cm->verts = MEM_reallocN(cm->verts, sizeof(ClipVert) * cm->alloc_vert);
+	}
+
+	copy_v3_v3(cm->verts[cm->totvert].co, co);
+	cm->verts[cm->totvert].orig = orig;
+	return cm->totvert++;
+}
+
+static void clip_add_loop(ClipMesh *cm, int v, const float uv[2])
+{
+	if (cm->totloop == cm->alloc_loop) {
+		cm->alloc_loop *= 2;
+		cm->loops = MEM_reallocN(cm->loops, sizeof(ClipLoop) * cm->alloc_loop);
+	}
+
+	cm->loops[cm->totloop].v = v;
+	copy_v2_v2(cm->loops[cm->totloop].uv, uv);
+	cm->totloop++;
+}
+
+static void clip_add_poly(ClipMesh *cm, int loopstart, int orig, short mat_nr, char flag)
+{
+	ClipPoly *cp;
+
+	if (cm->totpoly == cm->alloc_poly) {
+		cm->alloc_poly *= 2;
+		cm->polys = MEM_reallocN(cm->polys, sizeof(ClipPoly) * cm->alloc_poly);
+	}
+
+	cp = &cm->polys[cm->totpoly++];
+	cp->loopstart = loopstart;
+	cp->totloop = cm->totloop - loopstart;
+	cp->orig = orig;
+	cp->mat_nr = mat_nr;
+	cp->flag = flag;
+	cp->pad = 0;
+}
+
+static void clip_mesh_from_dm(ClipMesh *cm, DerivedMesh *dm)
+{
+	MVert *mvert = dm->getVertArray(dm);
+	MLoop *mloop = dm->getLoopArray(dm);
+	MPoly *mpoly = dm->getPolyArray(dm);
+	MLoopUV *mluv = CustomData_get_layer(&dm->loopData, CD_MLOOPUV);
+	int totvert = dm->getNumVerts(dm), totloop = dm->getNumLoops(dm), totpoly = dm->getNumPolys(dm);
+	const float zero_uv[2] = {0.0f, 0.0f};
+	int i, j;
+
+	clip_mesh_alloc(cm, totvert, totloop, totpoly);
+
+	for (i = 0; i < totvert; i++) {
+		clip_add_vert(cm, mvert[i].co, i);
+	}
+
+	for (i = 0; i < totpoly; i++) {
+		MPoly *mp = &mpoly[i];
+		int loopstart = cm->totloop;
+
+		for (j = mp->loopstart; j < mp->loopstart + mp->totloop; j++) {
+			clip_add_loop(cm, mloop[j].v, mluv ? mluv[j].uv : zero_uv);
+		}
+
+		clip_add_poly(cm, loopstart, i, mp->mat_nr, mp->flag);
+	}
+}
+
+/* new vertex on edge v1-v2, shared between both adjacent polys */
+static int clip_split_edge(ClipMesh *out, EdgeHash *eh, const ClipVert *verts, int v1, int v2, float t)
+{
+	void **val_p = BLI_edgehash_lookup_p(eh, v1, v2);
+	float co[3];
+
+	if (val_p) {
+		return GET_INT_FROM_POINTER(*val_p) - 1;
+	}
+	else {
+		int v;
+
+		interp_v3_v3v3(co, verts[v1].co, verts[v2].co, t);
+		v = clip_add_vert(out, co, (t < 0.5f) ? verts[v1].orig : verts[v2].orig);
+		BLI_edgehash_insert(eh, v1, v2, SET_INT_IN_POINTER(v + 1));
+		return v;
+	}
+}
+
+/* close the cut with one cap poly per loop of cut edges, fails on open or nested loops */
+static ClipResult clip_add_caps(ClipMesh *out, int (*cut_edges)[2], int totcut, const float no[3],
+                                short mat_nr, char flag, float uv_basis[2][3], const float uv_origin[3], float uv_scale)
+{
+	int *next = MEM_mallocN(sizeof(int) * out->totvert, "clip cap next");
+	int *loop_start = MEM_mallocN(sizeof(int) * (totcut + 1), "clip cap loops");
+	int *loop_verts = MEM_mallocN(sizeof(int) * totcut, "clip cap loop verts");
+	int i, j, totloops = 0, totverts = 0;
+	ClipResult result = CLIP_OK;
+
+	fill_vn_i(next, out->totvert, -1);
+
+	for (i = 0; i < totcut; i++) {
+		if (next[cut_edges[i][0]] != -1) {
+			/* more than one cut edge leaving a vertex, not manifold on the plane */
+			result = CLIP_FAIL;
+			goto finally;
+		}
+		next[cut_edges[i][0]] = cut_edges[i][1];
+	}
+
+	/* chain the edges into closed loops */
+	for (i = 0; i < totcut; i++) {
+		int start = cut_edges[i][0], v = start;
+
+		if (next[start] == -1)
+			continue;
+
+		loop_start[totloops] = totverts;
+		do {
+			int n = next[v];
+			if (n == -1 || totverts == totcut) {
+				/* open chain */
+				result = CLIP_FAIL;
+				goto finally;
+			}
+			loop_verts[totverts++] = v;
+			next[v] = -1;
+			v = n;
+		} while (v != start);
+
+		if (totverts - loop_start[totloops] < 3) {
+			/* degenerate, ignore */
+			totverts = loop_start[totloops];
+		}
+		else {
+			totloops++;
+		}
+	}
+	loop_start[totloops] = totverts;
+
+	for (i = 0; i < totloops; i++) {
+		int len = loop_start[i + 1] - loop_start[i];
+		float (*co)[3] = MEM_mallocN(sizeof(float) * 3 * len, "clip cap coords");
+		float loop_no[3];
+
+		for (j = 0; j < len; j++) {
+			copy_v3_v3(co[j], out->verts[loop_verts[loop_start[i] + j]].co);
+		}
+
+		normal_poly_v3(loop_no, (const float (*)[3])co, len);
+		MEM_freeN(co);
+
+		/* a reversed loop is a hole in the cross section, can't be represented by a single ngon */
+		if (dot_v3v3(loop_no, no) <= 0.0f) {
+			result = CLIP_FAIL;
+			goto finally;
+		}
+	}
+
+	if (totloops > 1) {
+		/* nested loops are holes as well */
+		for (i = 0; i < totloops; i++) {
+			int len = loop_start[i + 1] - loop_start[i];
+			float (*co2)[2] = MEM_mallocN(sizeof(float) * 2 * len, "clip cap coords 2d");
+
+			for (j = 0; j < len; j++) {
+				const float *co = out->verts[loop_verts[loop_start[i] + j]].co;
+				co2[j][0] = dot_v3v3(co, uv_basis[0]);
+				co2[j][1] = dot_v3v3(co, uv_basis[1]);
+			}
+
+			for (j = 0; j < totloops; j++) {
+				const float *co = out->verts[loop_verts[loop_start[j]]].co;
+				float pt[2];
+
+				if (i == j)
+					continue;
+
+				pt[0] = dot_v3v3(co, uv_basis[0]);
+				pt[1] = dot_v3v3(co, uv_basis[1]);
+				if (isect_point_poly_v2(pt, (const float (*)[2])co2, len, false)) {
+					MEM_freeN(co2);
+					result = CLIP_FAIL;
+					goto finally;
+				}
+			}
+
+			MEM_freeN(co2);
+		}
+	}
+
+	for (i = 0; i < totloops; i++) {
+		int loopstart = out->totloop;
+
+		for (j = loop_start[i]; j < loop_start[i + 1]; j++) {
+			float rel[3], uv[2];
+			int v = loop_verts[j];
+
+			/* planar projection into the cell bounds */
+			sub_v3_v3v3(rel, out->verts[v].co, uv_origin);
+			uv[0] = dot_v3v3(rel, uv_basis[0]) * uv_scale;
+			uv[1] = dot_v3v3(rel, uv_basis[1]) * uv_scale;
+			clip_add_loop(out, v, uv);
+		}
+
+		clip_add_poly(out, loopstart, -1, mat_nr, flag);
+	}
+
+finally:
+	MEM_freeN(next);
+	MEM_freeN(loop_start);
+	MEM_freeN(loop_verts);
+	return result;
+}
+
+/* keep the part of the closed mesh "in" behind the plane (dot(no, co) <= d), written to "out" */
+static ClipResult clip_mesh_plane(ClipMesh *in, ClipMesh *out, const float no[3], float d, float eps,
+                                  short cap_mat_nr, char cap_flag, const float uv_origin[3], float uv_scale)
+{
+	float *dist = MEM_mallocN(sizeof(float) * in->totvert, "clip dist");
+	int (*cut_edges)[2];
+	int totcut = 0, alloc_cut = 16;
+	bool any_outside = false, any_inside = false;
+	float uv_basis[2][3];
+	EdgeHash *eh;
+	ClipResult result;
+	int i, j;
+
+	for (i = 0; i < in->totvert; i++) {
+		dist[i] = dot_v3v3(no, in->verts[i].co) - d;
+	}
+
+	/* only consider verts which are actually used, outside verts of earlier planes linger in the array */
+	for (i = 0; i < in->totloop; i++) {
+		if (dist[in->loops[i].v] > eps)
+			any_outside = true;
+		else
+			any_inside = true;
+	}
+
+	if (!any_outside) {
+		MEM_freeN(dist);
+		return CLIP_SKIP;
+	}
+
+	if (!any_inside) {
+		MEM_freeN(dist);
+		return CLIP_EMPTY;
+	}
+
+	clip_mesh_alloc(out, in->totvert, in->totloop, in->totpoly);
+	memcpy(out->verts, in->verts, sizeof(ClipVert) * in->totvert);
+	out->totvert = in->totvert;
+
+	eh = BLI_edgehash_new_ex(__func__, 256);
+	cut_edges = MEM_mallocN(sizeof(int) * 2 * alloc_cut, "clip cut edges");
+
+	for (i = 0; i < in->totpoly; i++) {
+		ClipPoly *cp = &in->polys[i];
+		ClipLoop *loops = &in->loops[cp->loopstart];
+		int loopstart = out->totloop;
+		int exits[64], entries[64], totexit = 0, totentry = 0, first_event = -1;
+		bool all_on = true, out_on_plane = true;
+
+		for (j = 0; j < cp->totloop; j++) {
+			if (fabsf(dist[loops[j].v]) > eps) {
+				all_on = false;
+				break;
+			}
+		}
+
+		if (all_on) {
+			/* coplanar poly, keep it only if it faces away from the kept side */
+			float (*co)[3] = MEM_mallocN(sizeof(float) * 3 * cp->totloop, "clip coplanar");
+			float poly_no[3];
+
+			for (j = 0; j < cp->totloop; j++) {
+				copy_v3_v3(co[j], in->verts[loops[j].v].co);
+			}
+			normal_poly_v3(poly_no, (const float (*)[3])co, cp->totloop);
+			MEM_freeN(co);
+
+			if (dot_v3v3(poly_no, no) > 0.0f) {
+				for (j = 0; j < cp->totloop; j++) {
+					clip_add_loop(out, loops[j].v, loops[j].uv);
+				}
+				clip_add_poly(out, loopstart, cp->orig, cp->mat_nr, cp->flag);
+			}
+			continue;
+		}
+
+		for (j = 0; j < cp->totloop; j++) {
+			ClipLoop *cur = &loops[j], *nxt = &loops[(j + 1) % cp->totloop];
+			float dc = dist[cur->v], dn = dist[nxt->v];
+
+			if (dc <= eps) {
+				clip_add_loop(out, cur->v, cur->uv);
+				if (dc < -eps)
+					out_on_plane = false;
+			}
+
+			if ((dc < -eps && dn > eps) || (dc > eps && dn < -eps)) {
+				float t = dc / (dc - dn), uv[2];
+				int v = clip_split_edge(out, eh, in->verts, cur->v, nxt->v, t);
+
+				interp_v2_v2v2(uv, cur->uv, nxt->uv, t);
+				clip_add_loop(out, v, uv);
+
+				if (dc < -eps) {
+					if (first_event == -1) first_event = 0;
+					if (totexit < 64) exits[totexit] = v;
+					totexit++;
+				}
+				else {
+					if (first_event == -1) first_event = 1;
+					if (totentry < 64) entries[totentry] = v;
+					totentry++;
+				}
+			}
+			else if (dc <= eps && dc >= -eps && dn > eps) {
+				if (first_event == -1) first_event = 0;
+				if (totexit < 64) exits[totexit] = cur->v;
+				totexit++;
+			}
+			else if (dc > eps && dn <= eps && dn >= -eps) {
+				if (first_event == -1) first_event = 1;
+				if (totentry < 64) entries[totentry] = nxt->v;
+				totentry++;
+			}
+		}
+
+		if (totexit != totentry || totexit > 64) {
+			result = CLIP_FAIL;
+			goto finally;
+		}
+
+		/* each exit is followed by an entry along the poly, the clipped poly runs exit -> entry
+		 * on the plane, so the cap needs the reverse edge. If the first event was an entry, the
+		 * matching exit is the last one (cyclic) */
+		for (j = 0; j < totexit; j++) {
+			int exit_v = exits[j];
+			int entry_v = (first_event == 0) ? entries[j] : entries[(j + 1) % totentry];
+
+			if (exit_v == entry_v)
+				continue;
+
+			if (totcut == alloc_cut) {
+				alloc_cut *= 2;
+				cut_edges = MEM_reallocN(cut_edges, sizeof(int) * 2 * alloc_cut);
+			}
+			cut_edges[totcut][0] = entry_v;
+			cut_edges[totcut][1] = exit_v;
+			totcut++;
+		}
+
+		/* drop degenerate remainders, also those lying flat on the plane (covered by the cap) */
+		if (out->totloop - loopstart < 3 || out_on_plane) {
+			out->totloop = loopstart;
+			continue;
+		}
+
+		clip_add_poly(out, loopstart, cp->orig, cp->mat_nr, cp->flag);
+	}
+
+	ortho_basis_v3v3_v3(uv_basis[0], uv_basis[1], no);
+	result = clip_add_caps(out, cut_edges, totcut, no, cap_mat_nr, cap_flag, uv_basis, uv_origin, uv_scale);
+
+finally:
+	if (result != CLIP_OK) {
+		clip_mesh_free(out);
+	}
+
+	BLI_edgehash_free(eh, NULL);
+	MEM_freeN(cut_edges);
+	MEM_freeN(dist);
+	return result;
+}
+
+static DerivedMesh *clip_mesh_to_dm(ClipMesh *cm, DerivedMesh *dm_parent)
+{
+	DerivedMesh *dm;
+	MVert *mvert, *parent_mvert = dm_parent->getVertArray(dm_parent);
+	MLoop *mloop;
+	MPoly *mpoly;
+	MLoopUV *mluv;
+	int *remap = MEM_mallocN(sizeof(int) * cm->totvert, "clip remap");
+	int i, totvert = 0;
+
+	/* compact, outside verts of all planes are still in the array */
+	fill_vn_i(remap, cm->totvert, -1);
+	for (i = 0; i < cm->totloop; i++) {
+		int v = cm->loops[i].v;
+		if (remap[v] == -1) {
+			remap[v] = totvert++;
+		}
+	}
+
+	dm = CDDM_new(totvert, 0, 0, cm->totloop, cm->totpoly);
+	CustomData_merge(&dm_parent->vertData, &dm->vertData, CD_MASK_MDEFORMVERT, CD_CALLOC, totvert);
+	CustomData_merge(&dm_parent->polyData, &dm->polyData, CD_MASK_MTEXPOLY, CD_CALLOC, cm->totpoly);
+	if (!CustomData_has_layer(&dm->loopData, CD_MLOOPUV)) {
+		CustomData_add_layer(&dm->loopData, CD_MLOOPUV, CD_CALLOC, NULL, cm->totloop);
+	}
+
+	mvert = CDDM_get_verts(dm);
+	mloop = CDDM_get_loops(dm);
+	mpoly = CDDM_get_polys(dm);
+	mluv = CustomData_get_layer(&dm->loopData, CD_MLOOPUV);
+
+	for (i = 0; i < cm->totvert; i++) {
+		if (remap[i] != -1) {
+			ClipVert *cv = &cm->verts[i];
+			MVert *mv = &mvert[remap[i]];
+
+			*mv = parent_mvert[cv->orig];
+			copy_v3_v3(mv->co, cv->co);
+			CustomData_copy_data(&dm_parent->vertData, &dm->vertData, cv->orig, remap[i], 1);
+		}
+	}
+
+	for (i = 0; i < cm->totloop; i++) {
+		mloop[i].v = remap[cm->loops[i].v];
+		copy_v2_v2(mluv[i].uv, cm->loops[i].uv);
+	}
+
+	for (i = 0; i < cm->totpoly; i++) {
+		ClipPoly *cp = &cm->polys[i];
+
+		mpoly[i].loopstart = cp->loopstart;
+		mpoly[i].totloop = cp->totloop;
+		mpoly[i].mat_nr = cp->mat_nr;
+		mpoly[i].flag = cp->flag;
+
+		if (cp->orig != -1) {
+			CustomData_copy_data(&dm_parent->polyData, &dm->polyData, cp->orig, i, 1);
+		}
+	}
+
+	MEM_freeN(remap);
+
+	CDDM_calc_edges(dm);
+	dm->dirty |= DM_DIRTY_NORMALS;
+	CDDM_calc_normals_mapping(dm);
+
+	return dm;
+}
+
+/* intersect dm_parent with the convex cell "child", returns NULL if the result isn't usable (use carve then) */
+static DerivedMesh *clip_parent_by_cell(DerivedMesh *dm_parent, Shard *child, short inner_material_index)
+{
+	ClipMesh cm, cm_next;
+	MVert *cell_verts = child->mvert;
+	float cell_center[3] = {0.0f, 0.0f, 0.0f}, cell_min[3], cell_max[3], pmin[3], pmax[3], size[3];
+	float eps, uv_scale;
+	short cap_mat_nr;
+	int i, j;
+
+	if (dm_parent->getNumPolys(dm_parent) == 0 || child->totpoly < 4) {
+		return NULL;
+	}
+
+	INIT_MINMAX(cell_min, cell_max);
+	for (i = 0; i < child->totvert; i++) {
+		add_v3_v3(cell_center, cell_verts[i].co);
+		minmax_v3v3_v3(cell_min, cell_max, cell_verts[i].co);
+	}
+	mul_v3_fl(cell_center, 1.0f / (float)child->totvert);
+
+	INIT_MINMAX(pmin, pmax);
+	DM_mesh_minmax(dm_parent, pmin, pmax);
+	sub_v3_v3v3(size, pmax, pmin);
+	eps = max_fff(size[0], size[1], size[2]) * 1e-5f;
+
+	sub_v3_v3v3(size, cell_max, cell_min);
+	uv_scale = 1.0f / max_ff(max_fff(size[0], size[1], size[2]), FLT_EPSILON);
+
+	cap_mat_nr = (inner_material_index > 0) ? inner_material_index : 0;
+
+	clip_mesh_from_dm(&cm, dm_parent);
+
+	for (i = 0; i < child->totpoly; i++) {
+		MPoly *mp = &child->mpoly[i];
+		float (*co)[3] = MEM_mallocN(sizeof(float) * 3 * mp->totloop, "cell plane coords");
+		float no[3], d;
+		ClipResult result;
+
+		for (j = 0; j < mp->totloop; j++) {
+			copy_v3_v3(co[j], cell_verts[child->mloop[mp->loopstart + j].v].co);
+		}
+
+		if (normal_poly_v3(no, (const float (*)[3])co, mp->totloop) == 0.0f) {
+			MEM_freeN(co);
+			continue;
+		}
+
+		d = dot_v3v3(no, co[0]);
+		MEM_freeN(co);
+
+		/* make sure the plane normal points out of the cell */
+		if (dot_v3v3(no, cell_center) - d > 0.0f) {
+			negate_v3(no);
+			d = -d;
+		}
+
+		result = clip_mesh_plane(&cm, &cm_next, no, d, eps, cap_mat_nr, (mp->flag & ME_SMOOTH) | ME_FACE_SEL,
+		                         cell_min, uv_scale);
+
+		if (result == CLIP_OK) {
+			clip_mesh_free(&cm);
+			cm = cm_next;
+		}
+		else if (result != CLIP_SKIP) {
+			/* empty results are left to carve as well, it knows best what to return then */
+			clip_mesh_free(&cm);
+			return NULL;
+		}
+	}
+
+	if (cm.totpoly < 4) {
+		clip_mesh_free(&cm);
+		return NULL;
+	}
+
+	{
+		DerivedMesh *dm = clip_mesh_to_dm(&cm, dm_parent);
+		clip_mesh_free(&cm);
+
+		if (check_non_manifold(dm)) {
+			dm->needsFree = 1;
+			dm->release(dm);
+			return NULL;
+		}
+
+		return dm;
+	}
+}
+
+/* crop dm_parent to a box slightly larger than the cell bounds, so carve only has to deal with the
+ * parent geometry near the cell. The box caps stay outside of the cell and never end up in the boolean
+ * result, returns NULL if the box doesn't cut the parent or the crop isn't watertight */
+static DerivedMesh *clip_parent_by_cell_bounds(DerivedMesh *dm_parent, Shard *child)
+{
+	ClipMesh cm, cm_next;
+	float cell_min[3], cell_max[3], pmin[3], pmax[3], size[3];
+	float eps, margin, uv_scale;
+	bool cut = false;
+	int i, axis;
+
+	if (dm_parent->getNumPolys(dm_parent) == 0 || child->totvert == 0) {
+		return NULL;
+	}
+
+	INIT_MINMAX(cell_min, cell_max);
+	for (i = 0; i < child->totvert; i++) {
+		minmax_v3v3_v3(cell_min, cell_max, child->mvert[i].co);
+	}
+
+	INIT_MINMAX(pmin, pmax);
+	DM_mesh_minmax(dm_parent, pmin, pmax);
+	sub_v3_v3v3(size, pmax, pmin);
+	eps = max_fff(size[0], size[1], size[2]) * 1e-5f;
+
+	sub_v3_v3v3(size, cell_max, cell_min);
+	margin = max_fff(size[0], size[1], size[2]) * 0.01f + eps * 10.0f;
+	uv_scale = 1.0f / max_ff(max_fff(size[0], size[1], size[2]), FLT_EPSILON);
+
+	for (axis = 0; axis < 3; axis++) {
+		cell_min[axis] -= margin;
+		cell_max[axis] += margin;
+	}
+
+	clip_mesh_from_dm(&cm, dm_parent);
+
+	for (i = 0; i < 6; i++) {
+		float no[3] = {0.0f, 0.0f, 0.0f}, d;
+		ClipResult result;
+
+		axis = i / 2;
+		if (i % 2 == 0) {
+			no[axis] = 1.0f;
+			d = cell_max[axis];
+		}
+		else {
+			no[axis] = -1.0f;
+			d = -cell_min[axis];
+		}
+
+		result = clip_mesh_plane(&cm, &cm_next, no, d, eps, 0, 0, cell_min, uv_scale);
+
+		if (result == CLIP_OK) {
+			clip_mesh_free(&cm);
+			cm = cm_next;
+			cut = true;
+		}
+		else if (result != CLIP_SKIP) {
+			clip_mesh_free(&cm);
+			return NULL;
+		}
+	}
+
+	if (!cut || cm.totpoly < 4) {
+		clip_mesh_free(&cm);
+		return NULL;
+	}
+
+	{
+		DerivedMesh *dm = clip_mesh_to_dm(&cm, dm_parent);
+		clip_mesh_free(&cm);
+
+		if (check_non_manifold(dm)) {
+			dm->needsFree = 1;
+			dm->release(dm);
+			return NULL;
+		}
+
+		dm->cd_flag = dm_parent->cd_flag;
+		return dm;
+	}
+}
+
+/* Cell culling against the parent surface
+ *
+ * Only cells whose bounds overlap the parent surface need a real boolean, all others lie either
+ * completely inside the parent (the result is the cell itself) or completely outside (no result).
+ * The face bvh is cached on dm_parent, so it is built once per fracture run only */
+
+typedef struct CellRayCount {
+	MVert *mvert;
+	MFace *mface;
+	int hits;
+} CellRayCount;
+
+static void cell_ray_count_cb(void *userdata, int index, const BVHTreeRay *ray, BVHTreeRayHit *UNUSED(hit))
+{
+	CellRayCount *data = userdata;
+	MFace *mf = &data->mface[index];
+	float lambda;
+
+	if (isect_ray_tri_v3(ray->origin, ray->direction, data->mvert[mf->v1].co, data->mvert[mf->v2].co,
+	                     data->mvert[mf->v3].co, &lambda, NULL) && lambda > 0.0f)
+	{
+		data->hits++;
+	}
+
+	if (mf->v4 && isect_ray_tri_v3(ray->origin, ray->direction, data->mvert[mf->v1].co, data->mvert[mf->v3].co,
+	                               data->mvert[mf->v4].co, &lambda, NULL) && lambda > 0.0f)
+	{
+		data->hits++;
+	}
+}
+
+/* returns false if the cell touches the parent surface, else r_inside tells where it is */
+static bool cell_classify_by_surface(DerivedMesh *dm_parent, Shard *child, bool *r_inside)
+{
+	/* slightly skewed directions, so rays don't run along axis aligned edges */
+	const float dirs[3][3] = {{0.9f, 0.31f, 0.17f}, {-0.23f, 0.88f, 0.41f}, {0.13f, -0.37f, 0.92f}};
+	BVHTreeFromMesh treedata = {NULL};
+	BVHTree *cell_tree;
+	BVHTreeOverlap *overlap;
+	CellRayCount data;
+	unsigned int totoverlap = 0;
+	float min[3], max[3], center[3], corners[8][3];
+	int i, inside_votes = 0;
+
+	if (child->totvert == 0) {
+		return false;
+	}
+
+	INIT_MINMAX(min, max);
+	for (i = 0; i < child->totvert; i++) {
+		minmax_v3v3_v3(min, max, child->mvert[i].co);
+	}
+
+	for (i = 0; i < 8; i++) {
+		corners[i][0] = (i & 1) ? max[0] : min[0];
+		corners[i][1] = (i & 2) ? max[1] : min[1];
+		corners[i][2] = (i & 4) ? max[2] : min[2];
+	}
+
+	DM_ensure_tessface(dm_parent);
+	bvhtree_from_mesh_faces(&treedata, dm_parent, 0.0f, 4, 6);
+	if (treedata.tree == NULL) {
+		free_bvhtree_from_mesh(&treedata);
+		return false;
+	}
+
+	cell_tree = BLI_bvhtree_new(1, FLT_EPSILON, 4, 6);
+	BLI_bvhtree_insert(cell_tree, 0, corners[0], 8);
+	BLI_bvhtree_balance(cell_tree);
+
+	overlap = BLI_bvhtree_overlap(treedata.tree, cell_tree, &totoverlap);
+	BLI_bvhtree_free(cell_tree);
+
+	if (overlap) {
+		MEM_freeN(overlap);
+	}
+
+	if (totoverlap > 0) {
+		free_bvhtree_from_mesh(&treedata);
+		return false;
+	}
+
+	/* cell is away from the surface, a parity vote decides whether it is in- or outside */
+	mid_v3_v3v3(center, min, max);
+	data.mvert = treedata.vert;
+	data.mface = treedata.face;
+
+	for (i = 0; i < 3; i++) {
+		float dir[3];
+
+		normalize_v3_v3(dir, dirs[i]);
+		data.hits = 0;
+		BLI_bvhtree_ray_cast_all(treedata.tree, center, dir, 0.0f, cell_ray_count_cb, &data);
+		if (data.hits % 2 == 1) {
+			inside_votes++;
+		}
+	}
+
+	free_bvhtree_from_mesh(&treedata);
+
+	*r_inside = inside_votes >= 2;
+	return true;
+}
+
 Shard *BKE_fracture_shard_boolean(Object *obj, DerivedMesh *dm_parent, Shard *child, short inner_material_index,
                                   int num_cuts, float fractal, Shard** other, float mat[4][4], float radius, bool use_smooth_inner, int num_levels)
 {
-	DerivedMesh *left_dm = NULL, *right_dm, *output_dm, *other_dm;
+	DerivedMesh *left_dm = NULL, *right_dm, *output_dm, *other_dm, *crop_dm = NULL;
 	BMesh* bm = NULL;
+	bool cell_inside = false;
 
 	if (other != NULL && mat != NULL)
 	{
@@ -537,15 +1359,44 @@ Shard *BKE_fracture_shard_boolean(Object *obj, DerivedMesh *dm_parent, Shard *ch
 	}
 	else
 	{
-		left_dm = BKE_shard_create_dm(child, false);
-		unwrap_shard_dm(left_dm);
+		/* plain voronoi cells are convex, try to clip the parent directly before going through carve */
+		output_dm = (other == NULL) ? clip_parent_by_cell(dm_parent, child, inner_material_index) : NULL;
+		if (output_dm) {
+			return do_output_shard_dm(&output_dm, child, num_cuts, fractal, other);
+		}
+
+		if (other == NULL && cell_classify_by_surface(dm_parent, child, &cell_inside)) {
+			if (!cell_inside) {
+				return NULL;
+			}
+
+			/* the cell is completely inside, no need to go through carve */
+			output_dm = cell_create_dm(child);
+			do_set_inner_material(other, mat, output_dm, inner_material_index);
+			return do_output_shard_dm(&output_dm, child, num_cuts, fractal, other);
+		}
+
+		left_dm = cell_create_dm(child);
+
+		/* the cell touches the surface, only feed carve the part of the parent around it */
+		if (other == NULL) {
+			crop_dm = clip_parent_by_cell_bounds(dm_parent, child);
+		}
 	}
 
 	do_set_inner_material(other, mat, left_dm, inner_material_index);
 
-	right_dm = dm_parent;
+	right_dm = crop_dm ? crop_dm : dm_parent;
 	output_dm = NewBooleanDerivedMesh(right_dm, obj, left_dm, obj, 1); /*1 == intersection, 3 == difference*/
 
+	if (crop_dm)
+	{
+		crop_dm->needsFree = 1;
+		crop_dm->release(crop_dm);
+		crop_dm = NULL;
+		right_dm = dm_parent;
+	}
+
 	/*check for watertightness, but for fractal only*/
 	if (other != NULL && do_check_watertight(&output_dm, &bm, &left_dm, right_dm, other, mat))
 	{
@@ -747,13 +1598,11 @@ Shard *BKE_fracture_shard_bisect(BMesh *bm_orig, Shard *child, float obmat[4][4]
 {
 
 	Shard *output_s;
-	DerivedMesh *dm_child = BKE_shard_create_dm(child, false);
+	DerivedMesh *dm_child = cell_create_dm(child);
 
 	BMesh *bm_parent = BM_mesh_copy(bm_orig);
 	BMesh *bm_child;
 
-
-	unwrap_shard_dm(dm_child);
 	bm_child = DM_to_bmesh(dm_child, true);
 
 
@@ -2994,7 +2994,7 @@ int  BKE_ptcache_object_reset(Scene *scene, Object *ob, int mode)
 			/* only flag as outdated, resetting should happen on start frame */
 			//pid.cache->flag |= PTCACHE_OUTDATED;
 			/* to keep all caches in sync, reset them all */
-			BKE_rigidbody_cache_reset(scene->rigidbody_world);
+			BKE_rigidbody_cache_reset_transforms(scene->rigidbody_world);
 		}
 	}
 
@@ -39,15 +39,19 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "BLI_bitmap.h"
 #include "BLI_blenlib.h"
+#include "BLI_hash_md5.h"
 #include "BLI_math.h"
 #include "BLI_kdtree.h"
+#include "BLI_mempool.h"
 #include "BLI_utildefines.h"
 
 #ifdef WITH_BULLET
 #  include "RBI_api.h"
 #endif
 
+#include "DNA_anim_types.h"
 #include "DNA_fracture_types.h"
 #include "DNA_group_types.h"
 #include "DNA_mesh_types.h"
@@ -57,6 +61,7 @@
 #include "DNA_rigidbody_types.h"
 #include "DNA_scene_types.h"
 
+#include "BKE_animsys.h"
 #include "BKE_cdderivedmesh.h"
 #include "BKE_effect.h"
 #include "BKE_fracture.h"
@@ -125,9 +130,15 @@ float BKE_rigidbody_calc_max_con_mass(Object *ob)
 	RigidBodyCon* rbc = ob->rigidbody_constraint;
 	ConstraintContainer *cc = rbc->fracture_constraints;
 	RigidBodyShardCon *con;
+	BLI_mempool_iter iter;
 	float max_con_mass = 0, con_mass;
 
-	for (con = cc->constraint_map.first; con; con = con->next) {
+	if (cc->constraint_pool == NULL)
+		return max_con_mass;
+
+	/* walk the pool chunks linearly instead of chasing the list links */
+	BLI_mempool_iternew(cc->constraint_pool, &iter);
+	while ((con = BLI_mempool_iterstep(&iter))) {
 		if ((con->mi1 != NULL && con->mi1->rigidbody != NULL) &&
 			(con->mi2 != NULL && con->mi2->rigidbody != NULL)) {
 			con_mass = con->mi1->rigidbody->mass + con->mi2->rigidbody->mass;
@@ -145,9 +156,14 @@ float BKE_rigidbody_calc_min_con_dist(Object *ob)
 	RigidBodyCon *rbc = ob->rigidbody_constraint;
 	ConstraintContainer* cc = rbc->fracture_constraints;
 	RigidBodyShardCon *con;
+	BLI_mempool_iter iter;
 	float min_con_dist = FLT_MAX, con_dist, con_vec[3];
 
-	for (con = cc->constraint_map.first; con; con = con->next) {
+	if (cc->constraint_pool == NULL)
+		return min_con_dist;
+
+	BLI_mempool_iternew(cc->constraint_pool, &iter);
+	while ((con = BLI_mempool_iterstep(&iter))) {
 		if ((con->mi1 != NULL && con->mi1->rigidbody != NULL) &&
 			(con->mi2 != NULL && con->mi2->rigidbody != NULL)) {
 			sub_v3_v3v3(con_vec, con->mi1->centroid, con->mi2->centroid);
@@ -347,6 +363,7 @@ void BKE_rigidbody_calc_shard_mass(Scene *scene, Object *ob, MeshIsland *mi)
 	mass_ob = rb->mass;
 
 	if (vol_ob > 0) {
+		BKE_fracture_physics_mesh_ensure(mi);
 		dm_mi = mi->physics_mesh;
 		vol_mi = BKE_rigidbody_calc_volume(dm_mi, rb);
 		mass_mi = (vol_mi / vol_ob) * mass_ob;
@@ -504,6 +521,9 @@ void BKE_rigidbody_update_cell(struct MeshIsland *mi, Object *ob, float loc[3],
 		//printf("Vertex Co: %d -> (%.2f, %.2f, %.2f) \n", j, loc[0], loc[1], loc[2]);
 	}
 
+	copy_v3_v3(mi->applied_pos, loc);
+	copy_qt_qt(mi->applied_orn, rot);
+
 	ob->recalc |= OB_RECALC_ALL;
 }
 
@@ -545,6 +565,8 @@ void BKE_rigidbody_free_world(Scene* scene)
 	if (rbw->objects)
 		MEM_freeN(rbw->objects);
 
+	BKE_rigidbody_free_checkpoints(rbw);
+
 	/* free rigidbody world itself */
 	MEM_freeN(rbw);
 }
@@ -584,13 +606,58 @@ void BKE_rigidbody_free_constraint(Object *ob)
 /* ************************************** */
 /* Setup Utilities - Validate Sim Instances */
 
-static rbCollisionShape *rigidbody_get_shape_convexhull_from_dm(DerivedMesh *dm, float margin, bool *can_embed)
+/* reduce the hull input to at most max_verts support points, taken along evenly
+ * distributed directions (fibonacci sphere), the result is a conservative subset
+ * of the original hull vertices; returns the number of points written to r_co */
+static int rigidbody_hull_reduce_verts(MVert *mvert, int totvert, int max_verts, float (*r_co)[3])
+{
+	BLI_bitmap *used = BLI_BITMAP_NEW(totvert, "hull_used_verts");
+	const float golden_angle = (float)M_PI * (3.0f - sqrtf(5.0f));
+	int i, j, count = 0;
+
+	for (i = 0; i < max_verts; i++) {
+		float dir[3], z, r, best = -FLT_MAX;
+		int best_index = 0;
+
+		z = 1.0f - (2.0f * (float)i + 1.0f) / (float)max_verts;
+		r = sqrtf(max_ff(0.0f, 1.0f - z * z));
+		dir[0] = cosf(golden_angle * (float)i) * r;
+		dir[1] = sinf(golden_angle * (float)i) * r;
+		dir[2] = z;
+
+		for (j = 0; j < totvert; j++) {
+			float d = dot_v3v3(mvert[j].co, dir);
+			if (d > best) {
+				best = d;
+				best_index = j;
+			}
+		}
+
+		if (!BLI_BITMAP_TEST(used, best_index)) {
+			BLI_BITMAP_ENABLE(used, best_index);
+			copy_v3_v3(r_co[count], mvert[best_index].co);
+			count++;
+		}
+	}
+
+	MEM_freeN(used);
+	return count;
+}
+
+static rbCollisionShape *rigidbody_get_shape_convexhull_from_dm(DerivedMesh *dm, float margin, bool *can_embed, int max_verts)
 {
 	rbCollisionShape *shape = NULL;
 	int totvert = dm->getNumVerts(dm);
 	MVert *mvert = dm->getVertArray(dm);
 
-	if (dm && totvert) {
+	if (dm && totvert && max_verts > 0 && totvert > max_verts) {
+		float (*co)[3] = MEM_mallocN(sizeof(float) * 3 * max_verts, "hull_lod_verts");
+		int count = rigidbody_hull_reduce_verts(mvert, totvert, max_verts, co);
+
+		shape = RB_shape_new_convex_hull((float *)co, sizeof(float) * 3, count, margin, can_embed);
+		MEM_freeN(co);
+	}
+	else if (dm && totvert) {
 		shape = RB_shape_new_convex_hull((float *)mvert, sizeof(MVert), totvert, margin, can_embed);
 	}
 	else {
@@ -721,6 +788,7 @@ void BKE_rigidbody_validate_sim_shard_shape(MeshIsland *mi, Object *ob, short re
 	if (rbo->physics_shape && !rebuild)
 		return;
 
+	BKE_fracture_physics_mesh_ensure(mi);
 	if (mi->physics_mesh == NULL)
 		return;
 	
@@ -783,7 +851,8 @@ void BKE_rigidbody_validate_sim_shard_shape(MeshIsland *mi, Object *ob, short re
 
 			if (!(rb->flag & RBO_FLAG_USE_MARGIN) && has_volume)
 				hull_margin = 0.04f;
-			new_shape = rigidbody_get_shape_convexhull_from_dm(mi->physics_mesh, hull_margin, &can_embed);
+			new_shape = rigidbody_get_shape_convexhull_from_dm(mi->physics_mesh, hull_margin, &can_embed,
+			                                                   rb->fracture_objects ? rb->fracture_objects->hull_vertex_limit : 0);
 			if (!(rb->flag & RBO_FLAG_USE_MARGIN))
 				rb->margin = (can_embed && has_volume) ? 0.04f : 0.0f;      /* RB_TODO ideally we shouldn't directly change the margin here */
 			break;
@@ -1540,6 +1609,7 @@ RigidBodyWorld *BKE_rigidbody_world_copy(RigidBodyWorld *rbw)
 	rbwn->objects = NULL;
 	rbwn->physics_world = NULL;
 	rbwn->numbodies = 0;
+	BLI_listbase_clear(&rbwn->checkpoints);
 
 	return rbwn;
 }
@@ -1660,13 +1730,18 @@ RigidBodyCon *BKE_rigidbody_create_constraint(Object *ob, short type)
 	return rbc;
 }
 
-/* Add rigid body constraint to the specified object */
-RigidBodyShardCon *BKE_rigidbody_create_shard_constraint(short type)
+/* Add shard constraint, allocated from the container's pool so the constraint_map items stay
+ * contiguous in memory (there may be hundreds of thousands of them), free them via the pool only */
+RigidBodyShardCon *BKE_rigidbody_create_shard_constraint(ConstraintContainer *cc, short type)
 {
 	RigidBodyShardCon *rbc;
 
+	if (cc->constraint_pool == NULL) {
+		cc->constraint_pool = BLI_mempool_create(sizeof(RigidBodyShardCon), 512, 4096, BLI_MEMPOOL_ALLOW_ITER);
+	}
+
 	/* create new settings data, and link it up */
-	rbc = MEM_callocN(sizeof(RigidBodyShardCon), "RigidBodyCon");
+	rbc = BLI_mempool_calloc(cc->constraint_pool);
 
 	/* set default settings */
 	rbc->type = type;
@@ -2101,7 +2176,7 @@ static void do_update_constraint_container(Scene* scene, Object *ob, bool rebuil
 			printf("Purging constraint...\n");
 			BLI_remlink(&cc->constraint_map, rbsc);
 			BKE_rigidbody_remove_shard_con(rbw, rbsc);
-			MEM_freeN(rbsc);
+			BLI_mempool_free(cc->constraint_pool, rbsc);
 			rbsc = NULL;
 		}
 		else
@@ -2211,6 +2286,12 @@ static void do_update_container(Scene* scene, Object* ob, RigidBodyWorld *rbw, b
 			}
 #endif
 
+	/* build pending physics meshes (islands read from file) in parallel before validating shapes */
+	BKE_fracture_physics_meshes_ensure(fs);
+
+	/* FM_TODO: a new dynamic state validates all of its islands, even the ones whose shard didn't
+	 * change. Handing their bodies over (by island id) needs working dynamic state creation first,
+	 * new states get no frac_mesh yet and are fractured from within the bullet tick callback */
 	for (mi = fs->island_map.first; mi; mi = mi->next) {
 		/* as usual, but for each shard now, and no constraints*/
 		/* perform simulation data updates as tagged */
@@ -2297,6 +2378,7 @@ static void do_sync_container(Object *ob, RigidBodyWorld *rbw, float ctime)
 	float size[3] = {1, 1, 1};
 	float centr[3];
 	int i = 0;
+	bool ob_changed;
 
 	if (!fc || (fc && fc->flag & (FM_FLAG_REFRESH_SHAPE | FM_FLAG_SKIP_MASS_CALC)))
 	{
@@ -2305,6 +2387,10 @@ static void do_sync_container(Object *ob, RigidBodyWorld *rbw, float ctime)
 
 	fs = fc->current;
 
+	/* vertices are written in object space, all of them need an update if the object moved */
+	ob_changed = !compare_m4m4(fc->sync_obmat, ob->obmat, 0.0f);
+	copy_m4_m4(fc->sync_obmat, ob->obmat);
+
 	for (mi = fs->island_map.first; mi; mi = mi->next)
 	{
 		RigidBodyShardOb *rbo = mi->rigidbody;
@@ -2313,7 +2399,7 @@ static void do_sync_container(Object *ob, RigidBodyWorld *rbw, float ctime)
 		{
 			if (ob->flag & SELECT && G.moving & G_TRANSFORM_OBJ && rbw) {
 				rbw->flag |= RBW_FLAG_OBJECT_CHANGED;
-				BKE_rigidbody_cache_reset(rbw);
+				BKE_rigidbody_cache_reset_transforms(rbw);
 
 				/* re-enable all constraints as well, hmmm (participating ones ?) */
 				for (i = 0; i < mi->participating_constraint_count; i++)
@@ -2346,7 +2432,11 @@ static void do_sync_container(Object *ob, RigidBodyWorld *rbw, float ctime)
 			//if ((!(rb->flag & RBO_FLAG_KINEMATIC) && rb->type == RBO_TYPE_ACTIVE))
 			rbw->flag |= RBW_FLAG_OBJECT_CHANGED;
 		}
-		BKE_rigidbody_update_cell(mi, ob, rbo->pos, rbo->orn);
+
+		/* sleeping, passive or otherwise untouched islands keep their vertices from the last update */
+		if (ob_changed || !equals_v3v3(mi->applied_pos, rbo->pos) || !equals_v4v4(mi->applied_orn, rbo->orn)) {
+			BKE_rigidbody_update_cell(mi, ob, rbo->pos, rbo->orn);
+		}
 	}
 }
 
@@ -2455,7 +2545,9 @@ static void restoreKinematic(Object *ob)
 	}
 }
 
-void BKE_rigidbody_cache_reset(RigidBodyWorld *rbw)
+/* Object transforms or their animation changed, checkpoints are kept and checked against the
+ * transforms of their frames when the simulation resumes */
+void BKE_rigidbody_cache_reset_transforms(RigidBodyWorld *rbw)
 {
 	if (rbw) {
 		GroupObject* go;
@@ -2472,6 +2564,15 @@ void BKE_rigidbody_cache_reset(RigidBodyWorld *rbw)
 	}
 }
 
+/* Simulation settings changed, which affects all frames, so no stored solver state is valid anymore */
+void BKE_rigidbody_cache_reset(RigidBodyWorld *rbw)
+{
+	if (rbw) {
+		BKE_rigidbody_cache_reset_transforms(rbw);
+		BKE_rigidbody_free_checkpoints(rbw);
+	}
+}
+
 /* ------------------ */
 
 /* Rebuild rigid body world */
@@ -2541,6 +2642,456 @@ void BKE_rigidbody_rebuild_world(Scene *scene, float ctime)
 	}
 }
 
+/* ------------------ */
+/* Solver State Checkpoints */
+
+/* The point cache only stores transforms, so an outdated simulation normally has to be re-run
+ * from its start frame. Checkpoints keep the full per-body solver state (transform, velocities,
+ * sleeping / kinematic state) and the constraint break state every checkpoint_interval frames,
+ * so the simulation can resume from the last checkpoint before the current frame instead.
+ *
+ * Each checkpoint also keeps a digest of the object transforms the simulation used up to it. When an
+ * edit outdates the caches, the transforms of past frames are evaluated again, and only checkpoints
+ * from the first frame whose input changed are dropped. */
+
+typedef struct RigidBodyBodyState {
+	float pos[3];
+	float orn[4];
+	float lin_vel[3];
+	float ang_vel[3];
+	int activation_state;
+	int flag;
+	int island_id; /* used to detect changed fracture states, which invalidate the checkpoint */
+} RigidBodyBodyState;
+
+typedef struct RigidBodyCheckpoint {
+	struct RigidBodyCheckpoint *next, *prev;
+	int frame;
+	int totbody;
+	int totcon;
+	RigidBodyBodyState *bodies;
+	int *con_flags;
+	unsigned char inputs[16];  /* digest of the inputs since the previous checkpoint, chained to its digest */
+} RigidBodyCheckpoint;
+
+static void rigidbody_free_checkpoint(RigidBodyWorld *rbw, RigidBodyCheckpoint *cp)
+{
+	BLI_remlink(&rbw->checkpoints, cp);
+	if (cp->bodies)
+		MEM_freeN(cp->bodies);
+	if (cp->con_flags)
+		MEM_freeN(cp->con_flags);
+	MEM_freeN(cp);
+}
+
+/* drop all checkpoints at or after frame, these are invalid once the simulation diverges there */
+static void rigidbody_free_checkpoints_from(RigidBodyWorld *rbw, int frame)
+{
+	RigidBodyCheckpoint *cp = rbw->checkpoints.first, *next;
+
+	while (cp) {
+		next = cp->next;
+		if (cp->frame >= frame) {
+			rigidbody_free_checkpoint(rbw, cp);
+		}
+		cp = next;
+	}
+}
+
+void BKE_rigidbody_free_checkpoints(RigidBodyWorld *rbw)
+{
+	while (rbw->checkpoints.first) {
+		rigidbody_free_checkpoint(rbw, rbw->checkpoints.first);
+	}
+}
+
+/* counts bodies and constraints, returns false if any of them has no physics instance yet */
+static bool rigidbody_checkpoint_count(RigidBodyWorld *rbw, int *r_totbody, int *r_totcon)
+{
+	GroupObject *go;
+	MeshIsland *mi;
+	RigidBodyShardCon *con;
+
+	*r_totbody = *r_totcon = 0;
+
+	for (go = rbw->group->gobject.first; go; go = go->next) {
+		RigidBodyOb *rb = go->ob->rigidbody_object;
+		if (!rb || !rb->fracture_objects)
+			continue;
+
+		for (mi = rb->fracture_objects->current->island_map.first; mi; mi = mi->next) {
+			if (!mi->rigidbody || !mi->rigidbody->physics_object)
+				return false;
+			(*r_totbody)++;
+		}
+	}
+
+	if (rbw->constraints) {
+		for (go = rbw->constraints->gobject.first; go; go = go->next) {
+			RigidBodyCon *rbc = go->ob->rigidbody_constraint;
+			if (!rbc || !rbc->fracture_constraints)
+				continue;
+
+			for (con = rbc->fracture_constraints->constraint_map.first; con; con = con->next) {
+				(*r_totcon)++;
+			}
+		}
+	}
+
+	return true;
+}
+
+static bool rigidbody_object_is_animated(Object *ob)
+{
+	AnimData *adt = ob->adt;
+
+	return adt && (adt->action || adt->nla_tracks.first);
+}
+
+/* the input of past frames can only be evaluated again for objects animated on their own,
+ * parents, object constraints and drivers depend on other objects at the current frame */
+static bool rigidbody_object_is_reproducible(Object *ob)
+{
+	return (ob->parent == NULL) && (ob->constraints.first == NULL) && !(ob->adt && ob->adt->drivers.first);
+}
+
+static bool rigidbody_checkpoints_usable(RigidBodyWorld *rbw)
+{
+	GroupObject *go;
+
+	for (go = rbw->group->gobject.first; go; go = go->next) {
+		if (!rigidbody_object_is_reproducible(go->ob))
+			return false;
+	}
+
+	if (rbw->constraints) {
+		for (go = rbw->constraints->gobject.first; go; go = go->next) {
+			if (!rigidbody_object_is_reproducible(go->ob))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+static int rigidbody_checkpoints_startframe(RigidBodyWorld *rbw)
+{
+	GroupObject *go;
+	int startframe = INT_MAX;
+
+	for (go = rbw->group->gobject.first; go; go = go->next) {
+		RigidBodyOb *rb = go->ob->rigidbody_object;
+
+		if (rb && rb->fracture_objects)
+			startframe = min_ii(startframe, rb->fracture_objects->pointcache->startframe);
+	}
+
+	return startframe;
+}
+
+static void rigidbody_object_eval_time(Scene *scene, Object *ob, float ctime)
+{
+	if (rigidbody_object_is_animated(ob)) {
+		BKE_animsys_evaluate_animdata(scene, &ob->id, ob->adt, ctime, ADT_RECALC_ANIM);
+		BKE_object_to_mat4(ob, ob->obmat);
+	}
+}
+
+/* leaves animated objects as the scene update does before stepping to ctime: the animation is
+ * evaluated first, but object matrices only after the step, so it sees those of the frame before */
+static void rigidbody_eval_inputs(Scene *scene, RigidBodyWorld *rbw, float ctime)
+{
+	GroupObject *go;
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		Group *group = (i == 0) ? rbw->group : rbw->constraints;
+
+		if (group == NULL)
+			continue;
+
+		for (go = group->gobject.first; go; go = go->next) {
+			if (rigidbody_object_is_animated(go->ob)) {
+				rigidbody_object_eval_time(scene, go->ob, ctime - 1.0f);
+				BKE_animsys_evaluate_animdata(scene, &go->ob->id, go->ob->adt, ctime, ADT_RECALC_ANIM);
+			}
+		}
+	}
+}
+
+/* digest of the object transforms and animatable body states at frames sfra to efra, chained to prev */
+static void rigidbody_inputs_digest(Scene *scene, RigidBodyWorld *rbw, int sfra, int efra,
+                                    const unsigned char prev[16], unsigned char r_digest[16])
+{
+	BLI_HashMD5 md5;
+	GroupObject *go;
+	int frame, i;
+
+	BLI_hash_md5_init(&md5);
+	if (prev)
+		BLI_hash_md5_add(&md5, prev, 16);
+
+	for (frame = sfra; frame <= efra; frame++) {
+		for (i = 0; i < 2; i++) {
+			Group *group = (i == 0) ? rbw->group : rbw->constraints;
+
+			if (group == NULL)
+				continue;
+
+			for (go = group->gobject.first; go; go = go->next) {
+				Object *ob = go->ob;
+
+				rigidbody_object_eval_time(scene, ob, (float)frame);
+				BLI_hash_md5_add(&md5, ob->obmat, sizeof(ob->obmat));
+
+				if (ob->rigidbody_object) {
+					const int flag = ob->rigidbody_object->flag & (RBO_FLAG_KINEMATIC | RBO_FLAG_DISABLED);
+					BLI_hash_md5_add(&md5, &flag, sizeof(int));
+				}
+			}
+		}
+	}
+
+	BLI_hash_md5_finish(&md5, r_digest);
+}
+
+/* The digest of a checkpoint at frame covers the transforms the steps since the previous
+ * checkpoint saw, so it starts one frame before (and for the first one, before the cache start) */
+static void rigidbody_checkpoint_inputs(Scene *scene, RigidBodyWorld *rbw, RigidBodyCheckpoint *prev, int frame,
+                                        unsigned char r_digest[16])
+{
+	const int sfra = prev ? prev->frame : rigidbody_checkpoints_startframe(rbw) - 1;
+
+	rigidbody_inputs_digest(scene, rbw, sfra, frame - 1, prev ? prev->inputs : NULL, r_digest);
+}
+
+static void rigidbody_checkpoint_store(Scene *scene, RigidBodyWorld *rbw, int frame)
+{
+	RigidBodyCheckpoint *cp;
+	GroupObject *go;
+	MeshIsland *mi;
+	RigidBodyShardCon *con;
+	int totbody, totcon, i = 0;
+
+	if (!rigidbody_checkpoint_count(rbw, &totbody, &totcon) || totbody == 0)
+		return;
+
+	rigidbody_free_checkpoints_from(rbw, frame);
+
+	cp = MEM_callocN(sizeof(RigidBodyCheckpoint), "rigidbody checkpoint");
+	cp->frame = frame;
+	cp->totbody = totbody;
+	cp->totcon = totcon;
+
+	rigidbody_checkpoint_inputs(scene, rbw, rbw->checkpoints.last, frame, cp->inputs);
+	rigidbody_eval_inputs(scene, rbw, (float)frame);
+	cp->bodies = MEM_mallocN(sizeof(RigidBodyBodyState) * totbody, "rigidbody checkpoint bodies");
+	if (totcon > 0)
+		cp->con_flags = MEM_mallocN(sizeof(int) * totcon, "rigidbody checkpoint constraints");
+
+	for (go = rbw->group->gobject.first; go; go = go->next) {
+		RigidBodyOb *rb = go->ob->rigidbody_object;
+		if (!rb || !rb->fracture_objects)
+			continue;
+
+		for (mi = rb->fracture_objects->current->island_map.first; mi; mi = mi->next, i++) {
+			RigidBodyShardOb *rbo = mi->rigidbody;
+			RigidBodyBodyState *state = &cp->bodies[i];
+
+			RB_body_get_position(rbo->physics_object, state->pos);
+			RB_body_get_orientation(rbo->physics_object, state->orn);
+			RB_body_get_linear_velocity(rbo->physics_object, state->lin_vel);
+			RB_body_get_angular_velocity(rbo->physics_object, state->ang_vel);
+			state->activation_state = RB_body_get_activation_state(rbo->physics_object);
+			state->flag = rbo->flag;
+			state->island_id = mi->id;
+		}
+	}
+
+	i = 0;
+	if (rbw->constraints) {
+		for (go = rbw->constraints->gobject.first; go; go = go->next) {
+			RigidBodyCon *rbc = go->ob->rigidbody_constraint;
+			if (!rbc || !rbc->fracture_constraints)
+				continue;
+
+			for (con = rbc->fracture_constraints->constraint_map.first; con; con = con->next, i++) {
+				cp->con_flags[i] = con->flag;
+			}
+		}
+	}
+
+	BLI_addtail(&rbw->checkpoints, cp);
+}
+
+/* restore the last checkpoint before frame into the physics world, returns its frame or -1 if none fits */
+static int rigidbody_checkpoint_restore(RigidBodyWorld *rbw, int frame)
+{
+	RigidBodyCheckpoint *cp;
+	GroupObject *go;
+	MeshIsland *mi;
+	RigidBodyShardCon *con;
+	int totbody, totcon, i = 0;
+
+	for (cp = rbw->checkpoints.last; cp; cp = cp->prev) {
+		if (cp->frame < frame)
+			break;
+	}
+
+	if (cp == NULL)
+		return -1;
+
+	if (!rigidbody_checkpoint_count(rbw, &totbody, &totcon) || totbody != cp->totbody || totcon != cp->totcon) {
+		/* simulation setup changed (refracture, new objects...), checkpoints are useless now */
+		BKE_rigidbody_free_checkpoints(rbw);
+		return -1;
+	}
+
+	for (go = rbw->group->gobject.first; go; go = go->next) {
+		RigidBodyOb *rb = go->ob->rigidbody_object;
+		if (!rb || !rb->fracture_objects)
+			continue;
+
+		for (mi = rb->fracture_objects->current->island_map.first; mi; mi = mi->next, i++) {
+			if (mi->id != cp->bodies[i].island_id) {
+				BKE_rigidbody_free_checkpoints(rbw);
+				return -1;
+			}
+		}
+	}
+
+	i = 0;
+	for (go = rbw->group->gobject.first; go; go = go->next) {
+		RigidBodyOb *rb = go->ob->rigidbody_object;
+		if (!rb || !rb->fracture_objects)
+			continue;
+
+		for (mi = rb->fracture_objects->current->island_map.first; mi; mi = mi->next, i++) {
+			RigidBodyShardOb *rbo = mi->rigidbody;
+			RigidBodyBodyState *state = &cp->bodies[i];
+
+			copy_v3_v3(rbo->pos, state->pos);
+			copy_qt_qt(rbo->orn, state->orn);
+			copy_v3_v3(rbo->lin_vel, state->lin_vel);
+			copy_v3_v3(rbo->ang_vel, state->ang_vel);
+			rbo->flag = state->flag;
+
+			RB_body_set_kinematic_state(rbo->physics_object, rbo->flag & RBO_FLAG_KINEMATIC || rb->flag & RBO_FLAG_DISABLED);
+			RB_body_set_mass(rbo->physics_object, RBO_GET_MASS(rbo));
+			RB_body_set_loc_rot(rbo->physics_object, rbo->pos, rbo->orn);
+			RB_body_set_linear_velocity(rbo->physics_object, rbo->lin_vel);
+			RB_body_set_angular_velocity(rbo->physics_object, rbo->ang_vel);
+			RB_body_force_activation_state(rbo->physics_object, state->activation_state);
+		}
+	}
+
+	i = 0;
+	if (rbw->constraints) {
+		for (go = rbw->constraints->gobject.first; go; go = go->next) {
+			RigidBodyCon *rbc = go->ob->rigidbody_constraint;
+			if (!rbc || !rbc->fracture_constraints)
+				continue;
+
+			for (con = rbc->fracture_constraints->constraint_map.first; con; con = con->next, i++) {
+				con->flag = cp->con_flags[i];
+				if (con->physics_constraint) {
+					RB_constraint_set_enabled(con->physics_constraint, con->flag & RBC_FLAG_ENABLED);
+				}
+			}
+		}
+	}
+
+	/* everything after the restored checkpoint will be simulated again */
+	rigidbody_free_checkpoints_from(rbw, cp->frame + 1);
+
+	return cp->frame;
+}
+
+/* compares the inputs of the checkpoints before frame with the current animation,
+ * and drops them from the first one the simulation would diverge at */
+static void rigidbody_checkpoints_validate(Scene *scene, RigidBodyWorld *rbw, int frame)
+{
+	RigidBodyCheckpoint *cp, *prev = NULL;
+	unsigned char digest[16];
+
+	for (cp = rbw->checkpoints.first; cp && cp->frame < frame; prev = cp, cp = cp->next) {
+		rigidbody_checkpoint_inputs(scene, rbw, prev, cp->frame, digest);
+
+		if (memcmp(digest, cp->inputs, sizeof(digest)) != 0) {
+			rigidbody_free_checkpoints_from(rbw, cp->frame);
+			break;
+		}
+	}
+}
+
+/* if any cache got outdated after its start frame, try to continue from the last checkpoint before ctime,
+ * re-simulating only the frames in between, returns true if the simulation was resumed */
+static bool rigidbody_resume_from_checkpoint(Scene *scene, float ctime)
+{
+	RigidBodyWorld *rbw = scene->rigidbody_world;
+	GroupObject *go;
+	bool outdated = false;
+	int frame, f;
+
+	if (rbw->checkpoint_interval <= 0 || rbw->checkpoints.first == NULL || rbw->physics_world == NULL)
+		return false;
+
+	for (go = rbw->group->gobject.first; go; go = go->next) {
+		RigidBodyOb *rb = go->ob->rigidbody_object;
+		PointCache *cache = (rb && rb->fracture_objects) ? rb->fracture_objects->pointcache : NULL;
+
+		if (cache && (cache->flag & PTCACHE_OUTDATED) && !(cache->flag & PTCACHE_BAKED) && ctime > cache->startframe + 1) {
+			outdated = true;
+		}
+	}
+
+	/* past frames are evaluated below, which would undo a transform in progress */
+	if (!outdated || (G.moving & G_TRANSFORM_OBJ))
+		return false;
+
+	if (!rigidbody_checkpoints_usable(rbw)) {
+		BKE_rigidbody_free_checkpoints(rbw);
+		return false;
+	}
+
+	rigidbody_checkpoints_validate(scene, rbw, (int)ctime);
+	frame = rigidbody_checkpoint_restore(rbw, (int)ctime);
+	rigidbody_eval_inputs(scene, rbw, ctime);
+
+	if (frame < 0)
+		return false;
+
+	if (G.debug & G_DEBUG_SIMDATA)
+		printf("Resuming rigidbody simulation from checkpoint at frame %d\n", frame);
+
+	/* results after the checkpoint are stale, results up to it are still valid */
+	for (go = rbw->group->gobject.first; go; go = go->next) {
+		RigidBodyOb *rb = go->ob->rigidbody_object;
+		FractureContainer *fc = rb ? rb->fracture_objects : NULL;
+		PTCacheID pid;
+
+		if (!fc)
+			continue;
+
+		BKE_ptcache_id_from_rigidbody(&pid, go->ob, fc);
+		BKE_ptcache_id_clear(&pid, PTCACHE_CLEAR_AFTER, frame);
+		fc->pointcache->flag &= ~PTCACHE_OUTDATED;
+		BKE_ptcache_validate(fc->pointcache, frame);
+	}
+
+	rbw->ltime = frame;
+
+	/* step up to the requested frame, these are regular single frame steps now */
+	for (f = frame + 1; f < (int)ctime; f++) {
+		rigidbody_eval_inputs(scene, rbw, (float)f);
+		BKE_rigidbody_do_simulation(scene, (float)f);
+	}
+
+	rigidbody_eval_inputs(scene, rbw, ctime);
+
+	return true;
+}
+
 /* Run RigidBody simulation for the specified physics world */
 void BKE_rigidbody_do_simulation(Scene *scene, float ctime)
 {
@@ -2549,6 +3100,8 @@ void BKE_rigidbody_do_simulation(Scene *scene, float ctime)
 	GroupObject *go;
 	bool is_cached = false;
 
+	rigidbody_resume_from_checkpoint(scene, ctime);
+
 	//flag this once, so it doesnt get called every time in the loop
 	rbw->flag |= RBW_FLAG_NEEDS_REBUILD;
 
@@ -2715,6 +3268,12 @@ void BKE_rigidbody_do_simulation(Scene *scene, float ctime)
 		}
 	}
 
+	if (rbw->checkpoint_interval > 0 && !is_cached && (ctime > rbw->ltime) && ((int)ctime % rbw->checkpoint_interval == 0) &&
+	    rigidbody_checkpoints_usable(rbw))
+	{
+		rigidbody_checkpoint_store(scene, rbw, (int)ctime);
+	}
+
 	rbw->ltime = ctime;
 }
 /* ************************************** */
@@ -2802,8 +3361,10 @@ void BKE_rigidbody_sync_transforms(RigidBodyWorld *rbw, Object *ob, float ctime)
 void BKE_rigidbody_aftertrans_update(Object *ob, float loc[3], float rot[3], float quat[4], float rotAxis[3], float rotAngle) {}
 bool BKE_rigidbody_check_sim_running(RigidBodyWorld *rbw, float ctime) { return false; }
 void BKE_rigidbody_cache_reset(RigidBodyWorld *rbw) {}
+void BKE_rigidbody_cache_reset_transforms(RigidBodyWorld *rbw) {}
 void BKE_rigidbody_rebuild_world(Scene *scene, float ctime) {}
 void BKE_rigidbody_do_simulation(Scene *scene, float ctime) {}
+void BKE_rigidbody_free_checkpoints(RigidBodyWorld *rbw) {}
 
 #ifdef __GNUC__
 #  pragma GCC diagnostic pop
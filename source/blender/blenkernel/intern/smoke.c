@@ -161,7 +161,8 @@ void smoke_turbulence_free(struct WTURBULENCE *UNUSED(wt)) {}
 void smoke_initWaveletBlenderRNA(struct WTURBULENCE *UNUSED(wt), float *UNUSED(strength)) {}
 void smoke_initBlenderRNA(struct FLUID_3D *UNUSED(fluid), float *UNUSED(alpha), float *UNUSED(beta), float *UNUSED(dt_factor), float *UNUSED(vorticity),
                           int *UNUSED(border_colli), float *UNUSED(burning_rate), float *UNUSED(flame_smoke), float *UNUSED(flame_smoke_color),
-                          float *UNUSED(flame_vorticity), float *UNUSED(flame_ignition_temp), float *UNUSED(flame_max_temp)) {}
+                          float *UNUSED(flame_vorticity), float *UNUSED(flame_ignition_temp), float *UNUSED(flame_max_temp),
+                          int *UNUSED(pressure_solver)) {}
 struct DerivedMesh *smokeModifier_do(SmokeModifierData *UNUSED(smd), Scene *UNUSED(scene), Object *UNUSED(ob), DerivedMesh *UNUSED(dm), bool UNUSED(for_render)) { return NULL; }
 float smoke_get_velocity_at(struct Object *UNUSED(ob), float UNUSED(position[3]), float UNUSED(velocity[3])) { return 0.0f; }
 void flame_get_spectrum(unsigned char *UNUSED(spec), int UNUSED(width), float UNUSED(t1), float UNUSED(t2)) {}
@@ -184,7 +185,8 @@ void smoke_reallocate_fluid(SmokeDomainSettings *sds, float dx, int res[3], int
 	}
 	sds->fluid = smoke_init(res, dx, DT_DEFAULT, use_heat, use_fire, use_colors);
 	smoke_initBlenderRNA(sds->fluid, &(sds->alpha), &(sds->beta), &(sds->time_scale), &(sds->vorticity), &(sds->border_collisions),
-	                     &(sds->burning_rate), &(sds->flame_smoke), sds->flame_smoke_color, &(sds->flame_vorticity), &(sds->flame_ignition), &(sds->flame_max_temp));
+	                     &(sds->burning_rate), &(sds->flame_smoke), sds->flame_smoke_color, &(sds->flame_vorticity), &(sds->flame_ignition), &(sds->flame_max_temp),
+	                     &(sds->pressure_solver));
 
 	/* reallocate shadow buffer */
 	if (sds->shadow)
@@ -541,6 +543,7 @@ void smokeModifier_createType(struct SmokeModifierData *smd)
 			smd->domain->time_scale = 1.0;
 			smd->domain->vorticity = 2.0;
 			smd->domain->border_collisions = SM_BORDER_OPEN; // open domain
+			smd->domain->pressure_solver = SM_PRESSURE_PCG;
 			smd->domain->flags = MOD_SMOKE_DISSOLVE_LOG;
 			smd->domain->highres_sampling = SM_HRES_FULLSAMPLE;
 			smd->domain->strength = 2.0;
@@ -642,6 +645,7 @@ void smokeModifier_copy(struct SmokeModifierData *smd, struct SmokeModifierData
 		tsmd->domain->strength = smd->domain->strength;
 
 		tsmd->domain->border_collisions = smd->domain->border_collisions;
+		tsmd->domain->pressure_solver = smd->domain->pressure_solver;
 		tsmd->domain->vorticity = smd->domain->vorticity;
 		tsmd->domain->time_scale = smd->domain->time_scale;
 
@@ -1431,54 +1435,24 @@ static void emit_from_particles(Object *flow_ob, SmokeDomainSettings *sds, Smoke
 	}
 }
 
-static void sample_derivedmesh(
+/* evaluate the emission of a cell from its nearest surface point, nearest is NULL when
+ * there is no surface within the emission distance */
+static void sample_derivedmesh_nearest(
         SmokeFlowSettings *sfs, MVert *mvert, MTFace *tface, MFace *mface,
         float *influence_map, float *velocity_map, int index, const int base_res[3], float flow_center[3],
-        BVHTreeFromMesh *treeData, const float ray_start[3], const float *vert_vel,
+        const BVHTreeNearest *nearest, float volume_factor, const float *vert_vel,
         bool has_velocity, int defgrp_index, MDeformVert *dvert, float x, float y, float z)
 {
-	float ray_dir[3] = {1.0f, 0.0f, 0.0f};
-	BVHTreeRayHit hit = {0};
-	BVHTreeNearest nearest = {0};
-
-	float volume_factor = 0.0f;
 	float sample_str = 0.0f;
 
-	hit.index = -1;
-	hit.dist = 9999;
-	nearest.index = -1;
-	nearest.dist_sq = sfs->surface_distance * sfs->surface_distance; /* find_nearest uses squared distance */
-
-	/* Check volume collision */
-	if (sfs->volume_density) {
-		if (BLI_bvhtree_ray_cast(treeData->tree, ray_start, ray_dir, 0.0f, &hit, treeData->raycast_callback, treeData) != -1) {
-			float dot = ray_dir[0] * hit.no[0] + ray_dir[1] * hit.no[1] + ray_dir[2] * hit.no[2];
-			/*  If ray and hit face normal are facing same direction
-			 *	hit point is inside a closed mesh. */
-			if (dot >= 0) {
-				/* Also cast a ray in opposite direction to make sure
-				 * point is at least surrounded by two faces */
-				negate_v3(ray_dir);
-				hit.index = -1;
-				hit.dist = 9999;
-
-				BLI_bvhtree_ray_cast(treeData->tree, ray_start, ray_dir, 0.0f, &hit, treeData->raycast_callback, treeData);
-				if (hit.index != -1) {
-					volume_factor = sfs->volume_density;
-				}
-			}
-		}
-	}
-
-	/* find the nearest point on the mesh */
-	if (BLI_bvhtree_find_nearest(treeData->tree, ray_start, &nearest, treeData->nearest_callback, treeData) != -1) {
+	if (nearest) {
 		float weights[4];
-		int v1, v2, v3, f_index = nearest.index;
+		int v1, v2, v3, f_index = nearest->index;
 		float n1[3], n2[3], n3[3], hit_normal[3];
 
 		/* emit from surface based on distance */
 		if (sfs->surface_distance) {
-			sample_str = sqrtf(nearest.dist_sq) / sfs->surface_distance;
+			sample_str = sqrtf(nearest->dist_sq) / sfs->surface_distance;
 			CLAMP(sample_str, 0.0f, 1.0f);
 			sample_str = pow(1.0f - sample_str, 0.5f);
 		}
@@ -1487,9 +1461,9 @@ static void sample_derivedmesh(
 
 		/* calculate barycentric weights for nearest point */
 		v1 = mface[f_index].v1;
-		v2 = (nearest.flags & BVH_ONQUAD) ? mface[f_index].v3 : mface[f_index].v2;
-		v3 = (nearest.flags & BVH_ONQUAD) ? mface[f_index].v4 : mface[f_index].v3;
-		interp_weights_face_v3(weights, mvert[v1].co, mvert[v2].co, mvert[v3].co, NULL, nearest.co);
+		v2 = (nearest->flags & BVH_ONQUAD) ? mface[f_index].v3 : mface[f_index].v2;
+		v3 = (nearest->flags & BVH_ONQUAD) ? mface[f_index].v4 : mface[f_index].v3;
+		interp_weights_face_v3(weights, mvert[v1].co, mvert[v2].co, mvert[v3].co, NULL, nearest->co);
 
 		if (sfs->flags & MOD_SMOKE_FLOW_INITVELOCITY && velocity_map) {
 			/* apply normal directional velocity */
@@ -1537,8 +1511,8 @@ static void sample_derivedmesh(
 				tex_co[2] = ((z - flow_center[2]) / base_res[2] - sfs->texture_offset) / sfs->texture_size;
 			}
 			else if (tface) {
-				interp_v2_v2v2v2(tex_co, tface[f_index].uv[0], tface[f_index].uv[(nearest.flags & BVH_ONQUAD) ? 2 : 1],
-				                 tface[f_index].uv[(nearest.flags & BVH_ONQUAD) ? 3 : 2], weights);
+				interp_v2_v2v2v2(tex_co, tface[f_index].uv[0], tface[f_index].uv[(nearest->flags & BVH_ONQUAD) ? 2 : 1],
+				                 tface[f_index].uv[(nearest->flags & BVH_ONQUAD) ? 3 : 2], weights);
 				/* map between -1.0f and 1.0f */
 				tex_co[0] = tex_co[0] * 2.0f - 1.0f;
 				tex_co[1] = tex_co[1] * 2.0f - 1.0f;
@@ -1559,6 +1533,150 @@ static void sample_derivedmesh(
 	influence_map[index] = MAX2(volume_factor, sample_str);
 }
 
+static void sample_derivedmesh(
+        SmokeFlowSettings *sfs, MVert *mvert, MTFace *tface, MFace *mface,
+        float *influence_map, float *velocity_map, int index, const int base_res[3], float flow_center[3],
+        BVHTreeFromMesh *treeData, const float ray_start[3], const float *vert_vel,
+        bool has_velocity, int defgrp_index, MDeformVert *dvert, float x, float y, float z)
+{
+	float ray_dir[3] = {1.0f, 0.0f, 0.0f};
+	BVHTreeRayHit hit = {0};
+	BVHTreeNearest nearest = {0};
+
+	float volume_factor = 0.0f;
+	bool has_nearest;
+
+	hit.index = -1;
+	hit.dist = 9999;
+	nearest.index = -1;
+	nearest.dist_sq = sfs->surface_distance * sfs->surface_distance; /* find_nearest uses squared distance */
+
+	/* Check volume collision */
+	if (sfs->volume_density) {
+		if (BLI_bvhtree_ray_cast(treeData->tree, ray_start, ray_dir, 0.0f, &hit, treeData->raycast_callback, treeData) != -1) {
+			float dot = ray_dir[0] * hit.no[0] + ray_dir[1] * hit.no[1] + ray_dir[2] * hit.no[2];
+			/*  If ray and hit face normal are facing same direction
+			 *	hit point is inside a closed mesh. */
+			if (dot >= 0) {
+				/* Also cast a ray in opposite direction to make sure
+				 * point is at least surrounded by two faces */
+				negate_v3(ray_dir);
+				hit.index = -1;
+				hit.dist = 9999;
+
+				BLI_bvhtree_ray_cast(treeData->tree, ray_start, ray_dir, 0.0f, &hit, treeData->raycast_callback, treeData);
+				if (hit.index != -1) {
+					volume_factor = sfs->volume_density;
+				}
+			}
+		}
+	}
+
+	/* find the nearest point on the mesh */
+	has_nearest = (BLI_bvhtree_find_nearest(treeData->tree, ray_start, &nearest, treeData->nearest_callback, treeData) != -1);
+
+	sample_derivedmesh_nearest(sfs, mvert, tface, mface, influence_map, velocity_map, index, base_res, flow_center,
+	                           has_nearest ? &nearest : NULL, volume_factor, vert_vel, has_velocity, defgrp_index, dvert, x, y, z);
+}
+
+/* Narrow band surface emission: instead of a nearest surface query for every cell of the
+ * emission bounds, splat each triangle into the cells within the surface distance and keep
+ * the closest one. Triangles are numbered like the BVH does, face * 2 + 1 is the second
+ * triangle of a quad (BVH_ONQUAD). Cell i samples at (min + i + 0.5) * cell_size. */
+static void sample_derivedmesh_band(
+        SmokeFlowSettings *sfs, MVert *mvert, MTFace *tface, MFace *mface, int numfaces,
+        float *influence_map, float *velocity_map, const int min[3], const int res[3], float cell_size,
+        const int base_res[3], float flow_center[3], const float *vert_vel,
+        bool has_velocity, int defgrp_index, MDeformVert *dvert)
+{
+	const float surface_distance = sfs->surface_distance;
+	const int total_cells = res[0] * res[1] * res[2];
+	float *band_dist_sq;
+	int *band_tri;
+	int i, f, z;
+
+	if (surface_distance <= 0.0f || total_cells <= 0)
+		return;
+
+	band_dist_sq = MEM_mallocN(sizeof(float) * total_cells, "smoke_flow_band_dist");
+	band_tri = MEM_mallocN(sizeof(int) * total_cells, "smoke_flow_band_tri");
+
+	for (i = 0; i < total_cells; i++) {
+		band_dist_sq[i] = surface_distance * surface_distance;
+		band_tri[i] = -1;
+	}
+
+	for (f = 0; f < numfaces; f++) {
+		const MFace *mf = &mface[f];
+		int quad;
+
+		for (quad = 0; quad < (mf->v4 ? 2 : 1); quad++) {
+			const float *t1 = mvert[mf->v1].co;
+			const float *t2 = mvert[quad ? mf->v3 : mf->v2].co;
+			const float *t3 = mvert[quad ? mf->v4 : mf->v3].co;
+			int cmin[3], cmax[3], x, y;
+
+			for (i = 0; i < 3; i++) {
+				const float lo = min_fff(t1[i], t2[i], t3[i]) - surface_distance;
+				const float hi = max_fff(t1[i], t2[i], t3[i]) + surface_distance;
+				cmin[i] = max_ii((int)ceilf(lo / cell_size - 0.5f) - min[i], 0);
+				cmax[i] = min_ii((int)floorf(hi / cell_size - 0.5f) - min[i], res[i] - 1);
+			}
+
+			for (z = cmin[2]; z <= cmax[2]; z++)
+				for (y = cmin[1]; y <= cmax[1]; y++)
+					for (x = cmin[0]; x <= cmax[0]; x++) {
+						const int index = smoke_get_index(x, res[0], y, res[1], z);
+						const float co[3] = {((float)(x + min[0]) + 0.5f) * cell_size,
+						                     ((float)(y + min[1]) + 0.5f) * cell_size,
+						                     ((float)(z + min[2]) + 0.5f) * cell_size};
+						float nearest_co[3], dist_sq;
+
+						closest_on_tri_to_point_v3(nearest_co, co, t1, t2, t3);
+						dist_sq = len_squared_v3v3(nearest_co, co);
+						if (dist_sq < band_dist_sq[index]) {
+							band_dist_sq[index] = dist_sq;
+							band_tri[index] = f * 2 + quad;
+						}
+					}
+		}
+	}
+
+	/* evaluate the cells that found a surface */
+#pragma omp parallel for schedule(static)
+	for (z = 0; z < res[2]; z++) {
+		int x, y;
+		for (y = 0; y < res[1]; y++)
+			for (x = 0; x < res[0]; x++) {
+				const int index = smoke_get_index(x, res[0], y, res[1], z);
+				const int tri = band_tri[index];
+
+				if (tri != -1) {
+					const MFace *mf = &mface[tri / 2];
+					const float co[3] = {((float)(x + min[0]) + 0.5f) * cell_size,
+					                     ((float)(y + min[1]) + 0.5f) * cell_size,
+					                     ((float)(z + min[2]) + 0.5f) * cell_size};
+					BVHTreeNearest nearest = {0};
+
+					nearest.index = tri / 2;
+					nearest.flags = (tri & 1) ? BVH_ONQUAD : 0;
+					nearest.dist_sq = band_dist_sq[index];
+					closest_on_tri_to_point_v3(nearest.co, co, mvert[mf->v1].co,
+					                           mvert[(tri & 1) ? mf->v3 : mf->v2].co, mvert[(tri & 1) ? mf->v4 : mf->v3].co);
+
+					/* x,y,z needs to be always lowres */
+					sample_derivedmesh_nearest(sfs, mvert, tface, mface, influence_map, velocity_map, index, base_res, flow_center,
+					                           &nearest, 0.0f, vert_vel, has_velocity, defgrp_index, dvert,
+					                           (float)(x + min[0]) * cell_size, (float)(y + min[1]) * cell_size,
+					                           (float)(z + min[2]) * cell_size);
+				}
+			}
+	}
+
+	MEM_freeN(band_dist_sq);
+	MEM_freeN(band_tri);
+}
+
 static void emit_from_derivedmesh(Object *flow_ob, SmokeDomainSettings *sds, SmokeFlowSettings *sfs, EmissionMap *em, float dt)
 {
 	if (sfs->dm) {
@@ -1650,7 +1768,19 @@ static void emit_from_derivedmesh(Object *flow_ob, SmokeDomainSettings *sds, Smo
 			res[i] = em->res[i] * hires_multiplier;
 		}
 
-		if (bvhtree_from_mesh_faces(&treeData, dm, 0.0f, 4, 6)) {
+		if (!sfs->volume_density) {
+			/* surface emission only needs the cells close to the faces */
+			const int numfaces = dm->getNumTessFaces(dm);
+
+			sample_derivedmesh_band(sfs, mvert, tface, mface, numfaces, em->influence, em->velocity, em->min, em->res, 1.0f,
+			                        sds->base_res, flow_center, vert_vel, has_velocity, defgrp_index, dvert);
+			if (hires_multiplier > 1) {
+				sample_derivedmesh_band(sfs, mvert, tface, mface, numfaces, em->influence_high, NULL, min, res,
+				                        1.0f / (float)hires_multiplier, sds->base_res, flow_center, vert_vel, has_velocity,
+				                        defgrp_index, dvert);
+			}
+		}
+		else if (bvhtree_from_mesh_faces(&treeData, dm, 0.0f, 4, 6)) {
 #pragma omp parallel for schedule(static)
 			for (z = min[2]; z < max[2]; z++) {
 				int x, y;
@@ -1705,6 +1835,12 @@ static void emit_from_derivedmesh(Object *flow_ob, SmokeDomainSettings *sds, Smo
 	}
 }
 
+/* flows sampled in parallel by update_flowsfluids() */
+static bool flow_emit_threaded(SmokeFlowSettings *sfs)
+{
+	return (sfs->source != MOD_SMOKE_FLOW_SOURCE_PARTICLES) && !sfs->subframes;
+}
+
 /**********************************************************
  *	Smoke step
  **********************************************************/
@@ -2086,6 +2222,37 @@ static void update_flowsfluids(Scene *scene, Object *ob, SmokeDomainSettings *sd
 	/* init emission maps for each flow */
 	emaps = MEM_callocN(sizeof(struct EmissionMap) * numflowobj, "smoke_flow_maps");
 
+	/* Mesh flows without subframes only read their own derived mesh and write their own
+	 * emission map, so many of them (e.g. fracture shards emitting dust) are sampled in
+	 * parallel. Subframes change the scene frame and particles evaluate their systems,
+	 * those stay serial below. */
+	if (numflowobj) {
+		unsigned int *meshflows = MEM_mallocN(sizeof(unsigned int) * numflowobj, "smoke_mesh_flows");
+		int nummeshflows = 0, i;
+
+		for (flowIndex = 0; flowIndex < numflowobj; flowIndex++) {
+			SmokeModifierData *smd2 = (SmokeModifierData *)modifiers_findByType(flowobjs[flowIndex], eModifierType_Smoke);
+
+			if ((smd2->type & MOD_SMOKE_TYPE_FLOW) && smd2->flow && flow_emit_threaded(smd2->flow)) {
+				meshflows[nummeshflows++] = flowIndex;
+			}
+		}
+
+		BLI_begin_threaded_malloc();
+
+#pragma omp parallel for schedule(dynamic, 1) if (nummeshflows > 1)
+		for (i = 0; i < nummeshflows; i++) {
+			Object *collob = flowobjs[meshflows[i]];
+			SmokeModifierData *smd2 = (SmokeModifierData *)modifiers_findByType(collob, eModifierType_Smoke);
+
+			emit_from_derivedmesh(collob, sds, smd2->flow, &emaps[meshflows[i]], dt);
+		}
+
+		BLI_end_threaded_malloc();
+
+		MEM_freeN(meshflows);
+	}
+
 	/* Prepare flow emission maps */
 	for (flowIndex = 0; flowIndex < numflowobj; flowIndex++)
 	{
@@ -2101,13 +2268,11 @@ static void update_flowsfluids(Scene *scene, Object *ob, SmokeDomainSettings *sd
 			EmissionMap *em = &emaps[flowIndex];
 
 			/* just sample flow directly to emission map if no subframes */
-			if (!subframes) {
-				if (sfs->source == MOD_SMOKE_FLOW_SOURCE_PARTICLES) {
-					emit_from_particles(collob, sds, sfs, em, scene, dt);
-				}
-				else {
-					emit_from_derivedmesh(collob, sds, sfs, em, dt);
-				}
+			if (flow_emit_threaded(sfs)) {
+				/* already sampled above */
+			}
+			else if (!subframes) {
+				emit_from_particles(collob, sds, sfs, em, scene, dt);
 			}
 			/* sample subframes */
 			else {
@@ -40,4 +40,19 @@ int BLI_hash_md5_stream(FILE *stream, void *resblock);
 
 char *BLI_hash_md5_to_hexdigest(void *resblock, char r_hex_digest[33]);
 
+/* Incremental MD5, for data which isn't in one contiguous block. Feed any number of
+ * BLI_hash_md5_add() calls between init and finish, the digest is the same as
+ * BLI_hash_md5_buffer() over the concatenated data. */
+
+typedef struct BLI_HashMD5 {
+	unsigned int state[4];
+	unsigned int len[2];  /* total bytes added, as a double word */
+	unsigned int buffer[16];  /* pending bytes of the current 64 byte block */
+	unsigned int buffer_len;
+} BLI_HashMD5;
+
+void BLI_hash_md5_init(BLI_HashMD5 *hash);
+void BLI_hash_md5_add(BLI_HashMD5 *hash, const void *data, size_t len);
+void *BLI_hash_md5_finish(BLI_HashMD5 *hash, void *resblock);
+
 #endif  /* __BLI_HASH_MD5_H__ */
@@ -391,6 +391,85 @@ void *BLI_hash_md5_buffer(const char *buffer, size_t len, void *resblock)
 	return md5_read_ctx(&ctx, resblock);
 }
 
+void BLI_hash_md5_init(BLI_HashMD5 *hash)
+{
+	struct md5_ctx ctx;
+
+	md5_init_ctx(&ctx);
+	hash->state[0] = ctx.A;
+	hash->state[1] = ctx.B;
+	hash->state[2] = ctx.C;
+	hash->state[3] = ctx.D;
+	hash->len[0] = 0;
+	hash->len[1] = 0;
+	hash->buffer_len = 0;
+}
+
+static void md5_hash_process_buffer(BLI_HashMD5 *hash)
+{
+	struct md5_ctx ctx;
+
+	ctx.A = hash->state[0];
+	ctx.B = hash->state[1];
+	ctx.C = hash->state[2];
+	ctx.D = hash->state[3];
+	md5_process_block(hash->buffer, 64, &ctx);
+	hash->state[0] = ctx.A;
+	hash->state[1] = ctx.B;
+	hash->state[2] = ctx.C;
+	hash->state[3] = ctx.D;
+	hash->buffer_len = 0;
+}
+
+void BLI_hash_md5_add(BLI_HashMD5 *hash, const void *data, size_t len)
+{
+	const char *p = data;
+
+	hash->len[0] += (md5_uint32)len;
+	if (hash->len[0] < (md5_uint32)len)
+		++hash->len[1];
+	hash->len[1] += (md5_uint32)((unsigned long long)len >> 32);
+
+	while (len > 0) {
+		size_t n = 64 - hash->buffer_len;
+		if (n > len)
+			n = len;
+
+		/* always go through the word aligned buffer, data may have any alignment */
+		memcpy((char *)hash->buffer + hash->buffer_len, p, n);
+		hash->buffer_len += (unsigned int)n;
+		p += n;
+		len -= n;
+
+		if (hash->buffer_len == 64)
+			md5_hash_process_buffer(hash);
+	}
+}
+
+void *BLI_hash_md5_finish(BLI_HashMD5 *hash, void *resblock)
+{
+	struct md5_ctx ctx;
+	char restbuf[64 + 72];
+	size_t rest = hash->buffer_len, pad;
+
+	memcpy(restbuf, hash->buffer, rest);
+	memcpy(&restbuf[rest], fillbuf, 64);
+
+	pad = rest >= 56 ? 64 + 56 - rest : 56 - rest;
+
+	/* Put the 64-bit length in *bits* at the end of the buffer. */
+	*(md5_uint32 *) &restbuf[rest + pad] = SWAP(hash->len[0] << 3);
+	*(md5_uint32 *) &restbuf[rest + pad + 4] = SWAP((hash->len[1] << 3) | (hash->len[0] >> 29));
+
+	ctx.A = hash->state[0];
+	ctx.B = hash->state[1];
+	ctx.C = hash->state[2];
+	ctx.D = hash->state[3];
+	md5_process_block(restbuf, rest + pad + 8, &ctx);
+
+	return md5_read_ctx(&ctx, resblock);
+}
+
 char *BLI_hash_md5_to_hexdigest(void *resblock, char r_hex_digest[33])
 {
 	static const char hex_map[17] = "0123456789abcdef";
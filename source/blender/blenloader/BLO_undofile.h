@@ -38,12 +38,14 @@ typedef struct {
 	
 	char *buf;
 	unsigned int ident, size;
+	unsigned int hash;  /* of the chunk content, to find identical chunks anywhere in the previous step */
 	
 } MemFileChunk;
 
 typedef struct MemFile {
 	ListBase chunks;
-	unsigned int size;
+	unsigned int size;        /* bytes allocated by this step, not shared with the previous one */
+	unsigned int size_total;  /* all bytes written in this step */
 } MemFile;
 
 /* actually only used writefile.c */
@@ -177,22 +177,17 @@ LinkNode *BLO_blendhandle_get_previews(BlendHandle *bh, int ofblocktype, int *to
 					if (prv) {
 						memcpy(new_prv, prv, sizeof(PreviewImage));
 						if (prv->rect[0]) {
-							unsigned int *rect = NULL;
-							new_prv->rect[0] = MEM_callocN(new_prv->w[0] * new_prv->h[0] * sizeof(unsigned int), "prvrect");
+							/* data blocks may not be read yet, go through read_struct() */
 							bhead = blo_nextbhead(fd, bhead);
-							rect = (unsigned int *)(bhead + 1);
-							memcpy(new_prv->rect[0], rect, bhead->len);
+							new_prv->rect[0] = BLO_library_read_struct(fd, bhead, "prvrect");
 						}
 						else {
 							new_prv->rect[0] = NULL;
 						}
 						
 						if (prv->rect[1]) {
-							unsigned int *rect = NULL;
-							new_prv->rect[1] = MEM_callocN(new_prv->w[1] * new_prv->h[1] * sizeof(unsigned int), "prvrect");
 							bhead = blo_nextbhead(fd, bhead);
-							rect = (unsigned int *)(bhead + 1);
-							memcpy(new_prv->rect[1], rect, bhead->len);
+							new_prv->rect[1] = BLO_library_read_struct(fd, bhead, "prvrect");
 						}
 						else {
 							new_prv->rect[1] = NULL;
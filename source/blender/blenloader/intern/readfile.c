@@ -45,6 +45,8 @@
 #include "BLI_utildefines.h"
 #ifndef WIN32
 #  include <unistd.h> // for read close
+#  include <sys/mman.h> // for mmap
+#  include <sys/stat.h> // for fstat
 #else
 #  include <io.h> // for open close read
 #  include "winsock2.h"
@@ -54,6 +56,13 @@
 /* allow readfile to use deprecated functionality */
 #define DNA_DEPRECATED_ALLOW
 
+/* Uncompressed files are memory mapped and their DATA blocks are only indexed while scanning
+ * the file, read_struct() copies their contents out of the mapping when they are used. Linking
+ * a few datablocks out of a large library then only touches the pages those blocks live in. */
+#ifndef WIN32
+#  define USE_BHEAD_READ_ON_DEMAND
+#endif
+
 #include "DNA_anim_types.h"
 #include "DNA_armature_types.h"
 #include "DNA_actuator_types.h"
@@ -109,6 +118,9 @@
 #include "BLI_math.h"
 #include "BLI_threads.h"
 #include "BLI_mempool.h"
+#include "BLI_task.h"
+
+#include "PIL_time.h"
 
 #include "BLF_translation.h"
 
@@ -162,6 +174,10 @@
 
 #include "BKE_cdderivedmesh.h"  //for fracture meshisland handling
 
+#ifdef WITH_LZO
+#include "minilzo.h"
+#endif
+
 
 /*
  * Remark: still a weak point is the newaddress() function, that doesnt solve reading from
@@ -222,8 +238,13 @@ typedef struct OldNew {
 typedef struct OldNewMap {
 	OldNew *entries;
 	int nentries, entriessize;
-	int sorted;
 	int lasthit;
+	/* open addressing hash on the old pointers, holds entry index + 1 (0 is a free slot),
+	 * twice the size of the entries so it is never more than half full */
+	int *map;
+	int map_exp;
+	/* statistics for the load time report */
+	int tot_lookups, tot_lasthits;
 } OldNewMap;
 
 
@@ -264,30 +285,40 @@ static const char *library_parent_filepath(Library *lib)
 	return lib->parent ? lib->parent->filepath : "<direct>";
 }
 
+#define OLDNEWMAP_DEFAULT_EXP 10
+
 static OldNewMap *oldnewmap_new(void) 
 {
 	OldNewMap *onm= MEM_callocN(sizeof(*onm), "OldNewMap");
 	
-	onm->entriessize = 1024;
+	onm->entriessize = 1 << OLDNEWMAP_DEFAULT_EXP;
 	onm->entries = MEM_mallocN(sizeof(*onm->entries)*onm->entriessize, "OldNewMap.entries");
+	onm->map_exp = OLDNEWMAP_DEFAULT_EXP + 1;
+	onm->map = MEM_callocN(sizeof(*onm->map) << onm->map_exp, "OldNewMap.map");
 	
 	return onm;
 }
 
-static int verg_oldnewmap(const void *v1, const void *v2)
+/* fibonacci hashing, old pointers are aligned so their low bits alone are a poor index */
+BLI_INLINE unsigned int oldnewmap_hash(const void *addr, int exp)
 {
-	const struct OldNew *x1=v1, *x2=v2;
+	uint64_t key = (uint64_t)(uintptr_t)addr;
 	
-	if (x1->old > x2->old) return 1;
-	else if (x1->old < x2->old) return -1;
-	return 0;
+	key ^= key >> 32;
+	return ((unsigned int)key * 2654435761u) >> (32 - exp);
 }
 
-
-static void oldnewmap_sort(FileData *fd) 
+/* linear probing without removal keeps entries with the same old pointer in insertion order,
+ * so lookups find the first inserted one, just like the former linear search */
+static void oldnewmap_map_insert(OldNewMap *onm, int index)
 {
-	qsort(fd->libmap->entries, fd->libmap->nentries, sizeof(OldNew), verg_oldnewmap);
-	fd->libmap->sorted = 1;
+	const unsigned int mask = (1u << onm->map_exp) - 1;
+	unsigned int slot = oldnewmap_hash(onm->entries[index].old, onm->map_exp);
+	
+	while (onm->map[slot] != 0) {
+		slot = (slot + 1) & mask;
+	}
+	onm->map[slot] = index + 1;
 }
 
 /* nr is zero for data, and ID code for libdata */
@@ -301,17 +332,27 @@ static void oldnewmap_insert(OldNewMap *onm, void *oldaddr, void *newaddr, int n
 		int osize = onm->entriessize;
 		OldNew *oentries = onm->entries;
 		
+		int i;
+		
 		onm->entriessize *= 2;
 		onm->entries = MEM_mallocN(sizeof(*onm->entries)*onm->entriessize, "OldNewMap.entries");
 		
 		memcpy(onm->entries, oentries, sizeof(*oentries)*osize);
 		MEM_freeN(oentries);
+		
+		onm->map_exp++;
+		MEM_freeN(onm->map);
+		onm->map = MEM_callocN(sizeof(*onm->map) << onm->map_exp, "OldNewMap.map");
+		for (i = 0; i < onm->nentries; i++) {
+			oldnewmap_map_insert(onm, i);
+		}
 	}
 
-	entry = &onm->entries[onm->nentries++];
+	entry = &onm->entries[onm->nentries];
 	entry->old = oldaddr;
 	entry->newp = newaddr;
 	entry->nr = nr;
+	oldnewmap_map_insert(onm, onm->nentries++);
 }
 
 void blo_do_versions_oldnewmap_insert(OldNewMap *onm, void *oldaddr, void *newaddr, int nr)
@@ -321,25 +362,30 @@ void blo_do_versions_oldnewmap_insert(OldNewMap *onm, void *oldaddr, void *newad
 
 static void *oldnewmap_lookup_and_inc(OldNewMap *onm, void *addr, bool increase_users) 
 {
-	int i;
+	const unsigned int mask = (1u << onm->map_exp) - 1;
+	unsigned int slot;
+	int index;
 	
 	if (addr == NULL) return NULL;
 	
+	onm->tot_lookups++;
+	
 	if (onm->lasthit < onm->nentries-1) {
 		OldNew *entry = &onm->entries[++onm->lasthit];
 		
 		if (entry->old == addr) {
+			onm->tot_lasthits++;
 			if (increase_users)
 				entry->nr++;
 			return entry->newp;
 		}
 	}
 	
-	for (i = 0; i < onm->nentries; i++) {
-		OldNew *entry = &onm->entries[i];
+	for (slot = oldnewmap_hash(addr, onm->map_exp); (index = onm->map[slot]) != 0; slot = (slot + 1) & mask) {
+		OldNew *entry = &onm->entries[index - 1];
 		
 		if (entry->old == addr) {
-			onm->lasthit = i;
+			onm->lasthit = index - 1;
 			
 			if (increase_users)
 				entry->nr++;
@@ -353,40 +399,28 @@ static void *oldnewmap_lookup_and_inc(OldNewMap *onm, void *addr, bool increase_
 /* for libdata, nr has ID code, no increment */
 static void *oldnewmap_liblookup(OldNewMap *onm, void *addr, void *lib)
 {
+	const unsigned int mask = (1u << onm->map_exp) - 1;
+	unsigned int slot;
+	int index;
+
 	if (addr == NULL) {
 		return NULL;
 	}
 
-	/* lasthit works fine for non-libdata, linking there is done in same sequence as writing */
-	if (onm->sorted) {
-		OldNew entry_s, *entry;
+	onm->tot_lookups++;
 
-		entry_s.old = addr;
+	/* lasthit works fine for non-libdata, linking there is done in same sequence as writing,
+	 * libdata goes through the hash only */
+	for (slot = oldnewmap_hash(addr, onm->map_exp); (index = onm->map[slot]) != 0; slot = (slot + 1) & mask) {
+		OldNew *entry = &onm->entries[index - 1];
 
-		entry = bsearch(&entry_s, onm->entries, onm->nentries, sizeof(OldNew), verg_oldnewmap);
-		if (entry) {
+		if (entry->old == addr) {
 			ID *id = entry->newp;
-
 			if (id && (!lib || id->lib)) {
 				return id;
 			}
 		}
 	}
-	else {
-		/* note, this can be a bottle neck when loading some files */
-		unsigned int nentries = (unsigned int)onm->nentries;
-		unsigned int i;
-		OldNew *entry;
-
-		for (i = 0, entry = onm->entries; i < nentries; i++, entry++) {
-			if (entry->old == addr) {
-				ID *id = entry->newp;
-				if (id && (!lib || id->lib)) {
-					return id;
-				}
-			}
-		}
-	}
 
 	return NULL;
 }
@@ -406,12 +440,31 @@ static void oldnewmap_free_unused(OldNewMap *onm)
 
 static void oldnewmap_clear(OldNewMap *onm) 
 {
+	const unsigned int mask = (1u << onm->map_exp) - 1;
+	int i;
+
+	/* the datamap is cleared after every datablock, so only wipe the whole hash when it is well used */
+	if (onm->nentries > (1 << (onm->map_exp - 3))) {
+		memset(onm->map, 0, sizeof(*onm->map) << onm->map_exp);
+	}
+	else {
+		for (i = 0; i < onm->nentries; i++) {
+			unsigned int slot = oldnewmap_hash(onm->entries[i].old, onm->map_exp);
+
+			while (onm->map[slot] != i + 1) {
+				slot = (slot + 1) & mask;
+			}
+			onm->map[slot] = 0;
+		}
+	}
+
 	onm->nentries = 0;
 	onm->lasthit = 0;
 }
 
 static void oldnewmap_free(OldNewMap *onm) 
 {
+	MEM_freeN(onm->map);
 	MEM_freeN(onm->entries);
 	MEM_freeN(onm);
 }
@@ -689,10 +742,32 @@ static BHeadN *get_bhead(FileData *fd)
 			/* bhead now contains the (converted) bhead structure. Now read
 			 * the associated data and put everything in a BHeadN (creative naming !)
 			 */
-			if (!fd->eof) {
+			if (fd->eof) {
+				/* pass */
+			}
+#ifdef USE_BHEAD_READ_ON_DEMAND
+			else if (fd->mmap_data && bhead.code == DATA) {
+				/* only index the data, read_struct() takes it from the mapping */
+				if ((size_t)bhead.len <= fd->mmap_size - fd->mmap_offset) {
+					new_bhead = MEM_mallocN(sizeof(BHeadN), "new_bhead");
+					new_bhead->next = new_bhead->prev = NULL;
+					new_bhead->file_offset = fd->mmap_offset;
+					new_bhead->has_data = false;
+					new_bhead->bhead = bhead;
+
+					fd->mmap_offset += bhead.len;
+				}
+				else {
+					fd->eof = 1;
+				}
+			}
+#endif
+			else {
 				new_bhead = MEM_mallocN(sizeof(BHeadN) + bhead.len, "new_bhead");
 				if (new_bhead) {
 					new_bhead->next = new_bhead->prev = NULL;
+					new_bhead->file_offset = 0;
+					new_bhead->has_data = true;
 					new_bhead->bhead = bhead;
 					
 					readsize = fd->read(fd, new_bhead + 1, bhead.len);
@@ -742,7 +817,7 @@ BHead *blo_firstbhead(FileData *fd)
 
 BHead *blo_prevbhead(FileData *UNUSED(fd), BHead *thisblock)
 {
-	BHeadN *bheadn = (BHeadN *) (((char *) thisblock) - offsetof(BHeadN, bhead));
+	BHeadN *bheadn = BHEADN_FROM_BHEAD(thisblock);
 	BHeadN *prev = bheadn->prev;
 	
 	return (prev) ? &prev->bhead : NULL;
@@ -756,7 +831,7 @@ BHead *blo_nextbhead(FileData *fd, BHead *thisblock)
 	if (thisblock) {
 		/* bhead is actually a sub part of BHeadN
 		 * We calculate the BHeadN pointer from the BHead pointer below */
-		new_bhead = (BHeadN *) (((char *) thisblock) - offsetof(BHeadN, bhead));
+		new_bhead = BHEADN_FROM_BHEAD(thisblock);
 		
 		/* get the next BHeadN. If it doesn't exist we read in the next one */
 		new_bhead = new_bhead->next;
@@ -854,6 +929,40 @@ static int fd_read_from_file(FileData *filedata, void *buffer, unsigned int size
 	return readsize;
 }
 
+#ifdef USE_BHEAD_READ_ON_DEMAND
+static int fd_read_from_mmap(FileData *filedata, void *buffer, unsigned int size)
+{
+	const size_t readsize = MIN2((size_t)size, filedata->mmap_size - filedata->mmap_offset);
+
+	memcpy(buffer, filedata->mmap_data + filedata->mmap_offset, readsize);
+	filedata->mmap_offset += readsize;
+
+	return (int)readsize;
+}
+
+/* contents of a block, DATA blocks of mapped files are still in the mapping */
+static const void *bhead_data(FileData *fd, BHead *bhead)
+{
+	BHeadN *bheadn = BHEADN_FROM_BHEAD(bhead);
+
+	return (bheadn->has_data) ? (const void *)(bhead + 1) : (const void *)(fd->mmap_data + bheadn->file_offset);
+}
+
+/* copy of a block with its data read, for the cases that modify the data in place */
+static BHead *bhead_read_full(FileData *fd, BHead *bhead)
+{
+	BHeadN *new_bheadn = MEM_mallocN(sizeof(BHeadN) + bhead->len, "new_bhead");
+
+	new_bheadn->next = new_bheadn->prev = NULL;
+	new_bheadn->file_offset = 0;
+	new_bheadn->has_data = true;
+	new_bheadn->bhead = *bhead;
+	memcpy(new_bheadn + 1, bhead_data(fd, bhead), bhead->len);
+
+	return &new_bheadn->bhead;
+}
+#endif
+
 static int fd_read_gzip_from_file(FileData *filedata, void *buffer, unsigned int size)
 {
 	int readsize = gzread(filedata->gzfiledes, buffer, size);
@@ -868,6 +977,137 @@ static int fd_read_gzip_from_file(FileData *filedata, void *buffer, unsigned int
 	return (readsize);
 }
 
+/* block compressed file, a batch of blocks is read in one go and decompressed on all threads,
+ * then handed out in order like any other stream */
+typedef struct BlendBlockReader {
+	int file;
+	bool error, eof;
+	uint32_t block_size;
+
+	/* current batch */
+	char *raw;
+	unsigned char *comp;
+	BlendBlockInfo *info;
+	size_t *comp_offset;
+	int tot_blocks, batch_len;
+
+	/* read position in the batch */
+	int cur;
+	uint32_t cur_offset;
+} BlendBlockReader;
+
+static void block_reader_free(BlendBlockReader *br)
+{
+	close(br->file);
+	MEM_SAFE_FREE(br->raw);
+	MEM_SAFE_FREE(br->comp);
+	MEM_SAFE_FREE(br->info);
+	MEM_SAFE_FREE(br->comp_offset);
+	MEM_freeN(br);
+}
+
+static void block_decompress_task(void *userdata, int iter)
+{
+	BlendBlockReader *br = userdata;
+	BlendBlockInfo *info = &br->info[iter];
+	char *raw = br->raw + (size_t)iter * br->block_size;
+	const unsigned char *comp = br->comp + br->comp_offset[iter];
+
+	if (info->comp_size == info->raw_size) {
+		memcpy(raw, comp, info->raw_size);
+	}
+	else {
+#ifdef WITH_LZO
+		lzo_uint out_len = info->raw_size;
+
+		if (lzo1x_decompress_safe(comp, info->comp_size, (unsigned char *)raw, &out_len, NULL) != LZO_E_OK ||
+		    out_len != info->raw_size)
+		{
+			/* mark the block as broken, checked after the batch */
+			info->raw_size = 0;
+		}
+#else
+		info->raw_size = 0;
+#endif
+	}
+}
+
+static bool block_reader_next_batch(BlendBlockReader *br)
+{
+	size_t comp_len = 0;
+	int i;
+
+	br->batch_len = 0;
+	br->cur = 0;
+	br->cur_offset = 0;
+
+	while (!br->eof && !br->error && br->batch_len < br->tot_blocks) {
+		BlendBlockInfo *info = &br->info[br->batch_len];
+
+		if (read(br->file, info, sizeof(*info)) != sizeof(*info)) {
+			br->error = true;
+		}
+		else if (info->raw_size == 0) {
+			br->eof = true;
+		}
+		else if (info->raw_size > br->block_size || info->comp_size > info->raw_size ||
+		         read(br->file, br->comp + comp_len, info->comp_size) != (int)info->comp_size)
+		{
+			br->error = true;
+		}
+		else {
+			br->comp_offset[br->batch_len++] = comp_len;
+			comp_len += info->comp_size;
+		}
+	}
+
+	if (br->batch_len > 0) {
+		BLI_task_parallel_range(0, br->batch_len, br, block_decompress_task);
+
+		for (i = 0; i < br->batch_len; i++) {
+			if (br->info[i].raw_size == 0) {
+				printf("%s: broken block in compressed file\n", __func__);
+				br->error = true;
+			}
+		}
+	}
+
+	return (br->batch_len > 0) && !br->error;
+}
+
+static int fd_read_from_blocks(FileData *filedata, void *buffer, unsigned int size)
+{
+	BlendBlockReader *br = filedata->blockfile;
+	unsigned int totread = 0;
+
+	while (totread < size && !br->error) {
+		uint32_t len;
+
+		if (br->cur == br->batch_len) {
+			if (!block_reader_next_batch(br)) {
+				break;
+			}
+		}
+
+		len = MIN2(br->info[br->cur].raw_size - br->cur_offset, size - totread);
+		memcpy((char *)buffer + totread, br->raw + (size_t)br->cur * br->block_size + br->cur_offset, len);
+		totread += len;
+		br->cur_offset += len;
+
+		if (br->cur_offset == br->info[br->cur].raw_size) {
+			br->cur++;
+			br->cur_offset = 0;
+		}
+	}
+
+	if (br->error) {
+		return EOF;
+	}
+
+	filedata->seek += totread;
+	return totread;
+}
+
 static int fd_read_from_memory(FileData *filedata, void *buffer, unsigned int size)
 {
 	/* don't read more bytes then there are available in the buffer */
@@ -978,12 +1218,100 @@ static FileData *blo_decode_and_check(FileData *fd, ReportList *reports)
 	return fd;
 }
 
+static FileData *blo_openblenderblocks(int file, const BlendBlockHeader *header, const char *filepath, ReportList *reports)
+{
+	BlendBlockReader *br;
+	FileData *fd;
+
+#ifdef WITH_LZO
+	if (header->codec != BLEND_BLOCK_CODEC_LZO || header->block_size == 0 || header->block_size > (1 << 26))
+#endif
+	{
+		BKE_reportf(reports, RPT_ERROR, "Failed to read blend file '%s', unsupported block compression", filepath);
+		close(file);
+		return NULL;
+	}
+
+	br = MEM_callocN(sizeof(*br), "BlendBlockReader");
+	br->file = file;
+	br->block_size = header->block_size;
+	br->tot_blocks = 2 * BLI_system_thread_count();
+	br->raw = MEM_mallocN((size_t)br->tot_blocks * br->block_size, "BlendBlockReader raw");
+	br->comp = MEM_mallocN((size_t)br->tot_blocks * br->block_size, "BlendBlockReader comp");
+	br->info = MEM_mallocN(sizeof(*br->info) * br->tot_blocks, "BlendBlockReader info");
+	br->comp_offset = MEM_mallocN(sizeof(*br->comp_offset) * br->tot_blocks, "BlendBlockReader comp_offset");
+
+	fd = filedata_new();
+	fd->blockfile = br;
+	fd->read = fd_read_from_blocks;
+
+	/* needed for library_append and read_libraries */
+	BLI_strncpy(fd->relabase, filepath, sizeof(fd->relabase));
+
+	return blo_decode_and_check(fd, reports);
+}
+
+#ifdef USE_BHEAD_READ_ON_DEMAND
+static FileData *blo_openblendermapped(int file, const char *filepath)
+{
+	FileData *fd;
+	struct stat st;
+	void *mapped;
+
+	if (fstat(file, &st) != 0 || st.st_size <= 0) {
+		return NULL;
+	}
+
+	mapped = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	if (mapped == MAP_FAILED) {
+		return NULL;
+	}
+
+	fd = filedata_new();
+	fd->mmap_data = mapped;
+	fd->mmap_size = (size_t)st.st_size;
+	fd->read = fd_read_from_mmap;
+
+	/* needed for library_append and read_libraries */
+	BLI_strncpy(fd->relabase, filepath, sizeof(fd->relabase));
+
+	return fd;
+}
+#endif
+
 /* cannot be called with relative paths anymore! */
 /* on each new library added, it now checks for the current FileData and expands relativeness */
 FileData *blo_openblenderfile(const char *filepath, ReportList *reports)
 {
 	gzFile gzfile;
+	int file;
 	errno = 0;
+
+	/* block compressed files are read by us, everything else (plain or gzip) through zlib */
+	file = BLI_open(filepath, O_BINARY | O_RDONLY, 0);
+	if (file != -1) {
+		BlendBlockHeader header;
+		const int readsize = read(file, &header, sizeof(header));
+
+		if (readsize == sizeof(header) &&
+		    memcmp(header.magic, BLEND_BLOCK_MAGIC, sizeof(header.magic)) == 0)
+		{
+			return blo_openblenderblocks(file, &header, filepath, reports);
+		}
+#ifdef USE_BHEAD_READ_ON_DEMAND
+		/* uncompressed, map it (the mapping stays valid after closing the file) */
+		if (readsize >= SIZEOFBLENDERHEADER && STREQLEN(header.magic, "BLENDER", 7)) {
+			FileData *fd = blo_openblendermapped(file, filepath);
+
+			if (fd) {
+				close(file);
+				return blo_decode_and_check(fd, reports);
+			}
+		}
+#endif
+		close(file);
+	}
+
 	gzfile = BLI_gzopen(filepath, "rb");
 	
 	if (gzfile == (gzFile)Z_NULL) {
@@ -1101,6 +1429,16 @@ void blo_freefiledata(FileData *fd)
 			gzclose(fd->gzfiledes);
 		}
 		
+		if (fd->blockfile != NULL) {
+			block_reader_free(fd->blockfile);
+		}
+
+#ifdef USE_BHEAD_READ_ON_DEMAND
+		if (fd->mmap_data != NULL) {
+			munmap((void *)fd->mmap_data, fd->mmap_size);
+		}
+#endif
+		
 		if (fd->strm.next_in) {
 			if (inflateEnd (&fd->strm) != Z_OK) {
 				printf("close gzip stream error\n");
@@ -1586,19 +1924,43 @@ static void *read_struct(FileData *fd, BHead *bh, const char *blockname)
 	void *temp = NULL;
 	
 	if (bh->len) {
+#ifdef USE_BHEAD_READ_ON_DEMAND
+		BHead *bh_orig = bh;
+		const void *data;
+#else
+		const void *data = (bh + 1);
+#endif
+
 		/* switch is based on file dna */
-		if (bh->SDNAnr && (fd->flags & FD_FLAGS_SWITCH_ENDIAN))
+		if (bh->SDNAnr && (fd->flags & FD_FLAGS_SWITCH_ENDIAN)) {
+#ifdef USE_BHEAD_READ_ON_DEMAND
+			/* swapped in place, never in the mapping */
+			if (!BHEADN_FROM_BHEAD(bh)->has_data) {
+				bh = bhead_read_full(fd, bh);
+			}
+#endif
 			switch_endian_structs(fd->filesdna, bh);
-		
+		}
+
+#ifdef USE_BHEAD_READ_ON_DEMAND
+		data = bhead_data(fd, bh);
+#endif
+
 		if (fd->compflags[bh->SDNAnr]) {	/* flag==0: doesn't exist anymore */
 			if (fd->compflags[bh->SDNAnr] == 2) {
-				temp = DNA_struct_reconstruct(fd->memsdna, fd->filesdna, fd->compflags, bh->SDNAnr, bh->nr, (bh+1));
+				temp = DNA_struct_reconstruct(fd->memsdna, fd->filesdna, fd->compflags, bh->SDNAnr, bh->nr, (void *)data);
 			}
 			else {
 				temp = MEM_mallocN(bh->len, blockname);
-				memcpy(temp, (bh+1), bh->len);
+				memcpy(temp, data, bh->len);
 			}
 		}
+
+#ifdef USE_BHEAD_READ_ON_DEMAND
+		if (bh != bh_orig) {
+			MEM_freeN(BHEADN_FROM_BHEAD(bh));
+		}
+#endif
 	}
 
 	return temp;
@@ -5329,6 +5691,10 @@ static void direct_link_modifiers(FileData *fd, ListBase *lb)
 				if (mmd->bindcos)      BLI_endian_switch_float_array(mmd->bindcos, mmd->totcagevert * 3);
 			}
 		}
+		else if (md->type == eModifierType_FractureStream) {
+			FractureStreamModifierData *fsmd = (FractureStreamModifierData *)md;
+			fsmd->cache = NULL;
+		}
 		else if (md->type == eModifierType_Ocean) {
 			OceanModifierData *omd = (OceanModifierData *)md;
 			omd->oceancache = NULL;
@@ -5530,6 +5896,9 @@ static void direct_link_object(FileData *fd, Object *ob)
 					read_shard(fd, &s);
 				}
 
+				/* copied objects share their shards at runtime, each one gets its own from file */
+				fm->users = 1;
+
 				fc->current = fs; /*temporarily set for copy visual mesh*/
 				mverts = BKE_copy_visual_mesh(ob, fs);
 				s = fm->shard_map.first;
@@ -5542,20 +5911,14 @@ static void direct_link_object(FileData *fd, Object *ob)
 				invert_m4_m4(ob->imat, ob->obmat);
 				for (mi = fs->island_map.first; mi; mi = mi->next)
 				{
-					MVert* mvert;
-					int nverts, j;
 					read_meshIsland(fd, &mi);
 
-					mi->physics_mesh = BKE_shard_create_dm(s, true);
-					nverts = mi->physics_mesh->getNumVerts(mi->physics_mesh);
-					mvert = mi->physics_mesh->getVertArray(mi->physics_mesh);
+					/* physics mesh is built lazily from the shard, on first shape validation */
+					mi->physics_mesh = NULL;
+					mi->shard = s;
 
 					vertstart += BKE_initialize_meshisland(&mi, mverts, vertstart);
 					s = s->next;
-					for (j = 0; j < nverts ; j++)
-					{
-						sub_v3_v3(mvert[j].co, mi->centroid);
-					}
 
 					//BKE_rigidbody_set_initial_transform(ob, mi, mi->rigidbody);
 
@@ -5587,6 +5950,7 @@ static void direct_link_object(FileData *fd, Object *ob)
 		if (ob->rigidbody_constraint->fracture_constraints) {
 			ob->rigidbody_constraint->fracture_constraints->constraint_map.first = NULL;
 			ob->rigidbody_constraint->fracture_constraints->constraint_map.last = NULL;
+			ob->rigidbody_constraint->fracture_constraints->constraint_pool = NULL;
 		}
 	}
 
@@ -6226,6 +6590,7 @@ static void direct_link_scene(FileData *fd, Scene *sce)
 		rbw->numbodies = 0;
 		rbw->cache_index_map = NULL;
 		rbw->cache_offset_map = NULL;
+		BLI_listbase_clear(&rbw->checkpoints);
 
 		/* set effector weights */
 		rbw->effector_weights = newdataadr(fd, rbw->effector_weights);
@@ -8291,8 +8656,6 @@ static void do_versions_after_linking(FileData *fd, Library *lib, Main *main)
 
 static void lib_link_all(FileData *fd, Main *main)
 {
-	oldnewmap_sort(fd);
-	
 	/* No load UI for undo memfiles */
 	if (fd->memfile == NULL) {
 		lib_link_windowmanager(fd, main);
@@ -8494,6 +8857,7 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
 	BHead *bhead = blo_firstbhead(fd);
 	BlendFileData *bfd;
 	ListBase mainlist = {NULL, NULL};
+	double time_start = PIL_check_seconds_timer(), time_blocks, time_versions, time_libraries, time_link;
 	
 	bfd = MEM_callocN(sizeof(BlendFileData), "blendfiledata");
 	bfd->main = BKE_main_new();
@@ -8554,17 +8918,25 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
 		}
 	}
 	
+	time_blocks = PIL_check_seconds_timer();
+	
 	/* do before read_libraries, but skip undo case */
 	if (fd->memfile==NULL)
 		do_versions(fd, NULL, bfd->main);
 	
 	do_versions_userdef(fd, bfd);
 	
+	time_versions = PIL_check_seconds_timer();
+	
 	read_libraries(fd, &mainlist);
 	
 	blo_join_main(&mainlist);
 	
+	time_libraries = PIL_check_seconds_timer();
+	
 	lib_link_all(fd, bfd->main);
+	
+	time_link = PIL_check_seconds_timer();
 
 	//do_versions_after_linking(fd, NULL, bfd->main); // XXX: not here (or even in this function at all)! this causes crashes on many files - Aligorith (July 04, 2010)
 	lib_verify_nodetree(bfd->main, true);
@@ -8574,6 +8946,16 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
 	
 	link_global(fd, bfd);	/* as last */
 	
+	if (G.debug & G_DEBUG) {
+		printf("read file %s timing\n"
+		       "  read and direct link: %.4fs, versioning: %.4fs, libraries: %.4fs, lib link: %.4fs, total: %.4fs\n"
+		       "  data pointers: %d lookups (%d by last hit), lib pointers: %d lookups, %d lib blocks\n",
+		       fd->relabase, time_blocks - time_start, time_versions - time_blocks,
+		       time_libraries - time_versions, time_link - time_libraries,
+		       PIL_check_seconds_timer() - time_start,
+		       fd->datamap->tot_lookups, fd->datamap->tot_lasthits, fd->libmap->tot_lookups, fd->libmap->nentries);
+	}
+	
 	return bfd;
 }
 
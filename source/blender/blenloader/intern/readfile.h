@@ -38,6 +38,7 @@
 
 struct OldNewMap;
 struct MemFile;
+struct BlendBlockReader;
 struct bheadsort;
 struct ReportList;
 struct Object;
@@ -63,6 +64,12 @@ typedef struct FileData {
 	// variables needed for reading from file
 	int filedes;
 	gzFile gzfiledes;
+	struct BlendBlockReader *blockfile;
+
+	// variables needed for reading from a memory mapped file, see USE_BHEAD_READ_ON_DEMAND
+	const char *mmap_data;
+	size_t mmap_size;
+	size_t mmap_offset;
 
 	// now only in use for library appending
 	char relabase[FILE_MAX];
@@ -105,9 +112,15 @@ typedef struct FileData {
 
 typedef struct BHeadN {
 	struct BHeadN *next, *prev;
+	/* when the data is not read yet (has_data == false) it is at this offset of the memory mapped file */
+	size_t file_offset;
+	bool has_data;
+	char pad[7];
 	struct BHead bhead;
 } BHeadN;
 
+#define BHEADN_FROM_BHEAD(bh) ((BHeadN *)(((char *)(bh)) - offsetof(BHeadN, bhead)))
+
 
 #define FD_FLAGS_SWITCH_ENDIAN             (1 << 0)
 #define FD_FLAGS_FILE_POINTSIZE_IS_4       (1 << 1)
@@ -118,6 +131,35 @@ typedef struct BHeadN {
 
 #define SIZEOFBLENDERHEADER 12
 
+/* Block compressed container (G_FILE_COMPRESS_BLOCKS), wraps a regular .blend stream:
+ * - a BlendBlockHeader,
+ * - the blocks, each a BlendBlockInfo followed by comp_size bytes, stored raw when comp_size equals raw_size,
+ * - an empty BlendBlockInfo ending the blocks,
+ * - the block index, its entry count as uint64_t followed by one BlendBlockEntry per block,
+ * - the file offset of the block index as uint64_t.
+ * Blocks are compressed independently, so both sides can (de)compress them in parallel.
+ * The magic starts like a .blend header, older versions reject it as "not a blend file". */
+#define BLEND_BLOCK_MAGIC "BLENDER~BLK1"
+#define BLEND_BLOCK_CODEC_LZO 1
+#define BLEND_BLOCK_SIZE (1 << 20)
+
+typedef struct BlendBlockHeader {
+	char magic[SIZEOFBLENDERHEADER];
+	uint32_t codec;
+	uint32_t block_size;
+} BlendBlockHeader;
+
+typedef struct BlendBlockInfo {
+	uint32_t raw_size;
+	uint32_t comp_size;
+} BlendBlockInfo;
+
+typedef struct BlendBlockEntry {
+	uint64_t offset;  /* of the block's BlendBlockInfo */
+	uint32_t raw_size;
+	uint32_t comp_size;
+} BlendBlockEntry;
+
 /***/
 struct Main;
 void blo_join_main(ListBase *mainlist);
@@ -40,6 +40,8 @@
 #include "DNA_listBase.h"
 
 #include "BLI_blenlib.h"
+#include "BLI_ghash.h"
+#include "BLI_hash_mm2a.h"
 
 #include "BLO_undofile.h"
 
@@ -56,6 +58,7 @@ void BLO_free_memfile(MemFile *memfile)
 		MEM_freeN(chunk);
 	}
 	memfile->size = 0;
+	memfile->size_total = 0;
 }
 
 /* to keep list of memfiles consistent, 'first' is always first in list */
@@ -63,20 +66,28 @@ void BLO_free_memfile(MemFile *memfile)
 void BLO_merge_memfile(MemFile *first, MemFile *second)
 {
 	MemFileChunk *fc, *sc;
+	GHash *owned;
 	
-	fc = first->chunks.first;
-	sc = second->chunks.first;
-	while (fc || sc) {
-		if (fc && sc) {
-			if (sc->ident) {
+	/* chunks are shared by content, not by position, so look up which chunk of 'first' owns the buffer */
+	owned = BLI_ghash_ptr_new("BLO_merge_memfile owned");
+	for (fc = first->chunks.first; fc; fc = fc->next) {
+		if (fc->ident == 0) {
+			BLI_ghash_insert(owned, fc->buf, fc);
+		}
+	}
+	
+	/* buffers used by 'second' move over to it, the first chunk referencing one takes ownership */
+	for (sc = second->chunks.first; sc; sc = sc->next) {
+		if (sc->ident) {
+			fc = BLI_ghash_popkey(owned, sc->buf, NULL);
+			if (fc) {
 				sc->ident = 0;
 				fc->ident = 1;
 			}
 		}
-		if (fc) fc = fc->next;
-		if (sc) sc = sc->next;
 	}
 	
+	BLI_ghash_free(owned, NULL, NULL);
 	BLO_free_memfile(first);
 }
 
@@ -94,18 +105,56 @@ static int my_memcmp(const int *mem1, const int *mem2, const int len)
 	return 0;
 }
 
+static unsigned int memfilechunk_hash(const char *buf, unsigned int size)
+{
+	BLI_HashMurmur2A mm2;
+	
+	BLI_hash_mm2a_init(&mm2, size);
+	BLI_hash_mm2a_add(&mm2, (const unsigned char *)buf, size);
+	return BLI_hash_mm2a_end(&mm2);
+}
+
+static unsigned int memfilechunk_ghash_hash(const void *key)
+{
+	return ((const MemFileChunk *)key)->hash;
+}
+
+static bool memfilechunk_ghash_cmp(const void *a, const void *b)
+{
+	const MemFileChunk *chunk_a = a, *chunk_b = b;
+	
+	return (chunk_a->hash != chunk_b->hash || chunk_a->size != chunk_b->size ||
+	        memcmp(chunk_a->buf, chunk_b->buf, chunk_a->size) != 0);
+}
+
 void add_memfilechunk(MemFile *compare, MemFile *current, const char *buf, unsigned int size)
 {
 	static MemFileChunk *compchunk = NULL;
+	/* all chunks of the previous and the current step by content, for chunks which moved */
+	static GHash *chunkstore = NULL;
 	MemFileChunk *curchunk;
 	
 	/* this function inits when compare != NULL or when current == NULL  */
+	if (compare || current == NULL) {
+		if (chunkstore) {
+			BLI_ghash_free(chunkstore, NULL, NULL);
+			chunkstore = NULL;
+		}
+		compchunk = NULL;
+	}
 	if (compare) {
+		MemFileChunk *chunk;
+		
 		compchunk = compare->chunks.first;
+		chunkstore = BLI_ghash_new(memfilechunk_ghash_hash, memfilechunk_ghash_cmp, "add_memfilechunk chunkstore");
+		for (chunk = compare->chunks.first; chunk; chunk = chunk->next) {
+			if (!BLI_ghash_haskey(chunkstore, chunk)) {
+				BLI_ghash_insert(chunkstore, chunk, chunk);
+			}
+		}
 		return;
 	}
 	if (current == NULL) {
-		compchunk = NULL;
 		return;
 	}
 	
@@ -114,23 +163,46 @@ void add_memfilechunk(MemFile *compare, MemFile *current, const char *buf, unsig
 	curchunk->buf = NULL;
 	curchunk->ident = 0;
 	BLI_addtail(&current->chunks, curchunk);
+	current->size_total += size;
 	
-	/* we compare compchunk with buf */
+	/* we compare compchunk with buf, when nothing moved this finds the equal chunk without hashing */
 	if (compchunk) {
 		if (compchunk->size == curchunk->size) {
 			if (my_memcmp((int *)compchunk->buf, (const int *)buf, size / 4) == 0) {
 				curchunk->buf = compchunk->buf;
+				curchunk->hash = compchunk->hash;
 				curchunk->ident = 1;
 			}
 		}
 		compchunk = compchunk->next;
 	}
 	
+	/* otherwise look for an equal chunk anywhere in the previous step or earlier in this one */
+	if (curchunk->buf == NULL) {
+		MemFileChunk key, *found;
+		
+		key.buf = (char *)buf;
+		key.size = size;
+		key.hash = curchunk->hash = memfilechunk_hash(buf, size);
+		
+		if (chunkstore == NULL) {
+			chunkstore = BLI_ghash_new(memfilechunk_ghash_hash, memfilechunk_ghash_cmp, "add_memfilechunk chunkstore");
+		}
+		
+		found = BLI_ghash_lookup(chunkstore, &key);
+		if (found) {
+			curchunk->buf = found->buf;
+			curchunk->ident = 1;
+		}
+	}
+	
 	/* not equal... */
 	if (curchunk->buf == NULL) {
 		curchunk->buf = MEM_mallocN(size, "Chunk buffer");
 		memcpy(curchunk->buf, buf, size);
 		current->size += size;
+		
+		BLI_ghash_insert(chunkstore, curchunk, curchunk);
 	}
 }
 
@@ -144,6 +144,8 @@
 #include "BLI_blenlib.h"
 #include "BLI_linklist.h"
 #include "BLI_mempool.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
 
 #include "BKE_action.h"
 #include "BKE_blender.h"
@@ -177,6 +179,11 @@
 
 #include <errno.h>
 
+#ifdef WITH_LZO
+#include "minilzo.h"
+#define LZO_OUT_LEN(size)     ((size) + (size) / 16 + 64 + 3)
+#endif
+
 /* ********* my write, buffered writing with minimum size chunks ************ */
 
 #define MYWRITE_BUFFER_SIZE	100000
@@ -190,8 +197,11 @@
 typedef enum {
 	WW_WRAP_NONE = 1,
 	WW_WRAP_ZLIB,
+	WW_WRAP_LZO_BLOCKS,
 } eWriteWrapType;
 
+typedef struct BlockWriter BlockWriter;
+
 typedef struct WriteWrap WriteWrap;
 struct WriteWrap {
 	/* callbacks */
@@ -203,6 +213,7 @@ struct WriteWrap {
 	union {
 		int file_handle;
 		gzFile gz_handle;
+		BlockWriter *block_handle;
 	} _user_data;
 };
 
@@ -262,6 +273,174 @@ static size_t ww_write_zlib(WriteWrap *ww, const char *buf, size_t buf_len)
 }
 #undef FILE_HANDLE
 
+#ifdef WITH_LZO
+/* lzo blocks, the stream is cut into BLEND_BLOCK_SIZE blocks which get compressed a batch at a time
+ * on all threads, see readfile.h for the layout */
+#define FILE_HANDLE(ww) \
+	(ww)->_user_data.block_handle
+
+struct BlockWriter {
+	int file;
+	bool error;
+
+	/* the batch, tot_blocks blocks of uncompressed data and their compressed versions */
+	char *raw;
+	size_t raw_len;
+	unsigned char **comp;
+	uint32_t *comp_size;
+	int tot_blocks;
+
+	uint64_t offset;
+	BlendBlockEntry *index;
+	int index_len, index_size;
+};
+
+static void block_compress_task(void *userdata, int iter)
+{
+	BlockWriter *bw = userdata;
+	const unsigned char *in = (unsigned char *)bw->raw + (size_t)iter * BLEND_BLOCK_SIZE;
+	lzo_uint in_len = (lzo_uint)MIN2(bw->raw_len - (size_t)iter * BLEND_BLOCK_SIZE, BLEND_BLOCK_SIZE);
+	lzo_uint out_len = LZO_OUT_LEN(in_len);
+	void *wrkmem = MEM_mallocN(LZO1X_1_MEM_COMPRESS, "block_compress_task wrkmem");
+
+	if (lzo1x_1_compress(in, in_len, bw->comp[iter], &out_len, wrkmem) != LZO_E_OK || out_len >= in_len) {
+		/* store the block raw */
+		out_len = in_len;
+	}
+	bw->comp_size[iter] = (uint32_t)out_len;
+
+	MEM_freeN(wrkmem);
+}
+
+static bool block_write(BlockWriter *bw, const void *data, size_t len)
+{
+	if (!bw->error && write(bw->file, data, len) != (int)len) {
+		bw->error = true;
+	}
+	bw->offset += len;
+	return !bw->error;
+}
+
+static void block_flush(BlockWriter *bw)
+{
+	int i, tot = (int)((bw->raw_len + BLEND_BLOCK_SIZE - 1) / BLEND_BLOCK_SIZE);
+
+	if (tot == 0) {
+		return;
+	}
+
+	BLI_task_parallel_range(0, tot, bw, block_compress_task);
+
+	for (i = 0; i < tot; i++) {
+		BlendBlockInfo info;
+		BlendBlockEntry *entry;
+		const char *raw = bw->raw + (size_t)i * BLEND_BLOCK_SIZE;
+
+		info.raw_size = (uint32_t)MIN2(bw->raw_len - (size_t)i * BLEND_BLOCK_SIZE, BLEND_BLOCK_SIZE);
+		info.comp_size = bw->comp_size[i];
+
+		if (bw->index_len == bw->index_size) {
+			bw->index_size *= 2;
+			bw->index = MEM_reallocN(bw->index, sizeof(*bw->index) * bw->index_size);
+		}
+		entry = &bw->index[bw->index_len++];
+		entry->offset = bw->offset;
+		entry->raw_size = info.raw_size;
+		entry->comp_size = info.comp_size;
+
+		block_write(bw, &info, sizeof(info));
+		block_write(bw, (info.comp_size == info.raw_size) ? (const void *)raw : bw->comp[i], info.comp_size);
+	}
+
+	bw->raw_len = 0;
+}
+
+static bool ww_open_lzo_blocks(WriteWrap *ww, const char *filepath)
+{
+	BlockWriter *bw;
+	BlendBlockHeader header;
+	int file, i;
+
+	file = BLI_open(filepath, O_BINARY + O_WRONLY + O_CREAT + O_TRUNC, 0666);
+
+	if (file == -1) {
+		return false;
+	}
+
+	bw = MEM_callocN(sizeof(*bw), "BlockWriter");
+	bw->file = file;
+	/* enough blocks to keep all threads busy */
+	bw->tot_blocks = 2 * BLI_system_thread_count();
+	bw->raw = MEM_mallocN((size_t)bw->tot_blocks * BLEND_BLOCK_SIZE, "BlockWriter raw");
+	bw->comp = MEM_mallocN(sizeof(*bw->comp) * bw->tot_blocks, "BlockWriter comp");
+	bw->comp_size = MEM_mallocN(sizeof(*bw->comp_size) * bw->tot_blocks, "BlockWriter comp_size");
+	for (i = 0; i < bw->tot_blocks; i++) {
+		bw->comp[i] = MEM_mallocN(LZO_OUT_LEN(BLEND_BLOCK_SIZE), "BlockWriter comp block");
+	}
+	bw->index_size = 1024;
+	bw->index = MEM_mallocN(sizeof(*bw->index) * bw->index_size, "BlockWriter index");
+
+	memcpy(header.magic, BLEND_BLOCK_MAGIC, sizeof(header.magic));
+	header.codec = BLEND_BLOCK_CODEC_LZO;
+	header.block_size = BLEND_BLOCK_SIZE;
+	block_write(bw, &header, sizeof(header));
+
+	FILE_HANDLE(ww) = bw;
+	return true;
+}
+static bool ww_close_lzo_blocks(WriteWrap *ww)
+{
+	BlockWriter *bw = FILE_HANDLE(ww);
+	BlendBlockInfo end = {0, 0};
+	uint64_t index_offset, index_len;
+	bool ok;
+	int i;
+
+	block_flush(bw);
+	block_write(bw, &end, sizeof(end));
+
+	index_offset = bw->offset;
+	index_len = (uint64_t)bw->index_len;
+	block_write(bw, &index_len, sizeof(index_len));
+	block_write(bw, bw->index, sizeof(*bw->index) * bw->index_len);
+	block_write(bw, &index_offset, sizeof(index_offset));
+
+	ok = (close(bw->file) != -1) && !bw->error;
+
+	for (i = 0; i < bw->tot_blocks; i++) {
+		MEM_freeN(bw->comp[i]);
+	}
+	MEM_freeN(bw->comp);
+	MEM_freeN(bw->comp_size);
+	MEM_freeN(bw->raw);
+	MEM_freeN(bw->index);
+	MEM_freeN(bw);
+
+	return ok;
+}
+static size_t ww_write_lzo_blocks(WriteWrap *ww, const char *buf, size_t buf_len)
+{
+	BlockWriter *bw = FILE_HANDLE(ww);
+	const size_t batch_len = (size_t)bw->tot_blocks * BLEND_BLOCK_SIZE;
+	size_t done = 0;
+
+	while (done < buf_len) {
+		size_t len = MIN2(buf_len - done, batch_len - bw->raw_len);
+
+		memcpy(bw->raw + bw->raw_len, buf + done, len);
+		bw->raw_len += len;
+		done += len;
+
+		if (bw->raw_len == batch_len) {
+			block_flush(bw);
+		}
+	}
+
+	return bw->error ? 0 : buf_len;
+}
+#undef FILE_HANDLE
+#endif  /* WITH_LZO */
+
 /* --- end compression types --- */
 
 static void ww_handle_init(eWriteWrapType ww_type, WriteWrap *r_ww)
@@ -276,6 +455,15 @@ static void ww_handle_init(eWriteWrapType ww_type, WriteWrap *r_ww)
 			r_ww->write = ww_write_zlib;
 			break;
 		}
+#ifdef WITH_LZO
+		case WW_WRAP_LZO_BLOCKS:
+		{
+			r_ww->open  = ww_open_lzo_blocks;
+			r_ww->close = ww_close_lzo_blocks;
+			r_ww->write = ww_write_lzo_blocks;
+			break;
+		}
+#endif
 		default:
 		{
 			r_ww->open  = ww_open_none;
@@ -443,6 +631,11 @@ static int endwrite(WriteData *wd)
 		wd->count= 0;
 	}
 	
+	/* this ends comparing */
+	if (wd->current) {
+		add_memfilechunk(NULL, NULL, NULL, 0);
+	}
+	
 	err= wd->error;
 	writedata_free(wd);
 
@@ -3751,7 +3944,11 @@ int BLO_write_file(Main *mainvar, const char *filepath, int write_flags, ReportL
 	BLI_snprintf(tempname, sizeof(tempname), "%s@", filepath);
 
 	if (write_flags & G_FILE_COMPRESS) {
+#ifdef WITH_LZO
+		ww_type = (write_flags & G_FILE_COMPRESS_BLOCKS) ? WW_WRAP_LZO_BLOCKS : WW_WRAP_ZLIB;
+#else
 		ww_type = WW_WRAP_ZLIB;
+#endif
 	}
 	else {
 		ww_type = WW_WRAP_NONE;
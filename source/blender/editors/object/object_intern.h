@@ -178,6 +178,7 @@ void OBJECT_OT_meshdeform_bind(struct wmOperatorType *ot);
 void OBJECT_OT_explode_refresh(struct wmOperatorType *ot);
 void OBJECT_OT_ocean_bake(struct wmOperatorType *ot);
 void OBJECT_OT_fracture_refresh(struct wmOperatorType *ot);
+void OBJECT_OT_fracture_stream_export(struct wmOperatorType *ot);
 void OBJECT_OT_fracture_constraint_setting_add(wmOperatorType *ot);
 void OBJECT_OT_fracture_constraint_setting_remove(wmOperatorType *ot);
 void OBJECT_OT_rigidbody_constraints_refresh(struct wmOperatorType *ot);
@@ -2267,12 +2267,16 @@ typedef struct FractureJob {
 	int start, end;
 	struct Object *ob;
 	struct Scene *scene;
+	FractureBuffer *buffer; /* private fracture target in double buffered mode, else NULL */
 } FractureJob;
 
 
 static void fracture_free(void *customdata)
 {
 	FractureJob *fj = customdata;
+	if (fj->buffer) {
+		BKE_fracture_buffer_free(fj->buffer);
+	}
 	MEM_freeN(fj);
 }
 
@@ -2290,17 +2294,18 @@ static void fracture_update(void *customdata)
 
 	/*threaded fracture only in prefracture mode !*/
 	FractureState *fs = fj->ob->rigidbody_object->fracture_objects->states.first;
+	FracMesh *fm = fj->buffer ? BKE_fracture_buffer_fracmesh(fj->buffer) : fs->frac_mesh;
 
-	if (fs->frac_mesh == NULL)
+	if (fm == NULL)
 		(*fj->progress) = 0.0f;
 
-	if (fracture_breakjob(fj) && fs->frac_mesh)
-		fs->frac_mesh->cancel = 1;
+	if (fracture_breakjob(fj) && fm)
+		fm->cancel = 1;
 
 	/*(fj->do_update) = true;  useless here... because in wm_jobs.c its set to false again, preventing update*/
-	if (fs->frac_mesh)
+	if (fm)
 	{
-		progress = (float)(fs->frac_mesh->progress_counter) / (float)(fj->total_progress);
+		progress = (float)(fm->progress_counter) / (float)(fj->total_progress);
 		(*fj->progress) = progress;
 	}
 }
@@ -2327,8 +2332,12 @@ static void fracture_startjob(void *customdata, short *stop, short *do_update, f
 	//makeDerivedMesh(scene, ob, NULL, scene->customdata_mask | CD_MASK_BAREMESH, 0);
 	if (fc->fracture_mode == MOD_FRACTURE_PREFRACTURED)
 	{
-		//perhaps copy...
-		BKE_fracture_prefracture_mesh(scene, ob, 0);
+		if (fj->buffer) {
+			BKE_fracture_buffer_execute(scene, fj->buffer);
+		}
+		else {
+			BKE_fracture_prefracture_mesh(scene, ob, 0);
+		}
 	}
 }
 
@@ -2336,6 +2345,11 @@ static void fracture_endjob(void *customdata)
 {
 	FractureJob *fj = customdata;
 	Object *ob = fj->ob;
+
+	if (fj->buffer && BKE_fracture_buffer_swap(fj->scene, ob, fj->buffer)) {
+		BKE_rigidbody_cache_reset(fj->scene->rigidbody_world);
+	}
+
 	DAG_id_tag_update(&ob->id, OB_RECALC_DATA);
 }
 
@@ -2399,6 +2413,11 @@ static int fracture_refresh_exec(bContext *C, wmOperator *op)
 				fj->ob = selob;
 				fj->scene = scene;
 
+				if (fc->flag & FM_FLAG_EXECUTE_BUFFERED && fc->fracture_mode == MOD_FRACTURE_PREFRACTURED) {
+					/* the current result stays live, the job fractures into a private buffer */
+					fj->buffer = BKE_fracture_buffer_create(scene, selob);
+				}
+
 				/* if we have shards, totalprogress = shards + islands
 				 * if we dont have shards, then calculate number of processed halving steps
 				 * if we split island to shards, add both */
@@ -2490,6 +2509,86 @@ void OBJECT_OT_fracture_refresh(wmOperatorType *ot)
 	edit_modifier_properties(ot);
 }
 
+/****************** fracture stream export operator *********************/
+
+static int fracture_stream_export_poll(bContext *C)
+{
+	Object *ob = ED_object_active_context(C);
+
+	return (ob && ob->rigidbody_object && ob->rigidbody_object->fracture_objects &&
+	        ob->rigidbody_object->fracture_objects->current);
+}
+
+static int fracture_stream_export_exec(bContext *C, wmOperator *op)
+{
+	Main *bmain = CTX_data_main(C);
+	Scene *scene = CTX_data_scene(C);
+	Object *ob = ED_object_active_context(C);
+	char path[FILE_MAX];
+	int start = RNA_int_get(op->ptr, "frame_start");
+	int end = RNA_int_get(op->ptr, "frame_end");
+
+	RNA_string_get(op->ptr, "filepath", path);
+	BLI_path_abs(path, bmain->name);
+
+	if (end < start) {
+		BKE_report(op->reports, RPT_ERROR, "End frame must not be before the start frame");
+		return OPERATOR_CANCELLED;
+	}
+
+	WM_cursor_wait(1);
+	if (!BKE_fracture_stream_export(bmain, scene, ob, path, start, end)) {
+		WM_cursor_wait(0);
+		BKE_reportf(op->reports, RPT_ERROR, "Could not write fracture stream '%s'", path);
+		return OPERATOR_CANCELLED;
+	}
+	WM_cursor_wait(0);
+
+	WM_event_add_notifier(C, NC_SCENE | ND_FRAME, scene);
+	return OPERATOR_FINISHED;
+}
+
+static int fracture_stream_export_invoke(bContext *C, wmOperator *op, const wmEvent *UNUSED(event))
+{
+	Scene *scene = CTX_data_scene(C);
+	Object *ob = ED_object_active_context(C);
+	char path[FILE_MAX];
+
+	if (!RNA_struct_property_is_set(op->ptr, "frame_start"))
+		RNA_int_set(op->ptr, "frame_start", scene->r.sfra);
+	if (!RNA_struct_property_is_set(op->ptr, "frame_end"))
+		RNA_int_set(op->ptr, "frame_end", scene->r.efra);
+
+	if (RNA_struct_property_is_set(op->ptr, "filepath"))
+		return fracture_stream_export_exec(C, op);
+
+	BLI_snprintf(path, sizeof(path), "//%s.fmst", ob->id.name + 2);
+	RNA_string_set(op->ptr, "filepath", path);
+
+	WM_event_add_fileselect(C, op);
+
+	return OPERATOR_RUNNING_MODAL;
+}
+
+void OBJECT_OT_fracture_stream_export(wmOperatorType *ot)
+{
+	ot->name = "Export Fracture Stream";
+	ot->description = "Simulate the frame range and write the fracture result as a stream for the Fracture Stream modifier";
+	ot->idname = "OBJECT_OT_fracture_stream_export";
+
+	ot->poll = fracture_stream_export_poll;
+	ot->invoke = fracture_stream_export_invoke;
+	ot->exec = fracture_stream_export_exec;
+
+	/* flags */
+	ot->flag = OPTYPE_REGISTER;
+
+	WM_operator_properties_filesel(ot, FILE_TYPE_FOLDER, FILE_SPECIAL, FILE_SAVE,
+	                               WM_FILESEL_FILEPATH | WM_FILESEL_RELPATH, FILE_DEFAULTDISPLAY);
+	RNA_def_int(ot->srna, "frame_start", 1, MINFRAME, MAXFRAME, "Start Frame", "First frame to export", MINFRAME, MAXFRAME);
+	RNA_def_int(ot->srna, "frame_end", 250, MINFRAME, MAXFRAME, "End Frame", "Last frame to export", MINFRAME, MAXFRAME);
+}
+
 #if 0
 static void do_add_group_unchecked(Group* group, Object *ob, Base *bas)
 {
@@ -2601,6 +2700,7 @@ static Object* do_convert_meshisland_to_object(MeshIsland *mi, Scene* scene, Gro
 	me = (Mesh*)ob_new->data;
 	me->edit_btmesh = NULL;
 
+	BKE_fracture_physics_mesh_ensure(mi);
 	DM_to_mesh(mi->physics_mesh, me, ob_new, CD_MASK_MESH);
 
 	/*set origin to centroid*/
@@ -2710,6 +2810,7 @@ static Object* do_convert_meshIsland(FractureModifierData* fmd, MeshIsland *mi,
 	me = (Mesh*)ob_new->data;
 	me->edit_btmesh = NULL;
 
+	BKE_fracture_physics_mesh_ensure(mi);
 	DM_to_mesh(mi->physics_mesh, me, ob_new, CD_MASK_MESH);
 
 	ED_rigidbody_object_add(scene, ob_new, RBO_TYPE_ACTIVE, NULL);
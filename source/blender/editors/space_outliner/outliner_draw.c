@@ -1171,6 +1171,7 @@ static void tselem_draw_icon(uiBlock *block, int xmax, float x, float y, TreeSto
 					case eModifierType_NormalEdit:
 						UI_icon_draw(x, y, ICON_MOD_NORMALEDIT); break;
 					case eModifierType_Fracture:
+					case eModifierType_FractureStream:
 						UI_icon_draw(x, y, ICON_MOD_EXPLODE); break;
 					/* Default */
 					case eModifierType_None:
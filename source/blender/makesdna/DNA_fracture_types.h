@@ -92,6 +92,8 @@ typedef struct FracMesh {
 	short running;          /* whether the process is currently in progress, so the modifier wont be touched from the main thread */
 	int progress_counter;   /* counts progress */
 	int last_expected_shards;
+	int users;              /* runtime, fracture states sharing this shard map, copied on write */
+	char pad[4];
 } FracMesh;
 
 typedef struct FractureContainer {
@@ -115,6 +117,8 @@ typedef struct FractureContainer {
 	char ground_defgrp_name[64];  /* MAX_VGROUP_NAME */
 	char inner_defgrp_name[64];  /* MAX_VGROUP_NAME */
 
+	char disk_cache_dir[1024];   /* FILE_MAX, where to store prefracture results, empty uses the temp dir */
+
 	/*volatile storage*/
 	/* store original vertices here (coords), to find them later and reuse their normals, temporary data */
 	struct KDTree *nor_tree;
@@ -153,12 +157,21 @@ typedef struct FractureContainer {
 	int fracture_mode;
 	int cluster_count;
 
+	/* physics LOD, max number of vertices fed into each convex hull shape, 0 means use all */
+	int hull_vertex_limit;
+
+	/* k-means (Lloyd) iterations refining the count based clusters, 0 only assigns shards to the seeds */
+	int cluster_iterations;
+
 	/*flags*/
 	int flag;
 
 	/* internal values */
 	float max_vol;
 
+	/* runtime, object matrix the island vertices were last synced with */
+	float sync_obmat[4][4];
+
 } FractureContainer;
 
 typedef struct FractureState {
@@ -196,6 +209,8 @@ typedef struct ConstraintContainer {
 
 	char pad[4];
 
+	struct BLI_mempool *constraint_pool; /* runtime only, storage of the constraint_map items */
+
 } ConstraintContainer;
 
 typedef struct MeshIsland {
@@ -229,6 +244,8 @@ typedef struct MeshIsland {
 	int particle_index; /*used for clustering */
 	short partner_index; /* is 1 or 2, to determine the partner object*/
 	char pad[2];
+	float applied_pos[3], applied_orn[4]; /* runtime, transform of the last vertex update, zero orn forces one */
+	char pad2[4];
 } MeshIsland;
 
 /* Fracture Modifier */
@@ -248,6 +265,7 @@ enum {
 	MOD_FRACTURE_EXTRA_PARTICLES = (1 << 3),
 	MOD_FRACTURE_GREASEPENCIL    = (1 << 4),
 	MOD_FRACTURE_UNIFORM         = (1 << 5),
+	MOD_FRACTURE_POISSON         = (1 << 6),
 };
 
 enum {
@@ -297,6 +315,8 @@ enum {
 	FM_FLAG_USE_EXPERIMENTAL              = (1 << 17),
 	FM_FLAG_EXECUTE_THREADED              = (1 << 18),
 	FM_FLAG_UPDATE_AUTOHIDE               = (1 << 19),
+	FM_FLAG_USE_DISK_CACHE                = (1 << 20),
+	FM_FLAG_EXECUTE_BUFFERED              = (1 << 21),
 };
 
 /*constraint flags*/
@@ -84,6 +84,7 @@ typedef enum ModifierType {
 	eModifierType_Wireframe         = 48,
 	eModifierType_DataTransfer      = 49,
 	eModifierType_NormalEdit        = 50,
+	eModifierType_FractureStream    = 51,
 	eModifierType_Fracture          = (1 << 20),
 	NUM_MODIFIER_TYPES
 } ModifierType;
@@ -1502,6 +1503,18 @@ typedef struct FractureModifierData {
 
 } FractureModifierData ;
 
+/* plays back a fracture simulation exported with BKE_fracture_stream_export */
+typedef struct FractureStreamModifierData {
+	ModifierData modifier;
+
+	struct FractureStreamCache *cache;  /* runtime, file handle and decoded geometry of the last state */
+
+	int frame_offset;  /* subtracted from the scene frame before the lookup in the stream */
+	char pad[4];
+
+	char filepath[1024];  /* FILE_MAX */
+} FractureStreamModifierData;
+
 typedef struct DataTransferModifierData {
 	ModifierData modifier;
 
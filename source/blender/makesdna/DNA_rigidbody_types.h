@@ -58,7 +58,7 @@ typedef struct RigidBodyWorld {
 	
 	struct Group *constraints;	/* Group containing objects to use for Rigid Body Constraints*/
 
-	int pad;
+	int checkpoint_interval;	/* store full solver state every n frames, 0 = disabled */
 	float ltime;				/* last frame world was evaluated for (internal) */
 	
 	/* cache */
@@ -76,6 +76,7 @@ typedef struct RigidBodyWorld {
 	void *physics_world;		/* Physics sim world (i.e. btDiscreteDynamicsWorld) */
 	RigidBodyOb **cache_index_map DNA_DEPRECATED;		/* Maps the linear RigidbodyOb index to the nested Object(Modifier) Index, at runtime*/
 	int *cache_offset_map DNA_DEPRECATED;		/* Maps the linear RigidbodyOb index to the nested Object(Modifier) cell offset, at runtime, so it does not need to be calced in cache*/
+	ListBase checkpoints;		/* solver state checkpoints, to resume outdated simulations from, at runtime only */
 	//char pad2[4];
 } RigidBodyWorld;
 
@@ -314,6 +314,16 @@ static void rna_def_cloth_solver_result(BlenderRNA *brna)
 	RNA_def_property_clear_flag(prop, PROP_EDITABLE);
 	RNA_def_property_ui_text(prop, "Average Iterations", "Average iterations during substeps");
 	
+	prop = RNA_def_property(srna, "force_time", PROP_FLOAT, PROP_NONE);
+	RNA_def_property_float_sdna(prop, NULL, "force_time");
+	RNA_def_property_clear_flag(prop, PROP_EDITABLE);
+	RNA_def_property_ui_text(prop, "Force Time", "Seconds spent calculating forces and jacobians during substeps");
+	
+	prop = RNA_def_property(srna, "solve_time", PROP_FLOAT, PROP_NONE);
+	RNA_def_property_float_sdna(prop, NULL, "solve_time");
+	RNA_def_property_clear_flag(prop, PROP_EDITABLE);
+	RNA_def_property_ui_text(prop, "Solve Time", "Seconds spent solving the implicit system during substeps");
+	
 	RNA_define_verify_sdna(1);
 }
 
@@ -115,6 +115,7 @@ EnumPropertyItem modifier_type_items[] = {
 	{eModifierType_Explode, "EXPLODE", ICON_MOD_EXPLODE, "Explode", ""},
 	{eModifierType_Fluidsim, "FLUID_SIMULATION", ICON_MOD_FLUIDSIM, "Fluid Simulation", ""},
 	{eModifierType_Fracture, "FRACTURE", ICON_MOD_EXPLODE, "Fracture", ""},
+	{eModifierType_FractureStream, "FRACTURE_STREAM", ICON_MOD_EXPLODE, "Fracture Stream", ""},
 	{eModifierType_Ocean, "OCEAN", ICON_MOD_OCEAN, "Ocean", ""},
 	{eModifierType_ParticleInstance, "PARTICLE_INSTANCE", ICON_MOD_PARTICLES, "Particle Instance", ""},
 	{eModifierType_ParticleSystem, "PARTICLE_SYSTEM", ICON_MOD_PARTICLES, "Particle System", ""},
@@ -386,6 +387,8 @@ static StructRNA *rna_Modifier_refine(struct PointerRNA *ptr)
 			return &RNA_NormalEditModifier;
 		case eModifierType_Fracture:
 			return &RNA_FractureModifier;
+		case eModifierType_FractureStream:
+			return &RNA_FractureStreamModifier;
 		/* Default */
 		case eModifierType_None:
 		case eModifierType_ShapeKey:
@@ -4459,6 +4462,27 @@ static void rna_def_modifier_fracture(BlenderRNA *brna)
 	RNA_def_struct_ui_icon(srna, ICON_MOD_EXPLODE);
 }
 
+static void rna_def_modifier_fracture_stream(BlenderRNA *brna)
+{
+	StructRNA *srna;
+	PropertyRNA *prop;
+
+	srna = RNA_def_struct(brna, "FractureStreamModifier", "Modifier");
+	RNA_def_struct_ui_text(srna, "Fracture Stream Modifier", "Play back an exported fracture simulation stream");
+	RNA_def_struct_sdna(srna, "FractureStreamModifierData");
+	RNA_def_struct_ui_icon(srna, ICON_MOD_EXPLODE);
+
+	prop = RNA_def_property(srna, "filepath", PROP_STRING, PROP_FILEPATH);
+	RNA_def_property_ui_text(prop, "File Path", "Path to the fracture stream file");
+	RNA_def_property_update(prop, 0, "rna_Modifier_update");
+
+	prop = RNA_def_property(srna, "frame_offset", PROP_INT, PROP_TIME);
+	RNA_def_property_int_sdna(prop, NULL, "frame_offset");
+	RNA_def_property_range(prop, MINAFRAME, MAXFRAME);
+	RNA_def_property_ui_text(prop, "Frame Offset", "Subtract this from the scene frame before looking up the stream");
+	RNA_def_property_update(prop, 0, "rna_Modifier_update");
+}
+
 void RNA_def_modifier(BlenderRNA *brna)
 {
 	StructRNA *srna;
@@ -4575,6 +4599,7 @@ void RNA_def_modifier(BlenderRNA *brna)
 	rna_def_modifier_datatransfer(brna);
 	rna_def_modifier_normaledit(brna);
 	rna_def_modifier_fracture(brna);
+	rna_def_modifier_fracture_stream(brna);
 }
 
 #endif
@@ -93,9 +93,14 @@ static EnumPropertyItem rigidbody_mesh_source_items[] = {
 #  include "RBI_api.h"
 #endif
 
+#include "BKE_DerivedMesh.h"
 #include "BKE_depsgraph.h"
+#include "BKE_mesh.h"
 #include "BKE_rigidbody.h"
 #include "BKE_fracture.h"
+#include "BKE_report.h"
+
+#include "DNA_mesh_types.h"
 
 #include "WM_api.h"
 
@@ -188,6 +193,14 @@ static void fracture_container_reset(FractureContainer *fc, RigidBodyWorld *rbw)
 	BKE_rigidbody_cache_reset(rbw);
 }
 
+static void rna_RigidBodyWorld_checkpoint_update(Main *UNUSED(bmain), Scene *UNUSED(scene), PointerRNA *ptr)
+{
+	RigidBodyWorld *rbw = (RigidBodyWorld *)ptr->data;
+
+	/* existing checkpoints don't match the new interval anymore */
+	BKE_rigidbody_free_checkpoints(rbw);
+}
+
 static void rna_FractureContainer_reset(Main *UNUSED(bmain), Scene *scene, PointerRNA *ptr)
 {
 	RigidBodyWorld *rbw = scene->rigidbody_world;
@@ -256,6 +269,18 @@ static void rna_RigidBodyOb_shape_reset(Main *UNUSED(bmain), Scene *scene, Point
 	BKE_rigidbody_cache_reset(rbw);
 }
 
+static void rna_FractureContainer_shape_update(Main *UNUSED(bmain), Scene *scene, PointerRNA *ptr)
+{
+	RigidBodyWorld *rbw = scene->rigidbody_world;
+	Object *ob = ptr->id.data;
+
+	if (ob && ob->rigidbody_object) {
+		ob->rigidbody_object->flag |= RBO_FLAG_NEEDS_RESHAPE;
+	}
+
+	BKE_rigidbody_cache_reset(rbw);
+}
+
 static void rna_FractureContainer_autohide_update(Main *UNUSED(bmain), Scene *scene, PointerRNA *ptr)
 {
 	FractureContainer *fc = ptr->data;
@@ -270,6 +295,53 @@ static char *rna_FractureContainer_path(PointerRNA *UNUSED(ptr))
 	return BLI_sprintfN("rigidbody_object.fracture_container");
 }
 
+static void rna_FractureContainer_mesh_islands_begin(CollectionPropertyIterator *iter, PointerRNA *ptr)
+{
+	FractureContainer *fc = ptr->data;
+
+	rna_iterator_listbase_begin(iter, fc->current ? &fc->current->island_map : NULL, NULL);
+}
+
+static void rna_FractureMeshIsland_matrix_world_get(PointerRNA *ptr, float values[16])
+{
+	Object *ob = ptr->id.data;
+	MeshIsland *mi = ptr->data;
+
+	if (ob && ob->rigidbody_object && ob->rigidbody_object->fracture_objects) {
+		BKE_fracture_island_matrix_world(ob, mi, (float (*)[4])values);
+	}
+	else {
+		unit_m4((float (*)[4])values);
+	}
+}
+
+static Mesh *rna_FractureMeshIsland_to_mesh(ID *id, MeshIsland *mi, Main *bmain, ReportList *reports)
+{
+	Object *ob = (Object *)id;
+	DerivedMesh *dm = NULL;
+	Mesh *me;
+
+	if (ob->rigidbody_object && ob->rigidbody_object->fracture_objects) {
+		dm = BKE_fracture_island_create_dm(ob, mi);
+	}
+
+	if (dm == NULL) {
+		BKE_report(reports, RPT_ERROR, "Mesh island has no shard geometry");
+		return NULL;
+	}
+
+	me = BKE_mesh_add(bmain, "Shard");
+	DM_to_mesh(dm, me, ob, CD_MASK_MESH);
+	dm->release(dm);
+
+	/* BKE_mesh_add gives us a user count we don't need */
+	me->id.us--;
+
+	BKE_mesh_tessface_ensure(me);
+
+	return me;
+}
+
 static char *rna_ConstraintContainer_path(PointerRNA *UNUSED(ptr))
 {
 	/* NOTE: this hardcoded path should work as long as only Objects have this */
@@ -406,6 +478,15 @@ static void rna_def_rigidbody_world(BlenderRNA *brna)
 	                         "stability a little so use only when necessary)");
 	RNA_def_property_update(prop, NC_SCENE, "rna_RigidBodyWorld_reset");
 
+	prop = RNA_def_property(srna, "checkpoint_interval", PROP_INT, PROP_NONE);
+	RNA_def_property_int_sdna(prop, NULL, "checkpoint_interval");
+	RNA_def_property_range(prop, 0, 10000);
+	RNA_def_property_ui_range(prop, 0, 100, 1, 0);
+	RNA_def_property_ui_text(prop, "Checkpoint Interval",
+	                         "Store the full solver state every n frames, so an outdated simulation resumes from the "
+	                         "last checkpoint before the current frame instead of the start frame (0 = disabled)");
+	RNA_def_property_update(prop, NC_SCENE, "rna_RigidBodyWorld_checkpoint_update");
+
 	/* cache */
 	prop = RNA_def_property(srna, "point_cache", PROP_POINTER, PROP_NONE);
 	RNA_def_property_flag(prop, PROP_NEVER_NULL);
@@ -1107,6 +1188,7 @@ static void rna_def_rigidbody_fracture_container(BlenderRNA *brna)
 		{MOD_FRACTURE_EXTRA_VERTS, "EXTRA_VERTS", 0, "Extra Vertices", "Use vertices of group objects as point cloud"},
 		{MOD_FRACTURE_GREASEPENCIL, "GREASE_PENCIL", 0, "Grease Pencil", "Use grease pencil points as point cloud"},
 		{MOD_FRACTURE_UNIFORM, "UNIFORM", 0, "Uniform", "Use a random uniform pointcloud generated over the bounding box"},
+		{MOD_FRACTURE_POISSON, "POISSON", 0, "Poisson Disk", "Use an evenly spaced (poisson disk) pointcloud generated over the bounding box"},
 		{0, NULL, 0, NULL, NULL}
 	};
 
@@ -1129,6 +1211,13 @@ static void rna_def_rigidbody_fracture_container(BlenderRNA *brna)
 	RNA_def_struct_sdna(srna, "FractureContainer");
 	RNA_def_struct_path_func(srna, "rna_FractureContainer_path");
 
+	prop = RNA_def_property(srna, "mesh_islands", PROP_COLLECTION, PROP_NONE);
+	RNA_def_property_struct_type(prop, "FractureMeshIsland");
+	RNA_def_property_collection_funcs(prop, "rna_FractureContainer_mesh_islands_begin", "rna_iterator_listbase_next",
+	                                  "rna_iterator_listbase_end", "rna_iterator_listbase_get",
+	                                  NULL, NULL, NULL, NULL);
+	RNA_def_property_ui_text(prop, "Mesh Islands", "Mesh islands of the current fracture state");
+
 	prop = RNA_def_property(srna, "use_experimental", PROP_BOOLEAN, PROP_NONE);
 	RNA_def_property_boolean_sdna(prop, NULL, "flag", FM_FLAG_USE_EXPERIMENTAL);
 	RNA_def_property_ui_text(prop, "Use Experimental", "Experimental features, work in progress. Use at own risk!");
@@ -1147,6 +1236,24 @@ static void rna_def_rigidbody_fracture_container(BlenderRNA *brna)
 	RNA_def_property_clear_flag(prop, PROP_ANIMATABLE);
 	RNA_def_property_update(prop, NC_OBJECT | ND_POINTCACHE, "rna_FractureContainer_reset");
 
+	prop = RNA_def_property(srna, "execute_buffered", PROP_BOOLEAN, PROP_NONE);
+	RNA_def_property_boolean_sdna(prop, NULL, "flag", FM_FLAG_EXECUTE_BUFFERED);
+	RNA_def_property_ui_text(prop, "Keep Old Result",
+	                         "Fracture into a separate buffer in the threaded job, the previous result stays usable until the job is done");
+	RNA_def_property_clear_flag(prop, PROP_ANIMATABLE);
+
+	prop = RNA_def_property(srna, "use_disk_cache", PROP_BOOLEAN, PROP_NONE);
+	RNA_def_property_boolean_sdna(prop, NULL, "flag", FM_FLAG_USE_DISK_CACHE);
+	RNA_def_property_ui_text(prop, "Use Disk Cache",
+	                         "Store prefracture results on disk and load them again when fracturing with identical input");
+	RNA_def_property_clear_flag(prop, PROP_ANIMATABLE);
+
+	prop = RNA_def_property(srna, "disk_cache_dir", PROP_STRING, PROP_DIRPATH);
+	RNA_def_property_string_sdna(prop, NULL, "disk_cache_dir");
+	RNA_def_property_ui_text(prop, "Disk Cache Directory",
+	                         "Directory for the fracture disk cache, leave empty to use the temporary directory");
+	RNA_def_property_clear_flag(prop, PROP_ANIMATABLE);
+
 	prop = RNA_def_property(srna, "fracture_mode", PROP_ENUM, PROP_NONE);
 	RNA_def_property_enum_items(prop, prop_fracture_modes);
 	RNA_def_property_enum_default(prop, MOD_FRACTURE_PREFRACTURED);
@@ -1173,6 +1280,15 @@ static void rna_def_rigidbody_fracture_container(BlenderRNA *brna)
 	RNA_def_property_clear_flag(prop, PROP_ANIMATABLE);
 	RNA_def_property_update(prop, NC_OBJECT | ND_POINTCACHE, "rna_FractureContainer_reset");
 
+	prop = RNA_def_property(srna, "cluster_iterations", PROP_INT, PROP_NONE);
+	RNA_def_property_range(prop, 0, 1000);
+	RNA_def_property_ui_range(prop, 0, 50, 1, -1);
+	RNA_def_property_int_default(prop, 5);
+	RNA_def_property_ui_text(prop, "Cluster Iterations",
+	                         "K-means iterations to even out the clusters, 0 assigns shards to the initial seeds only");
+	RNA_def_property_clear_flag(prop, PROP_ANIMATABLE);
+	RNA_def_property_update(prop, NC_OBJECT | ND_POINTCACHE, "rna_FractureContainer_reset");
+
 	prop = RNA_def_property(srna, "point_source", PROP_ENUM, PROP_NONE);
 	RNA_def_property_enum_items(prop, prop_point_source_items);
 	RNA_def_property_flag(prop, PROP_ENUM_FLAG);
@@ -1267,6 +1383,14 @@ static void rna_def_rigidbody_fracture_container(BlenderRNA *brna)
 	RNA_def_property_clear_flag(prop, PROP_ANIMATABLE);
 	RNA_def_property_update(prop, NC_OBJECT | ND_POINTCACHE, "rna_FractureContainer_reset");
 
+	prop = RNA_def_property(srna, "hull_vertex_limit", PROP_INT, PROP_NONE);
+	RNA_def_property_range(prop, 0, 100000);
+	RNA_def_property_ui_range(prop, 0, 256, 1, -1);
+	RNA_def_property_ui_text(prop, "Hull Vertex Limit",
+	                         "Maximum number of vertices used for each convex hull collision shape, 0 uses all shard vertices");
+	RNA_def_property_clear_flag(prop, PROP_ANIMATABLE);
+	RNA_def_property_update(prop, NC_OBJECT | ND_POINTCACHE, "rna_FractureContainer_shape_update");
+
 	prop = RNA_def_property(srna, "use_smooth", PROP_BOOLEAN, PROP_NONE);
 	RNA_def_property_boolean_sdna(prop, NULL, "flag", FM_FLAG_USE_SMOOTH);
 	RNA_def_property_ui_text(prop, "Smooth Inner Faces", "Set Inner Faces to Smooth Shading (needs refracture)");
@@ -1337,9 +1461,50 @@ static void rna_def_rigidbody_fracture_container(BlenderRNA *brna)
 
 }
 
+static void rna_def_rigidbody_mesh_island(BlenderRNA *brna)
+{
+	StructRNA *srna;
+	PropertyRNA *prop;
+	FunctionRNA *func;
+	PropertyRNA *parm;
+
+	srna = RNA_def_struct(brna, "FractureMeshIsland", NULL);
+	RNA_def_struct_sdna(srna, "MeshIsland");
+	RNA_def_struct_ui_text(srna, "Fracture Mesh Island", "Rigidly moving part of a fractured object");
+
+	prop = RNA_def_property(srna, "id", PROP_INT, PROP_NONE);
+	RNA_def_property_int_sdna(prop, NULL, "id");
+	RNA_def_property_clear_flag(prop, PROP_EDITABLE);
+	RNA_def_property_ui_text(prop, "ID", "Identifier of the mesh island");
+
+	prop = RNA_def_property(srna, "vertex_count", PROP_INT, PROP_NONE);
+	RNA_def_property_int_sdna(prop, NULL, "vertex_count");
+	RNA_def_property_clear_flag(prop, PROP_EDITABLE);
+	RNA_def_property_ui_text(prop, "Vertex Count", "Number of vertices of the island geometry");
+
+	prop = RNA_def_property(srna, "centroid", PROP_FLOAT, PROP_TRANSLATION);
+	RNA_def_property_float_sdna(prop, NULL, "centroid");
+	RNA_def_property_clear_flag(prop, PROP_EDITABLE);
+	RNA_def_property_ui_text(prop, "Centroid", "Rest position of the island center in object space");
+
+	prop = RNA_def_property(srna, "matrix_world", PROP_FLOAT, PROP_MATRIX);
+	RNA_def_property_multi_array(prop, 2, rna_matrix_dimsize_4x4);
+	RNA_def_property_clear_flag(prop, PROP_EDITABLE);
+	RNA_def_property_float_funcs(prop, "rna_FractureMeshIsland_matrix_world_get", NULL, NULL);
+	RNA_def_property_ui_text(prop, "World Matrix", "Current world transformation of the island geometry");
+
+	func = RNA_def_function(srna, "to_mesh", "rna_FractureMeshIsland_to_mesh");
+	RNA_def_function_ui_description(func, "Create a Mesh datablock from the island geometry, centered at the island centroid");
+	RNA_def_function_flag(func, FUNC_USE_SELF_ID | FUNC_USE_MAIN | FUNC_USE_REPORTS);
+	parm = RNA_def_pointer(func, "mesh", "Mesh", "",
+	                       "Mesh created from the island, remove it if it is only used for export");
+	RNA_def_function_return(func, parm);
+}
+
 void RNA_def_rigidbody(BlenderRNA *brna)
 {
 	rna_def_rigidbody_world(brna);
+	rna_def_rigidbody_mesh_island(brna);
 	rna_def_rigidbody_fracture_container(brna);
 	rna_def_rigidbody_constraint_container(brna);
 	rna_def_rigidbody_object(brna);
@@ -304,6 +304,13 @@ static void rna_def_smoke_domain_settings(BlenderRNA *brna)
 		{0, NULL, 0, NULL, NULL}
 	};
 
+	static EnumPropertyItem smoke_pressure_solver_items[] = {
+		{SM_PRESSURE_PCG, "PCG", 0, "Jacobi PCG", "Conjugate gradient with a diagonal preconditioner"},
+		{SM_PRESSURE_MGPCG, "MGPCG", 0, "Multigrid PCG",
+		 "Conjugate gradient with a multigrid preconditioner, converges in far fewer iterations on large domains"},
+		{0, NULL, 0, NULL, NULL}
+	};
+
 	srna = RNA_def_struct(brna, "SmokeDomainSettings", NULL);
 	RNA_def_struct_ui_text(srna, "Domain Settings", "Smoke domain settings");
 	RNA_def_struct_sdna(srna, "SmokeDomainSettings");
@@ -421,6 +428,12 @@ static void rna_def_smoke_domain_settings(BlenderRNA *brna)
 	                         "Select which domain border will be treated as collision object");
 	RNA_def_property_update(prop, NC_OBJECT | ND_MODIFIER, "rna_Smoke_reset");
 
+	prop = RNA_def_property(srna, "pressure_solver", PROP_ENUM, PROP_NONE);
+	RNA_def_property_enum_sdna(prop, NULL, "pressure_solver");
+	RNA_def_property_enum_items(prop, smoke_pressure_solver_items);
+	RNA_def_property_ui_text(prop, "Pressure Solver", "Linear solver used to make the velocity field divergence free");
+	RNA_def_property_update(prop, NC_OBJECT | ND_MODIFIER, "rna_Smoke_resetCache");
+
 	prop = RNA_def_property(srna, "effector_weights", PROP_POINTER, PROP_NONE);
 	RNA_def_property_struct_type(prop, "EffectorWeights");
 	RNA_def_property_clear_flag(prop, PROP_EDITABLE);
@@ -84,6 +84,7 @@ extern ModifierTypeInfo modifierType_Wireframe;
 extern ModifierTypeInfo modifierType_DataTransfer;
 extern ModifierTypeInfo modifierType_NormalEdit;
 extern ModifierTypeInfo modifierType_Fracture;
+extern ModifierTypeInfo modifierType_FractureStream;
 
 /* MOD_util.c */
 void modifier_type_init(ModifierTypeInfo *types[]);
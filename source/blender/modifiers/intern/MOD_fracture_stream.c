@@ -0,0 +1,151 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Contributor(s): Martin Felke
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ */
+
+/** \file blender/modifiers/intern/MOD_fracture_stream.c
+ *  \ingroup modifiers
+ *
+ * Plays back a fracture simulation exported with BKE_fracture_stream_export,
+ * so render nodes do not need to fracture or simulate anything themselves.
+ */
+
+#include <stdio.h>
+
+#include "DNA_scene_types.h"
+#include "DNA_object_types.h"
+
+#include "BLI_utildefines.h"
+#include "BLI_string.h"
+#include "BLI_path_util.h"
+
+#include "BKE_DerivedMesh.h"
+#include "BKE_fracture.h"
+#include "BKE_global.h"
+#include "BKE_main.h"
+#include "BKE_scene.h"
+
+#include "MOD_modifiertypes.h"
+
+static void initData(ModifierData *md)
+{
+	FractureStreamModifierData *fsmd = (FractureStreamModifierData *)md;
+
+	fsmd->frame_offset = 0;
+	fsmd->filepath[0] = '\0';
+	fsmd->cache = NULL;
+}
+
+static void copyData(ModifierData *md, ModifierData *target)
+{
+	FractureStreamModifierData *tfsmd = (FractureStreamModifierData *)target;
+
+	modifier_copyData_generic(md, target);
+
+	/* the copy opens the file on its own */
+	tfsmd->cache = NULL;
+}
+
+static void freeData(ModifierData *md)
+{
+	FractureStreamModifierData *fsmd = (FractureStreamModifierData *)md;
+
+	BKE_fracture_stream_cache_free(fsmd->cache);
+	fsmd->cache = NULL;
+}
+
+static bool dependsOnTime(ModifierData *UNUSED(md))
+{
+	return true;
+}
+
+static bool isDisabled(ModifierData *md, int UNUSED(useRenderParams))
+{
+	FractureStreamModifierData *fsmd = (FractureStreamModifierData *) md;
+
+	/* leave it up to the modifier to check the file is valid on calculation */
+	return (fsmd->filepath[0] == '\0');
+}
+
+static DerivedMesh *applyModifier(ModifierData *md, Object *ob,
+                                  DerivedMesh *derivedData,
+                                  ModifierApplyFlag UNUSED(flag))
+{
+	FractureStreamModifierData *fsmd = (FractureStreamModifierData *)md;
+	Scene *scene = md->scene;
+	DerivedMesh *result;
+	const char *err_str = NULL;
+	char filepath[FILE_MAX];
+	int frame;
+
+	if (scene == NULL) {
+		return derivedData;
+	}
+
+	frame = scene->r.cfra - fsmd->frame_offset;
+
+	/* the stream is seekable, per frame only one frame record is read, the state geometry
+	 * stays decoded in the cache until the stream switches to another state */
+	BLI_strncpy(filepath, fsmd->filepath, sizeof(filepath));
+	BLI_path_abs(filepath, ID_BLEND_PATH(G.main, (ID *)ob));
+
+	result = BKE_fracture_stream_read(filepath, frame, &fsmd->cache, &err_str);
+
+	if (UNLIKELY(err_str)) {
+		modifier_setError(md, "%s", err_str);
+	}
+
+	return result ? result : derivedData;
+}
+
+static DerivedMesh *applyModifierEM(ModifierData *md, Object *ob,
+                                    struct BMEditMesh *UNUSED(editData),
+                                    DerivedMesh *derivedData,
+                                    ModifierApplyFlag flag)
+{
+	return applyModifier(md, ob, derivedData, flag);
+}
+
+ModifierTypeInfo modifierType_FractureStream = {
+	/* name */              "Fracture Stream",
+	/* structName */        "FractureStreamModifierData",
+	/* structSize */        sizeof(FractureStreamModifierData),
+	/* type */              eModifierTypeType_Constructive,
+	/* flags */             eModifierTypeFlag_AcceptsMesh |
+	                        eModifierTypeFlag_SupportsEditmode,
+
+	/* copyData */          copyData,
+	/* deformVerts */       NULL,
+	/* deformMatrices */    NULL,
+	/* deformVertsEM */     NULL,
+	/* deformMatricesEM */  NULL,
+	/* applyModifier */     applyModifier,
+	/* applyModifierEM */   applyModifierEM,
+	/* initData */          initData,
+	/* requiredDataMask */  NULL,
+	/* freeData */          freeData,
+	/* isDisabled */        isDisabled,
+	/* updateDepgraph */    NULL,
+	/* dependsOnTime */     dependsOnTime,
+	/* dependsOnNormals */  NULL,
+	/* foreachObjectLink */ NULL,
+	/* foreachIDLink */     NULL,
+	/* foreachTexLink */    NULL,
+};
@@ -307,5 +307,6 @@ void modifier_type_init(ModifierTypeInfo *types[])
 	INIT_TYPE(DataTransfer);
 	INIT_TYPE(NormalEdit);
 	INIT_TYPE(Fracture);
+	INIT_TYPE(FractureStream);
 #undef INIT_TYPE
 }
@@ -41,11 +41,14 @@ extern "C" {
 
 #include "BLI_math.h"
 #include "BLI_linklist.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 
 #include "BKE_cloth.h"
 #include "BKE_collision.h"
 #include "BKE_effect.h"
+
+#include "PIL_time.h"
 }
 
 #include "BPH_mass_spring.h"
@@ -333,7 +336,10 @@ static int UNUSED_FUNCTION(cloth_calc_helper_forces)(Object *UNUSED(ob), ClothMo
 	return 1;
 }
 
-BLI_INLINE void cloth_calc_spring_force(ClothModifierData *clmd, ClothSpring *s, float time)
+/* Evaluates a spring without changing the solver system, so springs can be processed in parallel.
+ * Angular bending springs are handled by cloth_calc_spring_force_angular.
+ */
+BLI_INLINE void cloth_calc_spring_force(ClothModifierData *clmd, ClothSpring *s, float time, ImplicitSpringForce *r_force)
 {
 	Cloth *cloth = clmd->clothObject;
 	ClothSimSettings *parms = clmd->sim_parms;
@@ -348,6 +354,10 @@ BLI_INLINE void cloth_calc_spring_force(ClothModifierData *clmd, ClothSpring *s,
 	
 	s->flags &= ~CLOTH_SPRING_FLAG_NEEDED;
 	
+	r_force->i = s->ij;
+	r_force->j = s->kl;
+	r_force->active = false;
+	
 	// calculate force of structural + shear springs
 	if ((s->type & CLOTH_SPRING_TYPE_STRUCTURAL) || (s->type & CLOTH_SPRING_TYPE_SHEAR) || (s->type & CLOTH_SPRING_TYPE_SEWING) ) {
 #ifdef CLOTH_FORCE_SPRING_STRUCTURAL
@@ -361,10 +371,10 @@ BLI_INLINE void cloth_calc_spring_force(ClothModifierData *clmd, ClothSpring *s,
 		if (s->type & CLOTH_SPRING_TYPE_SEWING) {
 			// TODO: verify, half verified (couldn't see error)
 			// sewing springs usually have a large distance at first so clamp the force so we don't get tunnelling through colission objects
-			BPH_mass_spring_force_spring_linear(data, s->ij, s->kl, s->restlen, k, parms->Cdis, no_compress, parms->max_sewing, s->f, s->dfdx, s->dfdv);
+			r_force->active = BPH_mass_spring_eval_spring_linear(data, s->ij, s->kl, s->restlen, k, parms->Cdis, no_compress, parms->max_sewing, s->f, s->dfdx, s->dfdv);
 		}
 		else {
-			BPH_mass_spring_force_spring_linear(data, s->ij, s->kl, s->restlen, k, parms->Cdis, no_compress, 0.0f, s->f, s->dfdx, s->dfdv);
+			r_force->active = BPH_mass_spring_eval_spring_linear(data, s->ij, s->kl, s->restlen, k, parms->Cdis, no_compress, 0.0f, s->f, s->dfdx, s->dfdv);
 		}
 #endif
 	}
@@ -382,7 +392,9 @@ BLI_INLINE void cloth_calc_spring_force(ClothModifierData *clmd, ClothSpring *s,
 		scaling = parms->goalspring + s->stiffness * fabsf(parms->max_struct - parms->goalspring);
 		k = verts[s->ij].goal * scaling / (parms->avg_spring_len + FLT_EPSILON);
 		
-		BPH_mass_spring_force_spring_goal(data, s->ij, goal_x, goal_v, k, parms->goalfrict * 0.01f, s->f, s->dfdx, s->dfdv);
+		/* goal springs only act on their own vertex */
+		r_force->j = -1;
+		r_force->active = BPH_mass_spring_eval_spring_goal(data, s->ij, goal_x, goal_v, k, parms->goalfrict * 0.01f, s->f, s->dfdx, s->dfdv);
 #endif
 	}
 	else if (s->type & CLOTH_SPRING_TYPE_BENDING) {  /* calculate force of bending springs */
@@ -397,47 +409,126 @@ BLI_INLINE void cloth_calc_spring_force(ClothModifierData *clmd, ClothSpring *s,
 		scaling = parms->bending_damping;
 		cb = scaling / (20.0f * (parms->avg_spring_len + FLT_EPSILON));
 		
-		BPH_mass_spring_force_spring_bending(data, s->ij, s->kl, s->restlen, kb, cb, s->f, s->dfdx, s->dfdv);
+		r_force->active = BPH_mass_spring_eval_spring_bending(data, s->ij, s->kl, s->restlen, kb, cb, s->f, s->dfdx, s->dfdv);
 #endif
 	}
-	else if (s->type & CLOTH_SPRING_TYPE_BENDING_ANG) {
+	
+	if (r_force->active) {
+		copy_v3_v3(r_force->f, s->f);
+		copy_m3_m3(r_force->dfdx, s->dfdx);
+		copy_m3_m3(r_force->dfdv, s->dfdv);
+	}
+}
+
+/* Angular bending springs couple three vertices and are added to the system directly */
+BLI_INLINE void cloth_calc_spring_force_angular(ClothModifierData *clmd, ClothSpring *s)
+{
+	Cloth *cloth = clmd->clothObject;
+	ClothSimSettings *parms = clmd->sim_parms;
+	Implicit_Data *data = cloth->implicit;
+	
+	zero_v3(s->f);
+	zero_m3(s->dfdx);
+	zero_m3(s->dfdv);
+	
+	s->flags &= ~CLOTH_SPRING_FLAG_NEEDED;
+	
 #ifdef CLOTH_FORCE_SPRING_BEND
-		float kb, cb, scaling;
-		
-		s->flags |= CLOTH_SPRING_FLAG_NEEDED;
+	float kb, cb, scaling;
+	
+	s->flags |= CLOTH_SPRING_FLAG_NEEDED;
+	
+	/* XXX WARNING: angular bending springs for hair apply stiffness factor as an overall factor, unlike cloth springs!
+	 * this is crap, but needed due to cloth/hair mixing ...
+	 * max_bend factor is not even used for hair, so ...
+	 */
+	scaling = s->stiffness * parms->bending;
+	kb = scaling / (20.0f * (parms->avg_spring_len + FLT_EPSILON));
+	
+	scaling = parms->bending_damping;
+	cb = scaling / (20.0f * (parms->avg_spring_len + FLT_EPSILON));
+	
+	/* XXX assuming same restlen for ij and jk segments here, this can be done correctly for hair later */
+	BPH_mass_spring_force_spring_bending_angular(data, s->ij, s->kl, s->mn, s->target, kb, cb);
+	
+#if 0
+	{
+		float x_kl[3], x_mn[3], v[3], d[3];
 		
-		/* XXX WARNING: angular bending springs for hair apply stiffness factor as an overall factor, unlike cloth springs!
-		 * this is crap, but needed due to cloth/hair mixing ...
-		 * max_bend factor is not even used for hair, so ...
-		 */
-		scaling = s->stiffness * parms->bending;
-		kb = scaling / (20.0f * (parms->avg_spring_len + FLT_EPSILON));
+		BPH_mass_spring_get_motion_state(data, s->kl, x_kl, v);
+		BPH_mass_spring_get_motion_state(data, s->mn, x_mn, v);
 		
-		scaling = parms->bending_damping;
-		cb = scaling / (20.0f * (parms->avg_spring_len + FLT_EPSILON));
+		BKE_sim_debug_data_add_dot(clmd->debug_data, x_kl, 0.9, 0.9, 0.9, "target", 7980, s->kl);
+		BKE_sim_debug_data_add_line(clmd->debug_data, x_kl, x_mn, 0.8, 0.8, 0.8, "target", 7981, s->kl);
 		
-		/* XXX assuming same restlen for ij and jk segments here, this can be done correctly for hair later */
-		BPH_mass_spring_force_spring_bending_angular(data, s->ij, s->kl, s->mn, s->target, kb, cb);
+		copy_v3_v3(d, s->target);
+		BKE_sim_debug_data_add_vector(clmd->debug_data, x_kl, d, 0.8, 0.8, 0.2, "target", 7982, s->kl);
 		
-#if 0
-		{
-			float x_kl[3], x_mn[3], v[3], d[3];
-			
-			BPH_mass_spring_get_motion_state(data, s->kl, x_kl, v);
-			BPH_mass_spring_get_motion_state(data, s->mn, x_mn, v);
-			
-			BKE_sim_debug_data_add_dot(clmd->debug_data, x_kl, 0.9, 0.9, 0.9, "target", 7980, s->kl);
-			BKE_sim_debug_data_add_line(clmd->debug_data, x_kl, x_mn, 0.8, 0.8, 0.8, "target", 7981, s->kl);
-			
-			copy_v3_v3(d, s->target);
-			BKE_sim_debug_data_add_vector(clmd->debug_data, x_kl, d, 0.8, 0.8, 0.2, "target", 7982, s->kl);
-			
-//			copy_v3_v3(d, s->target_ij);
-//			BKE_sim_debug_data_add_vector(clmd->debug_data, x, d, 1, 0.4, 0.4, "target", 7983, s->kl);
-		}
+//		copy_v3_v3(d, s->target_ij);
+//		BKE_sim_debug_data_add_vector(clmd->debug_data, x, d, 1, 0.4, 0.4, "target", 7983, s->kl);
+	}
 #endif
+#else
+	(void)parms;
+	(void)data;
 #endif
+}
+
+typedef struct SpringForceData {
+	ClothModifierData *clmd;
+	ClothSpring **springs;
+	ImplicitSpringForce *forces;
+	float time;
+} SpringForceData;
+
+static void cloth_calc_spring_force_task(void *userdata, int index)
+{
+	SpringForceData *data = (SpringForceData *)userdata;
+	
+	cloth_calc_spring_force(data->clmd, data->springs[index], data->time, &data->forces[index]);
+}
+
+/* Springs are evaluated in parallel, then added to the system in list order.
+ * Angular bending springs follow after all others, unlike the old interleaved
+ * order, so forces can differ from it by rounding. */
+static void cloth_calc_spring_forces(ClothModifierData *clmd, float time)
+{
+	Cloth *cloth = clmd->clothObject;
+	int maxspring = BLI_linklist_length(cloth->springs);
+	SpringForceData data;
+	int totspring = 0;
+	LinkNode *link;
+	
+	if (maxspring == 0)
+		return;
+	
+	data.clmd = clmd;
+	data.springs = (ClothSpring **)MEM_mallocN(sizeof(ClothSpring *) * maxspring, "cloth springs");
+	data.time = time;
+	
+	// only handle active springs
+	for (link = cloth->springs; link; link = link->next) {
+		ClothSpring *spring = (ClothSpring *)link->link;
+		if (!(spring->flags & CLOTH_SPRING_FLAG_DEACTIVATE) && !(spring->type & CLOTH_SPRING_TYPE_BENDING_ANG))
+			data.springs[totspring++] = spring;
+	}
+	
+	if (totspring > 0) {
+		data.forces = (ImplicitSpringForce *)MEM_mallocN(sizeof(ImplicitSpringForce) * totspring, "cloth spring forces");
+		
+		BLI_task_parallel_range(0, totspring, &data, cloth_calc_spring_force_task);
+		BPH_mass_spring_apply_spring_forces(cloth->implicit, data.forces, totspring);
+		
+		MEM_freeN(data.forces);
 	}
+	
+	for (link = cloth->springs; link; link = link->next) {
+		ClothSpring *spring = (ClothSpring *)link->link;
+		if (!(spring->flags & CLOTH_SPRING_FLAG_DEACTIVATE) && (spring->type & CLOTH_SPRING_TYPE_BENDING_ANG))
+			cloth_calc_spring_force_angular(clmd, spring);
+	}
+	
+	MEM_freeN(data.springs);
 }
 
 static void hair_get_boundbox(ClothModifierData *clmd, float gmin[3], float gmax[3])
@@ -540,12 +631,7 @@ static void cloth_calc_force(ClothModifierData *clmd, float UNUSED(frame), ListB
 	}
 	
 	// calculate spring forces
-	for (LinkNode *link = cloth->springs; link; link = link->next) {
-		ClothSpring *spring = (ClothSpring *)link->link;
-		// only handle active springs
-		if (!(spring->flags & CLOTH_SPRING_FLAG_DEACTIVATE))
-			cloth_calc_spring_force(clmd, spring, time);
-	}
+	cloth_calc_spring_forces(clmd, time);
 }
 
 /* returns vertexes' motion state */
@@ -941,6 +1027,7 @@ static void cloth_clear_result(ClothModifierData *clmd)
 	sres->max_error = sres->min_error = sres->avg_error = 0.0f;
 	sres->max_iterations = sres->min_iterations = 0;
 	sres->avg_iterations = 0.0f;
+	sres->force_time = sres->solve_time = 0.0f;
 }
 
 static void cloth_record_result(ClothModifierData *clmd, ImplicitSolverResult *result, int steps)
@@ -970,6 +1057,9 @@ static void cloth_record_result(ClothModifierData *clmd, ImplicitSolverResult *r
 		sres->avg_iterations += (float)result->iterations / (float)steps;
 	}
 	
+	sres->force_time += result->force_time;
+	sres->solve_time += result->solve_time;
+	
 	sres->status |= result->status;
 }
 
@@ -1011,6 +1101,8 @@ int BPH_cloth_solve(Object *ob, float frame, ClothModifierData *clmd, ListBase *
 	
 	while (step < tf) {
 		ImplicitSolverResult result;
+		double force_start;
+		float force_time;
 		
 		/* copy velocities for collision */
 		for (i = 0; i < numverts; i++) {
@@ -1047,10 +1139,13 @@ int BPH_cloth_solve(Object *ob, float frame, ClothModifierData *clmd, ListBase *
 		}
 		
 		// calculate forces
+		force_start = PIL_check_seconds_timer();
 		cloth_calc_force(clmd, frame, effectors, step);
+		force_time = (float)(PIL_check_seconds_timer() - force_start);
 		
 		// calculate new velocity and position
 		BPH_mass_spring_solve_velocities(id, dt, &result);
+		result.force_time = force_time;
 		cloth_record_result(clmd, &result, clmd->sim_parms->stepsPerFrame);
 		
 		if (is_hair) {
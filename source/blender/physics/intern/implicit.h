@@ -66,8 +66,22 @@ typedef struct ImplicitSolverResult {
 	
 	int iterations;
 	float error;
+	
+	/* timing of the step in seconds */
+	float force_time;	/* force and jacobian assembly */
+	float solve_time;	/* system setup and linear solver */
 } ImplicitSolverResult;
 
+/* Force and jacobians of a spring, evaluated ahead of adding it to the system.
+ * Springs with j < 0 only act on vertex i (goal springs) and have no off-diagonal block.
+ */
+typedef struct ImplicitSpringForce {
+	int i, j;
+	bool active;
+	float f[3];
+	float dfdx[3][3], dfdv[3][3];
+} ImplicitSpringForce;
+
 BLI_INLINE void implicit_print_matrix_elem(float v)
 {
     printf("%-8.3f", v);
@@ -129,6 +143,20 @@ bool BPH_mass_spring_force_spring_goal(struct Implicit_Data *data, int i, const
                                        float stiffness, float damping,
                                        float r_f[3], float r_dfdx[3][3], float r_dfdv[3][3]);
 
+/* Spring evaluation without changing the system, safe to call concurrently for different springs.
+ * The results are added with BPH_mass_spring_apply_spring_forces, in array order.
+ */
+bool BPH_mass_spring_eval_spring_linear(struct Implicit_Data *data, int i, int j, float restlen,
+                                        float stiffness, float damping, bool no_compress, float clamp_force,
+                                        float r_f[3], float r_dfdx[3][3], float r_dfdv[3][3]);
+bool BPH_mass_spring_eval_spring_bending(struct Implicit_Data *data, int i, int j, float restlen,
+                                         float kb, float cb,
+                                         float r_f[3], float r_dfdx[3][3], float r_dfdv[3][3]);
+bool BPH_mass_spring_eval_spring_goal(struct Implicit_Data *data, int i, const float goal_x[3], const float goal_v[3],
+                                      float stiffness, float damping,
+                                      float r_f[3], float r_dfdx[3][3], float r_dfdv[3][3]);
+void BPH_mass_spring_apply_spring_forces(struct Implicit_Data *data, struct ImplicitSpringForce *forces, int totforce);
+
 /* ======== Hair Volumetric Forces ======== */
 
 struct HairGrid;
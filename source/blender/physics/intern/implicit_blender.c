@@ -43,6 +43,7 @@
 
 #include "BLI_math.h"
 #include "BLI_linklist.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 
 #include "BKE_cloth.h"
@@ -52,13 +53,14 @@
 
 #include "BPH_mass_spring.h"
 
+#include "PIL_time.h"
+
 #ifdef __GNUC__
 #  pragma GCC diagnostic ignored "-Wtype-limits"
 #endif
 
-#ifdef _OPENMP
-#  define CLOTH_OPENMP_LIMIT 512
-#endif
+/* below this number of vertices or springs the solver loops run on the calling thread */
+#define CLOTH_PARALLEL_LIMIT 512
 
 #if 0  /* debug timing */
 #ifdef _WIN32
@@ -629,36 +631,111 @@ DO_INLINE void initdiag_bfmatrix(fmatrix3x3 *matrix, float m3[3][3])
 	}
 }
 
+/* Off-diagonal blocks of a big matrix sorted by row.
+ * Each block (r, c) is listed for row r and, transposed, for row c,
+ * so every row of the symmetric product can be computed on its own.
+ */
+typedef struct bfmatrix_rows {
+	int *offset;	/* first entry of each row, vcount + 1 */
+	int *blocks;	/* block index * 2, plus 1 for the transposed (column) side */
+} bfmatrix_rows;
+
+DO_INLINE void create_bfmatrix_rows(bfmatrix_rows *rows, unsigned int verts, unsigned int springs)
+{
+	rows->offset = (int *)MEM_callocN(sizeof(int) * (verts + 1), "cloth_implicit_alloc_matrix_rows");
+	rows->blocks = (int *)MEM_mallocN(sizeof(int) * 2 * max_ii(springs, 1), "cloth_implicit_alloc_matrix_row_blocks");
+}
+
+DO_INLINE void del_bfmatrix_rows(bfmatrix_rows *rows)
+{
+	MEM_freeN(rows->offset);
+	MEM_freeN(rows->blocks);
+}
+
+/* index the first num_blocks off-diagonal blocks of the matrix */
+static void build_bfmatrix_rows(bfmatrix_rows *rows, fmatrix3x3 *matrix, unsigned int num_blocks)
+{
+	unsigned int vcount = matrix[0].vcount;
+	int *offset = rows->offset;
+	unsigned int i;
+	
+	memset(offset, 0, sizeof(int) * (vcount + 1));
+	for (i = vcount; i < vcount + num_blocks; i++) {
+		offset[matrix[i].r + 1]++;
+		offset[matrix[i].c + 1]++;
+	}
+	for (i = 0; i < vcount; i++) {
+		offset[i + 1] += offset[i];
+	}
+	
+	/* fill in block order, offset[r] is used as the insertion point and shifted back afterwards */
+	for (i = vcount; i < vcount + num_blocks; i++) {
+		rows->blocks[offset[matrix[i].r]++] = (int)i * 2;
+		rows->blocks[offset[matrix[i].c]++] = (int)i * 2 + 1;
+	}
+	for (i = vcount; i > 0; i--) {
+		offset[i] = offset[i - 1];
+	}
+	offset[0] = 0;
+}
+
+typedef struct BFMatrixMulData {
+	float (*to)[3];
+	fmatrix3x3 *from;
+	const bfmatrix_rows *rows;
+	lfVector *fLongVector;
+} BFMatrixMulData;
+
+static void mul_bfmatrix_lfvector_row(void *userdata, int i)
+{
+	BFMatrixMulData *data = (BFMatrixMulData *)userdata;
+	fmatrix3x3 *from = data->from;
+	lfVector *v = data->fLongVector;
+	const int *offset = data->rows->offset;
+	int k;
+	
+	mul_fmatrix_fvector(data->to[i], from[i].m, v[i]);
+	
+	for (k = offset[i]; k < offset[i + 1]; k++) {
+		int b = data->rows->blocks[k];
+		fmatrix3x3 *block = &from[b >> 1];
+		
+		muladd_fmatrix_fvector(data->to[i], block->m, v[(b & 1) ? block->r : block->c]);
+	}
+}
+
 /* SPARSE SYMMETRIC multiply big matrix with long vector*/
 /* STATUS: verified */
-DO_INLINE void mul_bfmatrix_lfvector( float (*to)[3], fmatrix3x3 *from, lfVector *fLongVector)
+/* rows indexes the used off-diagonal blocks for a threaded product,
+ * without it all blocks are scattered on the calling thread.
+ * Per row sums add the blocks in a different order than the scatter,
+ * so both paths agree only up to rounding */
+DO_INLINE void mul_bfmatrix_lfvector( float (*to)[3], fmatrix3x3 *from, const bfmatrix_rows *rows, lfVector *fLongVector)
 {
 	unsigned int i = 0;
 	unsigned int vcount = from[0].vcount;
-	lfVector *temp = create_lfvector(vcount);
 	
-	zero_lfvector(to, vcount);
-
-#pragma omp parallel sections private(i) if (vcount > CLOTH_OPENMP_LIMIT)
-	{
-#pragma omp section
-		{
-			for (i = from[0].vcount; i < from[0].vcount+from[0].scount; i++) {
-				muladd_fmatrix_fvector(to[from[i].c], from[i].m, fLongVector[from[i].r]);
-			}
-		}
-#pragma omp section
-		{
-			for (i = 0; i < from[0].vcount+from[0].scount; i++) {
-				muladd_fmatrix_fvector(temp[from[i].r], from[i].m, fLongVector[from[i].c]);
-			}
+	if (rows) {
+		BFMatrixMulData data;
+		
+		data.to = to;
+		data.from = from;
+		data.rows = rows;
+		data.fLongVector = fLongVector;
+		
+		if (vcount > 0) {
+			BLI_task_parallel_range_ex(0, vcount, &data, mul_bfmatrix_lfvector_row, CLOTH_PARALLEL_LIMIT, false);
 		}
+		return;
 	}
-	add_lfvector_lfvector(to, to, temp, from[0].vcount);
-	
-	del_lfvector(temp);
-	
 	
+	for (i = 0; i < vcount; i++) {
+		mul_fmatrix_fvector(to[i], from[i].m, fLongVector[i]);
+	}
+	for (i = vcount; i < vcount + from[0].scount; i++) {
+		muladd_fmatrix_fvector(to[from[i].c], from[i].m, fLongVector[from[i].r]);
+		muladd_fmatrix_fvector(to[from[i].r], from[i].m, fLongVector[from[i].c]);
+	}
 }
 
 /* SPARSE SYMMETRIC sub big matrix with big matrix*/
@@ -687,6 +764,7 @@ typedef struct Implicit_Data  {
 	lfVector *F;				/* forces */
 	fmatrix3x3 *dFdV, *dFdX;	/* force jacobians */
 	int num_blocks;				/* number of off-diagonal blocks (springs) */
+	bfmatrix_rows rows;			/* row index of the off-diagonal blocks, for threaded products */
 	
 	/* motion state data */
 	lfVector *X, *Xnew;			/* positions */
@@ -724,6 +802,7 @@ Implicit_Data *BPH_mass_spring_solver_create(int numverts, int numsprings)
 	id->B = create_lfvector(numverts);
 	id->dV = create_lfvector(numverts);
 	id->z = create_lfvector(numverts);
+	create_bfmatrix_rows(&id->rows, numverts, numsprings);
 
 	initdiag_bfmatrix(id->bigI, I);
 
@@ -750,6 +829,7 @@ void BPH_mass_spring_solver_free(Implicit_Data *id)
 	del_lfvector(id->B);
 	del_lfvector(id->dV);
 	del_lfvector(id->z);
+	del_bfmatrix_rows(&id->rows);
 	
 	MEM_freeN(id);
 }
@@ -812,7 +892,7 @@ static int  cg_filtered(lfVector *ldV, fmatrix3x3 *lA, lfVector *lB, lfVector *z
 
 	// r = B - Mul(tmp, A, X);    // just use B if X known to be zero
 	cp_lfvector(r, lB, numverts);
-	mul_bfmatrix_lfvector(tmp, lA, ldV);
+	mul_bfmatrix_lfvector(tmp, lA, NULL, ldV);
 	sub_lfvector_lfvector(r, r, tmp, numverts);
 
 	filter(r, S);
@@ -824,7 +904,7 @@ static int  cg_filtered(lfVector *ldV, fmatrix3x3 *lA, lfVector *lB, lfVector *z
 
 	while (s>starget && conjgrad_loopcount < conjgrad_looplimit) {
 		// Mul(q, A, d); // q = A*d;
-		mul_bfmatrix_lfvector(q, lA, d);
+		mul_bfmatrix_lfvector(q, lA, NULL, d);
 
 		filter(q, S);
 
@@ -858,7 +938,7 @@ static int  cg_filtered(lfVector *ldV, fmatrix3x3 *lA, lfVector *lB, lfVector *z
 }
 #endif
 
-static int cg_filtered(lfVector *ldV, fmatrix3x3 *lA, lfVector *lB, lfVector *z, fmatrix3x3 *S, ImplicitSolverResult *result)
+static int cg_filtered(lfVector *ldV, fmatrix3x3 *lA, const bfmatrix_rows *rows, lfVector *lB, lfVector *z, fmatrix3x3 *S, ImplicitSolverResult *result)
 {
 	// Solves for unknown X in equation AX=B
 	unsigned int conjgrad_loopcount=0, conjgrad_looplimit=100;
@@ -882,7 +962,7 @@ static int cg_filtered(lfVector *ldV, fmatrix3x3 *lA, lfVector *lB, lfVector *z,
 	delta_target = conjgrad_epsilon*conjgrad_epsilon * bnorm2;
 	
 	/* r = filter(B - A * dV) */
-	mul_bfmatrix_lfvector(AdV, lA, ldV);
+	mul_bfmatrix_lfvector(AdV, lA, rows, ldV);
 	sub_lfvector_lfvector(r, lB, AdV, numverts);
 	filter(r, S);
 	
@@ -905,7 +985,7 @@ static int cg_filtered(lfVector *ldV, fmatrix3x3 *lA, lfVector *lB, lfVector *z,
 #endif
 	
 	while (delta_new > delta_target && conjgrad_loopcount < conjgrad_looplimit) {
-		mul_bfmatrix_lfvector(q, lA, c);
+		mul_bfmatrix_lfvector(q, lA, rows, c);
 		filter(q, S);
 		
 		alpha = delta_new / dot_lfvector(c, q, numverts);
@@ -978,7 +1058,7 @@ static int cg_filtered_pre(lfVector *dv, fmatrix3x3 *lA, lfVector *lB, lfVector
 	filter(dv, S);
 	add_lfvector_lfvector(dv, dv, z, numverts);
 	
-	mul_bfmatrix_lfvector(r, lA, dv);
+	mul_bfmatrix_lfvector(r, lA, NULL, dv);
 	sub_lfvector_lfvector(r, lB, r, numverts);
 	filter(r, S);
 	
@@ -995,7 +1075,7 @@ static int cg_filtered_pre(lfVector *dv, fmatrix3x3 *lA, lfVector *lB, lfVector
 	{
 		iterations++;
 		
-		mul_bfmatrix_lfvector(s, lA, p);
+		mul_bfmatrix_lfvector(s, lA, NULL, p);
 		filter(s, S);
 		
 		alpha = deltaNew / dot_lfvector(p, s, numverts);
@@ -1052,12 +1132,12 @@ static int cg_filtered_pre(lfVector *dv, fmatrix3x3 *lA, lfVector *lB, lfVector
 	add_lfvector_lfvector(dv, dv, z, numverts);
 	
 	// b_hat = S(b-A(I-S)z)
-	mul_bfmatrix_lfvector(r, lA, z);
-	mul_bfmatrix_lfvector(bhat, bigI, r);
+	mul_bfmatrix_lfvector(r, lA, NULL, z);
+	mul_bfmatrix_lfvector(bhat, bigI, NULL, r);
 	sub_lfvector_lfvector(bhat, lB, bhat, numverts);
 	
 	// r = S(b-Ax)
-	mul_bfmatrix_lfvector(r, lA, dv);
+	mul_bfmatrix_lfvector(r, lA, NULL, dv);
 	sub_lfvector_lfvector(r, lB, r, numverts);
 	filter(r, S);
 	
@@ -1076,7 +1156,7 @@ static int cg_filtered_pre(lfVector *dv, fmatrix3x3 *lA, lfVector *lB, lfVector
 	filter(dv, S);
 	add_lfvector_lfvector(dv, dv, z, numverts);
 	
-	mul_bfmatrix_lfvector(r, lA, dv);
+	mul_bfmatrix_lfvector(r, lA, NULL, dv);
 	sub_lfvector_lfvector(r, lB, r, numverts);
 	filter(r, S);
 	
@@ -1096,7 +1176,7 @@ static int cg_filtered_pre(lfVector *dv, fmatrix3x3 *lA, lfVector *lB, lfVector
 	{
 		iterations++;
 		
-		mul_bfmatrix_lfvector(s, lA, p);
+		mul_bfmatrix_lfvector(s, lA, NULL, p);
 		filter(s, S);
 		
 		alpha = deltaNew / dot_lfvector(p, s, numverts);
@@ -1137,6 +1217,7 @@ static int cg_filtered_pre(lfVector *dv, fmatrix3x3 *lA, lfVector *lB, lfVector
 bool BPH_mass_spring_solve_velocities(Implicit_Data *data, float dt, ImplicitSolverResult *result)
 {
 	unsigned int numverts = data->dFdV[0].vcount;
+	double start = PIL_check_seconds_timer();
 
 	lfVector *dFdXmV = create_lfvector(numverts);
 	zero_lfvector(data->dV, numverts);
@@ -1145,23 +1226,23 @@ bool BPH_mass_spring_solve_velocities(Implicit_Data *data, float dt, ImplicitSol
 
 	subadd_bfmatrixS_bfmatrixS(data->A, data->dFdV, dt, data->dFdX, (dt*dt));
 
-	mul_bfmatrix_lfvector(dFdXmV, data->dFdX, data->V);
+	/* all system matrices share the block layout of the springs added in this step */
+	build_bfmatrix_rows(&data->rows, data->A, data->num_blocks);
 
-	add_lfvectorS_lfvectorS(data->B, data->F, dt, dFdXmV, (dt*dt), numverts);
+	mul_bfmatrix_lfvector(dFdXmV, data->dFdX, &data->rows, data->V);
 
-	// itstart();
+	add_lfvectorS_lfvectorS(data->B, data->F, dt, dFdXmV, (dt*dt), numverts);
 
-	cg_filtered(data->dV, data->A, data->B, data->z, data->S, result); /* conjugate gradient algorithm to solve Ax=b */
+	cg_filtered(data->dV, data->A, &data->rows, data->B, data->z, data->S, result); /* conjugate gradient algorithm to solve Ax=b */
 	// cg_filtered_pre(id->dV, id->A, id->B, id->z, id->S, id->P, id->Pinv, id->bigI);
 
-	// itend();
-	// printf("cg_filtered calc time: %f\n", (float)itval());
-
 	// advance velocities
 	add_lfvector_lfvector(data->Vnew, data->V, data->dV, numverts);
 
 	del_lfvector(dFdXmV);
 	
+	result->solve_time = (float)(PIL_check_seconds_timer() - start);
+	
 	return result->status == BPH_SOLVER_SUCCESS;
 }
 
@@ -1247,12 +1328,8 @@ void BPH_mass_spring_set_new_velocity(struct Implicit_Data *data, int index, con
 
 /* -------------------------------- */
 
-static int BPH_mass_spring_add_block(Implicit_Data *data, int v1, int v2)
+BLI_INLINE void init_block(Implicit_Data *data, int s, int v1, int v2)
 {
-	int s = data->M[0].vcount + data->num_blocks; /* index from array start */
-	BLI_assert(s < data->M[0].vcount + data->M[0].scount);
-	++data->num_blocks;
-	
 	/* tfm and S don't have spring entries (diagonal blocks only) */
 	init_fmatrix(data->bigI + s, v1, v2);
 	init_fmatrix(data->M + s, v1, v2);
@@ -1261,6 +1338,15 @@ static int BPH_mass_spring_add_block(Implicit_Data *data, int v1, int v2)
 	init_fmatrix(data->A + s, v1, v2);
 	init_fmatrix(data->P + s, v1, v2);
 	init_fmatrix(data->Pinv + s, v1, v2);
+}
+
+static int BPH_mass_spring_add_block(Implicit_Data *data, int v1, int v2)
+{
+	int s = data->M[0].vcount + data->num_blocks; /* index from array start */
+	BLI_assert(s < data->M[0].vcount + data->M[0].scount);
+	++data->num_blocks;
+	
+	init_block(data, s, v1, v2);
 	
 	return s;
 }
@@ -1631,9 +1717,122 @@ BLI_INLINE void apply_spring(Implicit_Data *data, int i, int j, const float f[3]
 	sub_m3_m3m3(data->dFdV[block_ij].m, data->dFdV[block_ij].m, dfdv);
 }
 
-bool BPH_mass_spring_force_spring_linear(Implicit_Data *data, int i, int j, float restlen,
-                                         float stiffness, float damping, bool no_compress, float clamp_force,
-                                         float r_f[3], float r_dfdx[3][3], float r_dfdv[3][3])
+/* Threaded assembly of evaluated spring forces.
+ * Off-diagonal blocks are reserved up front in spring order, so every spring writes its own block,
+ * the diagonal blocks and forces are then gathered per vertex in spring order.
+ * Angular bending springs are added afterwards, so results can differ from the old
+ * serial assembly in the last bits (float addition is not associative).
+ */
+typedef struct SpringAssemblyData {
+	Implicit_Data *data;
+	ImplicitSpringForce *forces;
+	const int *blocks;
+	const bfmatrix_rows *vert_forces;	/* spring index * 2, plus 1 for the j side */
+} SpringAssemblyData;
+
+static void spring_assembly_block_task(void *userdata, int index)
+{
+	SpringAssemblyData *adata = (SpringAssemblyData *)userdata;
+	Implicit_Data *data = adata->data;
+	ImplicitSpringForce *force = &adata->forces[index];
+	int s = adata->blocks[index];
+	
+	if (s < 0)
+		return;
+	
+	init_block(data, s, force->i, force->j);
+	sub_m3_m3m3(data->dFdX[s].m, data->dFdX[s].m, force->dfdx);
+	sub_m3_m3m3(data->dFdV[s].m, data->dFdV[s].m, force->dfdv);
+}
+
+static void spring_assembly_vertex_task(void *userdata, int v)
+{
+	SpringAssemblyData *adata = (SpringAssemblyData *)userdata;
+	Implicit_Data *data = adata->data;
+	const bfmatrix_rows *vert_forces = adata->vert_forces;
+	int k;
+	
+	for (k = vert_forces->offset[v]; k < vert_forces->offset[v + 1]; k++) {
+		int e = vert_forces->blocks[k];
+		ImplicitSpringForce *force = &adata->forces[e >> 1];
+		
+		if (e & 1)
+			sub_v3_v3(data->F[v], force->f);
+		else
+			add_v3_v3(data->F[v], force->f);
+		
+		add_m3_m3m3(data->dFdX[v].m, data->dFdX[v].m, force->dfdx);
+		add_m3_m3m3(data->dFdV[v].m, data->dFdV[v].m, force->dfdv);
+	}
+}
+
+void BPH_mass_spring_apply_spring_forces(Implicit_Data *data, ImplicitSpringForce *forces, int totforce)
+{
+	int numverts = data->M[0].vcount;
+	SpringAssemblyData adata;
+	bfmatrix_rows vert_forces;
+	int *blocks, *offset;
+	int k, v;
+	
+	if (totforce == 0)
+		return;
+	
+	blocks = (int *)MEM_mallocN(sizeof(int) * totforce, "spring force blocks");
+	create_bfmatrix_rows(&vert_forces, numverts, totforce);
+	offset = vert_forces.offset;
+	
+	for (k = 0; k < totforce; k++) {
+		ImplicitSpringForce *force = &forces[k];
+		
+		blocks[k] = -1;
+		if (!force->active)
+			continue;
+		
+		offset[force->i + 1]++;
+		if (force->j >= 0) {
+			offset[force->j + 1]++;
+			
+			blocks[k] = data->M[0].vcount + data->num_blocks;
+			BLI_assert(blocks[k] < data->M[0].vcount + data->M[0].scount);
+			++data->num_blocks;
+		}
+	}
+	for (v = 0; v < numverts; v++) {
+		offset[v + 1] += offset[v];
+	}
+	
+	for (k = 0; k < totforce; k++) {
+		ImplicitSpringForce *force = &forces[k];
+		
+		if (!force->active)
+			continue;
+		
+		vert_forces.blocks[offset[force->i]++] = k * 2;
+		if (force->j >= 0)
+			vert_forces.blocks[offset[force->j]++] = k * 2 + 1;
+	}
+	for (v = numverts; v > 0; v--) {
+		offset[v] = offset[v - 1];
+	}
+	offset[0] = 0;
+	
+	adata.data = data;
+	adata.forces = forces;
+	adata.blocks = blocks;
+	adata.vert_forces = &vert_forces;
+	
+	BLI_task_parallel_range_ex(0, totforce, &adata, spring_assembly_block_task, CLOTH_PARALLEL_LIMIT, false);
+	if (numverts > 0) {
+		BLI_task_parallel_range_ex(0, numverts, &adata, spring_assembly_vertex_task, CLOTH_PARALLEL_LIMIT, false);
+	}
+	
+	del_bfmatrix_rows(&vert_forces);
+	MEM_freeN(blocks);
+}
+
+bool BPH_mass_spring_eval_spring_linear(Implicit_Data *data, int i, int j, float restlen,
+                                        float stiffness, float damping, bool no_compress, float clamp_force,
+                                        float r_f[3], float r_dfdx[3][3], float r_dfdv[3][3])
 {
 	float extent[3], length, dir[3], vel[3];
 	
@@ -1641,42 +1840,54 @@ bool BPH_mass_spring_force_spring_linear(Implicit_Data *data, int i, int j, floa
 	spring_length(data, i, j, extent, dir, &length, vel);
 	
 	if (length > restlen || no_compress) {
-		float stretch_force, f[3], dfdx[3][3], dfdv[3][3];
+		float stretch_force;
 		
 		stretch_force = stiffness * (length - restlen);
 		if (clamp_force > 0.0f && stretch_force > clamp_force) {
 			stretch_force = clamp_force;
 		}
-		mul_v3_v3fl(f, dir, stretch_force);
+		mul_v3_v3fl(r_f, dir, stretch_force);
 		
 		// Ascher & Boxman, p.21: Damping only during elonglation
 		// something wrong with it...
-		madd_v3_v3fl(f, dir, damping * dot_v3v3(vel, dir));
-		
-		dfdx_spring(dfdx, dir, length, restlen, stiffness);
-		dfdv_damp(dfdv, dir, damping);
+		madd_v3_v3fl(r_f, dir, damping * dot_v3v3(vel, dir));
 		
-		apply_spring(data, i, j, f, dfdx, dfdv);
-		
-		if (r_f) copy_v3_v3(r_f, f);
-		if (r_dfdx) copy_m3_m3(r_dfdx, dfdx);
-		if (r_dfdv) copy_m3_m3(r_dfdv, dfdv);
+		dfdx_spring(r_dfdx, dir, length, restlen, stiffness);
+		dfdv_damp(r_dfdv, dir, damping);
 		
 		return true;
 	}
 	else {
-		if (r_f) zero_v3(r_f);
-		if (r_dfdx) zero_m3(r_dfdx);
-		if (r_dfdv) zero_m3(r_dfdv);
+		zero_v3(r_f);
+		zero_m3(r_dfdx);
+		zero_m3(r_dfdv);
 		
 		return false;
 	}
 }
 
+bool BPH_mass_spring_force_spring_linear(Implicit_Data *data, int i, int j, float restlen,
+                                         float stiffness, float damping, bool no_compress, float clamp_force,
+                                         float r_f[3], float r_dfdx[3][3], float r_dfdv[3][3])
+{
+	float f[3], dfdx[3][3], dfdv[3][3];
+	bool active = BPH_mass_spring_eval_spring_linear(data, i, j, restlen, stiffness, damping, no_compress, clamp_force,
+	                                                 f, dfdx, dfdv);
+	
+	if (active)
+		apply_spring(data, i, j, f, dfdx, dfdv);
+	
+	if (r_f) copy_v3_v3(r_f, f);
+	if (r_dfdx) copy_m3_m3(r_dfdx, dfdx);
+	if (r_dfdv) copy_m3_m3(r_dfdv, dfdv);
+	
+	return active;
+}
+
 /* See "Stable but Responsive Cloth" (Choi, Ko 2005) */
-bool BPH_mass_spring_force_spring_bending(Implicit_Data *data, int i, int j, float restlen,
-                                          float kb, float cb,
-                                          float r_f[3], float r_dfdx[3][3], float r_dfdv[3][3])
+bool BPH_mass_spring_eval_spring_bending(Implicit_Data *data, int i, int j, float restlen,
+                                         float kb, float cb,
+                                         float r_f[3], float r_dfdx[3][3], float r_dfdv[3][3])
 {
 	float extent[3], length, dir[3], vel[3];
 	
@@ -1684,33 +1895,42 @@ bool BPH_mass_spring_force_spring_bending(Implicit_Data *data, int i, int j, flo
 	spring_length(data, i, j, extent, dir, &length, vel);
 	
 	if (length < restlen) {
-		float f[3], dfdx[3][3], dfdv[3][3];
+		mul_v3_v3fl(r_f, dir, fbstar(length, restlen, kb, cb));
 		
-		mul_v3_v3fl(f, dir, fbstar(length, restlen, kb, cb));
-		
-		outerproduct(dfdx, dir, dir);
-		mul_m3_fl(dfdx, fbstar_jacobi(length, restlen, kb, cb));
+		outerproduct(r_dfdx, dir, dir);
+		mul_m3_fl(r_dfdx, fbstar_jacobi(length, restlen, kb, cb));
 		
 		/* XXX damping not supported */
-		zero_m3(dfdv);
-		
-		apply_spring(data, i, j, f, dfdx, dfdv);
-		
-		if (r_f) copy_v3_v3(r_f, f);
-		if (r_dfdx) copy_m3_m3(r_dfdx, dfdx);
-		if (r_dfdv) copy_m3_m3(r_dfdv, dfdv);
+		zero_m3(r_dfdv);
 		
 		return true;
 	}
 	else {
-		if (r_f) zero_v3(r_f);
-		if (r_dfdx) zero_m3(r_dfdx);
-		if (r_dfdv) zero_m3(r_dfdv);
+		zero_v3(r_f);
+		zero_m3(r_dfdx);
+		zero_m3(r_dfdv);
 		
 		return false;
 	}
 }
 
+bool BPH_mass_spring_force_spring_bending(Implicit_Data *data, int i, int j, float restlen,
+                                          float kb, float cb,
+                                          float r_f[3], float r_dfdx[3][3], float r_dfdv[3][3])
+{
+	float f[3], dfdx[3][3], dfdv[3][3];
+	bool active = BPH_mass_spring_eval_spring_bending(data, i, j, restlen, kb, cb, f, dfdx, dfdv);
+	
+	if (active)
+		apply_spring(data, i, j, f, dfdx, dfdv);
+	
+	if (r_f) copy_v3_v3(r_f, f);
+	if (r_dfdx) copy_m3_m3(r_dfdx, dfdx);
+	if (r_dfdv) copy_m3_m3(r_dfdv, dfdv);
+	
+	return active;
+}
+
 /* Jacobian of a direction vector.
  * Basically the part of the differential orthogonal to the direction,
  * inversely proportional to the length of the edge.
@@ -1994,12 +2214,11 @@ bool BPH_mass_spring_force_spring_bending_angular(Implicit_Data *data, int i, in
 	return true;
 }
 
-bool BPH_mass_spring_force_spring_goal(Implicit_Data *data, int i, const float goal_x[3], const float goal_v[3],
-                                       float stiffness, float damping,
-                                       float r_f[3], float r_dfdx[3][3], float r_dfdv[3][3])
+bool BPH_mass_spring_eval_spring_goal(Implicit_Data *data, int i, const float goal_x[3], const float goal_v[3],
+                                      float stiffness, float damping,
+                                      float r_f[3], float r_dfdx[3][3], float r_dfdv[3][3])
 {
 	float root_goal_x[3], root_goal_v[3], extent[3], length, dir[3], vel[3];
-	float f[3], dfdx[3][3], dfdv[3][3];
 	
 	/* goal is in world space */
 	world_to_root_v3(data, i, root_goal_x, goal_x);
@@ -2010,32 +2229,44 @@ bool BPH_mass_spring_force_spring_goal(Implicit_Data *data, int i, const float g
 	length = normalize_v3_v3(dir, extent);
 	
 	if (length > ALMOST_ZERO) {
-		mul_v3_v3fl(f, dir, stiffness * length);
+		mul_v3_v3fl(r_f, dir, stiffness * length);
 		
 		// Ascher & Boxman, p.21: Damping only during elonglation
 		// something wrong with it...
-		madd_v3_v3fl(f, dir, damping * dot_v3v3(vel, dir));
+		madd_v3_v3fl(r_f, dir, damping * dot_v3v3(vel, dir));
 		
-		dfdx_spring(dfdx, dir, length, 0.0f, stiffness);
-		dfdv_damp(dfdv, dir, damping);
-		
-		add_v3_v3(data->F[i], f);
-		add_m3_m3m3(data->dFdX[i].m, data->dFdX[i].m, dfdx);
-		add_m3_m3m3(data->dFdV[i].m, data->dFdV[i].m, dfdv);
-		
-		if (r_f) copy_v3_v3(r_f, f);
-		if (r_dfdx) copy_m3_m3(r_dfdx, dfdx);
-		if (r_dfdv) copy_m3_m3(r_dfdv, dfdv);
+		dfdx_spring(r_dfdx, dir, length, 0.0f, stiffness);
+		dfdv_damp(r_dfdv, dir, damping);
 		
 		return true;
 	}
 	else {
-		if (r_f) zero_v3(r_f);
-		if (r_dfdx) zero_m3(r_dfdx);
-		if (r_dfdv) zero_m3(r_dfdv);
+		zero_v3(r_f);
+		zero_m3(r_dfdx);
+		zero_m3(r_dfdv);
 		
 		return false;
 	}
 }
 
+bool BPH_mass_spring_force_spring_goal(Implicit_Data *data, int i, const float goal_x[3], const float goal_v[3],
+                                       float stiffness, float damping,
+                                       float r_f[3], float r_dfdx[3][3], float r_dfdv[3][3])
+{
+	float f[3], dfdx[3][3], dfdv[3][3];
+	bool active = BPH_mass_spring_eval_spring_goal(data, i, goal_x, goal_v, stiffness, damping, f, dfdx, dfdv);
+	
+	if (active) {
+		add_v3_v3(data->F[i], f);
+		add_m3_m3m3(data->dFdX[i].m, data->dFdX[i].m, dfdx);
+		add_m3_m3m3(data->dFdV[i].m, data->dFdV[i].m, dfdv);
+	}
+	
+	if (r_f) copy_v3_v3(r_f, f);
+	if (r_dfdx) copy_m3_m3(r_dfdx, dfdx);
+	if (r_dfdv) copy_m3_m3(r_dfdv, dfdv);
+	
+	return active;
+}
+
 #endif /* IMPLICIT_SOLVER_BLENDER */
@@ -87,6 +87,8 @@ extern "C" {
 #include "BKE_global.h"
 
 #include "BPH_mass_spring.h"
+
+#include "PIL_time.h"
 }
 
 typedef float Scalar;
@@ -503,6 +505,7 @@ bool BPH_mass_spring_solve_velocities(Implicit_Data *data, float dt, ImplicitSol
 #ifdef USE_EIGEN_CONSTRAINED_CG
 	typedef ConstraintConjGrad solver_t;
 #endif
+	double start = PIL_check_seconds_timer();
 	
 	data->iM.construct(data->M);
 	data->idFdX.construct(data->dFdX);
@@ -557,6 +560,7 @@ bool BPH_mass_spring_solve_velocities(Implicit_Data *data, float dt, ImplicitSol
 
 	result->iterations = cg.iterations();
 	result->error = cg.error();
+	result->solve_time = (float)(PIL_check_seconds_timer() - start);
 	
 	return cg.info() == Eigen::Success;
 }
@@ -958,9 +962,9 @@ BLI_INLINE void apply_spring(Implicit_Data *data, int i, int j, const float f[3]
 	data->idFdV.sub(j, i, dfdv);
 }
 
-bool BPH_mass_spring_force_spring_linear(Implicit_Data *data, int i, int j, float restlen,
-                                         float stiffness, float damping, bool no_compress, float clamp_force,
-                                         float r_f[3], float r_dfdx[3][3], float r_dfdv[3][3])
+bool BPH_mass_spring_eval_spring_linear(Implicit_Data *data, int i, int j, float restlen,
+                                        float stiffness, float damping, bool no_compress, float clamp_force,
+                                        float r_f[3], float r_dfdx[3][3], float r_dfdv[3][3])
 {
 	float extent[3], length, dir[3], vel[3];
 	
@@ -968,42 +972,54 @@ bool BPH_mass_spring_force_spring_linear(Implicit_Data *data, int i, int j, floa
 	spring_length(data, i, j, extent, dir, &length, vel);
 	
 	if (length > restlen || no_compress) {
-		float stretch_force, f[3], dfdx[3][3], dfdv[3][3];
+		float stretch_force;
 		
 		stretch_force = stiffness * (length - restlen);
 		if (clamp_force > 0.0f && stretch_force > clamp_force) {
 			stretch_force = clamp_force;
 		}
-		mul_v3_v3fl(f, dir, stretch_force);
+		mul_v3_v3fl(r_f, dir, stretch_force);
 		
 		// Ascher & Boxman, p.21: Damping only during elonglation
 		// something wrong with it...
-		madd_v3_v3fl(f, dir, damping * dot_v3v3(vel, dir));
+		madd_v3_v3fl(r_f, dir, damping * dot_v3v3(vel, dir));
 		
-		dfdx_spring(dfdx, dir, length, restlen, stiffness);
-		dfdv_damp(dfdv, dir, damping);
-		
-		apply_spring(data, i, j, f, dfdx, dfdv);
-		
-		if (r_f) copy_v3_v3(r_f, f);
-		if (r_dfdx) copy_m3_m3(r_dfdx, dfdx);
-		if (r_dfdv) copy_m3_m3(r_dfdv, dfdv);
+		dfdx_spring(r_dfdx, dir, length, restlen, stiffness);
+		dfdv_damp(r_dfdv, dir, damping);
 		
 		return true;
 	}
 	else {
-		if (r_f) zero_v3(r_f);
-		if (r_dfdx) zero_m3(r_dfdx);
-		if (r_dfdv) zero_m3(r_dfdv);
+		zero_v3(r_f);
+		zero_m3(r_dfdx);
+		zero_m3(r_dfdv);
 		
 		return false;
 	}
 }
 
+bool BPH_mass_spring_force_spring_linear(Implicit_Data *data, int i, int j, float restlen,
+                                         float stiffness, float damping, bool no_compress, float clamp_force,
+                                         float r_f[3], float r_dfdx[3][3], float r_dfdv[3][3])
+{
+	float f[3], dfdx[3][3], dfdv[3][3];
+	bool active = BPH_mass_spring_eval_spring_linear(data, i, j, restlen, stiffness, damping, no_compress, clamp_force,
+	                                                 f, dfdx, dfdv);
+	
+	if (active)
+		apply_spring(data, i, j, f, dfdx, dfdv);
+	
+	if (r_f) copy_v3_v3(r_f, f);
+	if (r_dfdx) copy_m3_m3(r_dfdx, dfdx);
+	if (r_dfdv) copy_m3_m3(r_dfdv, dfdv);
+	
+	return active;
+}
+
 /* See "Stable but Responsive Cloth" (Choi, Ko 2005) */
-bool BPH_mass_spring_force_spring_bending(Implicit_Data *data, int i, int j, float restlen,
-                                          float kb, float cb,
-                                          float r_f[3], float r_dfdx[3][3], float r_dfdv[3][3])
+bool BPH_mass_spring_eval_spring_bending(Implicit_Data *data, int i, int j, float restlen,
+                                         float kb, float cb,
+                                         float r_f[3], float r_dfdx[3][3], float r_dfdv[3][3])
 {
 	float extent[3], length, dir[3], vel[3];
 	
@@ -1011,33 +1027,42 @@ bool BPH_mass_spring_force_spring_bending(Implicit_Data *data, int i, int j, flo
 	spring_length(data, i, j, extent, dir, &length, vel);
 	
 	if (length < restlen) {
-		float f[3], dfdx[3][3], dfdv[3][3];
-		
-		mul_v3_v3fl(f, dir, fbstar(length, restlen, kb, cb));
+		mul_v3_v3fl(r_f, dir, fbstar(length, restlen, kb, cb));
 		
-		outerproduct(dfdx, dir, dir);
-		mul_m3_fl(dfdx, fbstar_jacobi(length, restlen, kb, cb));
+		outerproduct(r_dfdx, dir, dir);
+		mul_m3_fl(r_dfdx, fbstar_jacobi(length, restlen, kb, cb));
 		
 		/* XXX damping not supported */
-		zero_m3(dfdv);
-		
-		apply_spring(data, i, j, f, dfdx, dfdv);
-		
-		if (r_f) copy_v3_v3(r_f, f);
-		if (r_dfdx) copy_m3_m3(r_dfdx, dfdx);
-		if (r_dfdv) copy_m3_m3(r_dfdv, dfdv);
+		zero_m3(r_dfdv);
 		
 		return true;
 	}
 	else {
-		if (r_f) zero_v3(r_f);
-		if (r_dfdx) zero_m3(r_dfdx);
-		if (r_dfdv) zero_m3(r_dfdv);
+		zero_v3(r_f);
+		zero_m3(r_dfdx);
+		zero_m3(r_dfdv);
 		
 		return false;
 	}
 }
 
+bool BPH_mass_spring_force_spring_bending(Implicit_Data *data, int i, int j, float restlen,
+                                          float kb, float cb,
+                                          float r_f[3], float r_dfdx[3][3], float r_dfdv[3][3])
+{
+	float f[3], dfdx[3][3], dfdv[3][3];
+	bool active = BPH_mass_spring_eval_spring_bending(data, i, j, restlen, kb, cb, f, dfdx, dfdv);
+	
+	if (active)
+		apply_spring(data, i, j, f, dfdx, dfdv);
+	
+	if (r_f) copy_v3_v3(r_f, f);
+	if (r_dfdx) copy_m3_m3(r_dfdx, dfdx);
+	if (r_dfdv) copy_m3_m3(r_dfdv, dfdv);
+	
+	return active;
+}
+
 /* Jacobian of a direction vector.
  * Basically the part of the differential orthogonal to the direction,
  * inversely proportional to the length of the edge.
@@ -1322,12 +1347,11 @@ bool BPH_mass_spring_force_spring_bending_angular(Implicit_Data *data, int i, in
 	return true;
 }
 
-bool BPH_mass_spring_force_spring_goal(Implicit_Data *data, int i, const float goal_x[3], const float goal_v[3],
-                                       float stiffness, float damping,
-                                       float r_f[3], float r_dfdx[3][3], float r_dfdv[3][3])
+bool BPH_mass_spring_eval_spring_goal(Implicit_Data *data, int i, const float goal_x[3], const float goal_v[3],
+                                      float stiffness, float damping,
+                                      float r_f[3], float r_dfdx[3][3], float r_dfdv[3][3])
 {
 	float root_goal_x[3], root_goal_v[3], extent[3], length, dir[3], vel[3];
-	float f[3], dfdx[3][3], dfdv[3][3];
 	
 	/* goal is in world space */
 	world_to_root_v3(data, i, root_goal_x, goal_x);
@@ -1338,32 +1362,66 @@ bool BPH_mass_spring_force_spring_goal(Implicit_Data *data, int i, const float g
 	length = normalize_v3_v3(dir, extent);
 	
 	if (length > ALMOST_ZERO) {
-		mul_v3_v3fl(f, dir, stiffness * length);
+		mul_v3_v3fl(r_f, dir, stiffness * length);
 		
 		// Ascher & Boxman, p.21: Damping only during elonglation
 		// something wrong with it...
-		madd_v3_v3fl(f, dir, damping * dot_v3v3(vel, dir));
-		
-		dfdx_spring(dfdx, dir, length, 0.0f, stiffness);
-		dfdv_damp(dfdv, dir, damping);
-		
-		add_v3_v3(data->F.v3(i), f);
-		data->idFdX.add(i, i, dfdx);
-		data->idFdV.add(i, i, dfdv);
+		madd_v3_v3fl(r_f, dir, damping * dot_v3v3(vel, dir));
 		
-		if (r_f) copy_v3_v3(r_f, f);
-		if (r_dfdx) copy_m3_m3(r_dfdx, dfdx);
-		if (r_dfdv) copy_m3_m3(r_dfdv, dfdv);
+		dfdx_spring(r_dfdx, dir, length, 0.0f, stiffness);
+		dfdv_damp(r_dfdv, dir, damping);
 		
 		return true;
 	}
 	else {
-		if (r_f) zero_v3(r_f);
-		if (r_dfdx) zero_m3(r_dfdx);
-		if (r_dfdv) zero_m3(r_dfdv);
+		zero_v3(r_f);
+		zero_m3(r_dfdx);
+		zero_m3(r_dfdv);
 		
 		return false;
 	}
 }
 
+bool BPH_mass_spring_force_spring_goal(Implicit_Data *data, int i, const float goal_x[3], const float goal_v[3],
+                                       float stiffness, float damping,
+                                       float r_f[3], float r_dfdx[3][3], float r_dfdv[3][3])
+{
+	float f[3], dfdx[3][3], dfdv[3][3];
+	bool active = BPH_mass_spring_eval_spring_goal(data, i, goal_x, goal_v, stiffness, damping, f, dfdx, dfdv);
+	
+	if (active) {
+		add_v3_v3(data->F.v3(i), f);
+		data->idFdX.add(i, i, dfdx);
+		data->idFdV.add(i, i, dfdv);
+	}
+	
+	if (r_f) copy_v3_v3(r_f, f);
+	if (r_dfdx) copy_m3_m3(r_dfdx, dfdx);
+	if (r_dfdv) copy_m3_m3(r_dfdv, dfdv);
+	
+	return active;
+}
+
+/* the triplet lists are not thread safe, springs are added one by one here */
+void BPH_mass_spring_apply_spring_forces(Implicit_Data *data, ImplicitSpringForce *forces, int totforce)
+{
+	int k;
+	
+	for (k = 0; k < totforce; k++) {
+		ImplicitSpringForce *force = &forces[k];
+		
+		if (!force->active)
+			continue;
+		
+		if (force->j >= 0) {
+			apply_spring(data, force->i, force->j, force->f, force->dfdx, force->dfdv);
+		}
+		else {
+			add_v3_v3(data->F.v3(force->i), force->f);
+			data->idFdX.add(force->i, force->i, force->dfdx);
+			data->idFdV.add(force->i, force->i, force->dfdv);
+		}
+	}
+}
+
 #endif /* IMPLICIT_SOLVER_EIGEN */